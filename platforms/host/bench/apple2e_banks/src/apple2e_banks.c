@@ -0,0 +1,577 @@
+// apple2e_banks.c
+//
+// Apple //e bank switching benchmark. Hammers the memory soft switches
+// (RAMRD, RAMWRT, ALTZP, PAGE2 with 80STORE and the language card $C08x)
+// the way copy protection and bank hungry code does, and reports the host
+// time per soft switch access for each storm pattern. The accesses go
+// straight to the Apple //e bus handler, so the time is the soft switch
+// handling and the page table update, without instruction emulation.
+//
+// With -v the CPU-visible page table and layer 0 are checked after every
+// access of a random soft switch storm against a reference memory map
+// built with mem_map_ram(), mem_map_rom() and mem_map_rw() from the
+// switch states. mem_copy_in() and mem_copy_out() are checked against
+// mem_wr() and mem_rd() loops on random ranges, including ranges that wrap
+// around at $FFFF, in random memory maps, and the 256 byte write watch
+// bitmap they and mem_wr() leave behind against the ranges written.
+// Delta snapshots of random writes in random memory maps are applied onto a
+// base snapshot and checked against full snapshots, and a small rewind
+// history of them is sought back capture by capture. Random inputs recorded
+// at random ticks are replayed one tick at a time and checked against the
+// recorded timeline.
+//
+// ## zlib/libpng license
+//
+// Copyright (c) 2023 Veselin Sladkov
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//     1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software in a
+//     product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//     2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//     3. This notice may not be removed or altered from any source
+//     distribution.
+
+#define CHIPS_IMPL
+
+#define MEM_PAGE_SHIFT (9U)
+#define MEM_WRITE_WATCH
+#define MEM_WRITE_WATCH_SHIFT (8)
+#define MEM_WRITE_HOOK
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "host.h"
+
+#include "chips/chips_common.h"
+#include "chips/mos6502cpu.h"
+#include "chips/beeper.h"
+#include "chips/kbd.h"
+#include "chips/mem.h"
+#include "chips/clk.h"
+#include "devices/apple2_lc.h"
+#include "devices/disk2_fdd.h"
+#include "devices/disk2_fdc.h"
+#include "devices/apple2_fdc_rom.h"
+#include "devices/prodos_hdd.h"
+#include "devices/prodos_hdc.h"
+#include "devices/prodos_hdc_rom.h"
+
+uint8_t* const apple2_nib_images[] = {};
+uint8_t* apple2_po_images[] = {};
+uint32_t apple2_po_image_sizes[] = {};
+char* apple2_msc_images[] = {};
+
+#include "systems/apple2e.h"
+#include "systems/apple2e_rewind.h"
+#include "systems/apple2e_input.h"
+
+#define BENCH_DEFAULT_ACCESSES      (10000000)
+#define BENCH_DEFAULT_VERIFY_TRIALS (100000)
+#define BENCH_DEFAULT_COPY_TRIALS   (2000)
+#define BENCH_DEFAULT_DELTA_TRIALS  (2000)
+#define BENCH_DEFAULT_REWIND_FRAMES (400)
+#define BENCH_DEFAULT_INPUT_EVENTS  (2000)
+#define BENCH_REWIND_KEEP           (32)         // Frames the rewind check keeps the expected memory of
+#define BENCH_REWIND_RING_SIZE      (64 * 1024)  // Small enough to drop the oldest captures
+#define BENCH_MAX_PATTERN           (8)
+#define BENCH_MIXED_SIZE            (4096)
+
+// A soft switch access, reads (rw) or writes (!rw) to an I/O address
+typedef struct {
+    uint16_t addr;
+    bool rw;
+} bench_access_t;
+
+typedef struct {
+    const char* name;
+    bench_access_t setup;  // Access before the storm, addr 0 for none
+    bench_access_t accesses[BENCH_MAX_PATTERN];
+} bench_pattern_t;
+
+// clang-format off
+static const bench_pattern_t bench_patterns[] = {
+    {"ramrd", {0}, {{0xC003, false}, {0xC002, false}}},
+    {"ramwrt", {0}, {{0xC005, false}, {0xC004, false}}},
+    {"altzp", {0}, {{0xC009, false}, {0xC008, false}}},
+    {"page2", {0xC001, false}, {{0xC057, true}, {0xC055, true}, {0xC054, true}}},
+    {"lc", {0}, {{0xC08B, true}, {0xC08B, true}, {0xC081, true}, {0xC081, true}, {0xC083, true}, {0xC080, true}}},
+};
+// clang-format on
+
+// Every soft switch that changes the memory map, for the mixed storm and -v
+static const bench_access_t bench_switches[] = {
+    {0xC000, false}, {0xC001, false}, {0xC002, false}, {0xC003, false}, {0xC004, false}, {0xC005, false},
+    {0xC008, false}, {0xC009, false}, {0xC054, true},  {0xC055, true},  {0xC056, true},  {0xC057, true},
+    {0xC080, true},  {0xC081, true},  {0xC082, true},  {0xC083, true},  {0xC088, true},  {0xC089, true},
+    {0xC08A, true},  {0xC08B, true},  {0xC081, false}, {0xC08B, false},
+};
+
+static apple2e_t sys;
+static uint8_t rom[0x4000];
+static uint8_t character_rom[0x1000];
+static uint8_t keyboard_rom[0x800];
+
+static void print_usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "\t-n soft switch accesses per storm pattern (default %d)\n"
+            "\t-v verify the page table against a reference memory map, the bulk copies, delta snapshots, rewind\n"
+            "\t   and input replay\n"
+            "\t-h show this help\n",
+            argv0, BENCH_DEFAULT_ACCESSES);
+    exit(1);
+}
+
+static uint32_t bench_random(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static inline void bench_access(bench_access_t access) {
+    MOS6502CPU_SET_DATA(&sys.cpu, 0);
+    _apple2e_mem_rw(&sys, access.addr, access.rw);
+}
+
+// Put the soft switches back into their power-on state
+static void bench_reset_switches(void) {
+    static const bench_access_t reset[] = {
+        {0xC000, false}, {0xC002, false}, {0xC004, false}, {0xC008, false},
+        {0xC054, true},  {0xC056, true},  {0xC081, true},  {0xC081, true},
+    };
+    for (size_t i = 0; i < CHIPS_ARRAY_SIZE(reset); i++) {
+        bench_access(reset[i]);
+    }
+}
+
+static double bench_storm(const bench_access_t* accesses, uint32_t num_accesses, uint32_t num_total) {
+    uint64_t t0 = host_time_ns();
+    for (uint32_t i = 0, j = 0; i < num_total; i++) {
+        bench_access(accesses[j]);
+        if (++j == num_accesses) {
+            j = 0;
+        }
+    }
+    return (double)(host_time_ns() - t0) / num_total;
+}
+
+// Map the Apple //e memory as the soft switches select it, the straightforward way
+static void bench_reference_map(mem_t* mem) {
+    mem_init(mem);
+    uint8_t* rd = sys.ramrd ? sys.aux_ram : sys.ram;
+    uint8_t* wr = sys.ramwrt ? sys.aux_ram : sys.ram;
+    uint8_t* zp = sys.altzp ? sys.aux_ram : sys.ram;
+    mem_map_ram(mem, 0, 0x0000, 0x0200, zp);
+    mem_map_rw(mem, 0, 0x0200, 0xBE00, rd + 0x0200, wr + 0x0200);
+    if (sys._80store) {
+        uint8_t* page = sys.page2 ? sys.aux_ram : sys.ram;
+        mem_map_ram(mem, 0, 0x0400, 0x0400, page + 0x0400);
+        if (sys.hires) {
+            mem_map_ram(mem, 0, 0x2000, 0x2000, page + 0x2000);
+        }
+    }
+    mem_map_rom(mem, 0, 0xC000, 0x1000, sys.rom);
+    uint8_t* bank = zp + (sys.lcbnk2 ? 0xD000 : 0xC000);
+    if (sys.lcram && sys.write_enabled) {
+        mem_map_ram(mem, 0, 0xD000, 0x1000, bank);
+        mem_map_ram(mem, 0, 0xE000, 0x2000, zp + 0xE000);
+    } else if (sys.lcram) {
+        mem_map_rom(mem, 0, 0xD000, 0x1000, bank);
+        mem_map_rom(mem, 0, 0xE000, 0x2000, zp + 0xE000);
+    } else if (sys.write_enabled) {
+        mem_map_rw(mem, 0, 0xD000, 0x1000, sys.rom + 0x1000, bank);
+        mem_map_rw(mem, 0, 0xE000, 0x2000, sys.rom + 0x2000, zp + 0xE000);
+    } else {
+        mem_map_rom(mem, 0, 0xD000, 0x3000, sys.rom + 0x1000);
+    }
+}
+
+// Compare a page of sys.mem against the reference, which has its own unmapped and junk pages
+static bool bench_page_matches(const mem_page_t* page, const mem_page_t* ref_page, const mem_t* ref) {
+    const uint8_t* read_ptr = ref_page->read_ptr == ref->unmapped_page ? sys.mem.unmapped_page : ref_page->read_ptr;
+    const uint8_t* write_ptr = ref_page->write_ptr == ref->junk_page ? sys.mem.junk_page : ref_page->write_ptr;
+    return (page->read_ptr == read_ptr) && (page->write_ptr == write_ptr);
+}
+
+static int bench_verify(uint32_t num_trials) {
+    static mem_t ref;
+    uint32_t seed = 0xBA4C5E7;
+    int failures = 0;
+    bench_reset_switches();
+    for (uint32_t trial = 0; (trial < num_trials) && (failures < 10); trial++) {
+        bench_access_t access = bench_switches[bench_random(&seed) % CHIPS_ARRAY_SIZE(bench_switches)];
+        bench_access(access);
+        bench_reference_map(&ref);
+        for (uint32_t page = 0; page < MEM_NUM_PAGES; page++) {
+            if (!bench_page_matches(&sys.mem.page_table[page], &ref.page_table[page], &ref) ||
+                !bench_page_matches(&sys.mem.layers[0][page], &ref.layers[0][page], &ref)) {
+                printf("trial %u: $%04X %s left page $%04X mapped wrong\n", trial, access.addr,
+                       access.rw ? "read" : "write", page << MEM_PAGE_SHIFT);
+                failures++;
+                break;
+            }
+        }
+    }
+    printf("%s: %u soft switch accesses\n", failures ? "FAILED" : "OK", num_trials);
+    return failures ? 1 : 0;
+}
+
+// Check that exactly the write watch chunks overlapping a range of num_bytes at addr are set
+static bool bench_check_written(uint16_t addr, uint32_t num_bytes) {
+    int num_written = 0;
+    for (uint32_t chunk = 0; chunk < MEM_WRITE_WATCH_CHUNKS; chunk++) {
+        // Offset of the chunk from addr, wrapping around at $FFFF
+        uint32_t start = ((chunk << MEM_WRITE_WATCH_SHIFT) - addr) & MEM_ADDR_MASK;
+        uint32_t end = start + (1U << MEM_WRITE_WATCH_SHIFT) - 1;
+        bool overlaps = (num_bytes > 0) && ((start < num_bytes) || (end >= MEM_ADDR_RANGE) ||
+                                            (num_bytes == MEM_ADDR_RANGE + 1));
+        if (mem_written(&sys.mem, (uint16_t)(chunk << MEM_WRITE_WATCH_SHIFT), 1) != overlaps) {
+            return false;
+        }
+        num_written += overlaps;
+    }
+    for (int chunk = mem_next_written(&sys.mem, 0); chunk >= 0; chunk = mem_next_written(&sys.mem, chunk + 1)) {
+        num_written--;
+    }
+    return num_written == 0;
+}
+
+// Random bulk copies in random memory maps, against byte loops from the same memory contents
+static int bench_verify_copies(uint32_t num_trials) {
+    static uint8_t before[2][0x10000];
+    static uint8_t expected[2][0x10000];
+    static uint8_t data[0x10000];
+    static uint8_t out[0x10000];
+    static uint8_t ref_out[0x10000];
+    uint32_t seed = 0xC0B1E5;
+    int failures = 0;
+    for (uint32_t trial = 0; (trial < num_trials) && (failures < 10); trial++) {
+        for (int i = 0; i < 8; i++) {
+            bench_access(bench_switches[bench_random(&seed) % CHIPS_ARRAY_SIZE(bench_switches)]);
+        }
+        uint16_t addr = (uint16_t)bench_random(&seed);
+        uint32_t num_bytes = (bench_random(&seed) & 1) ? bench_random(&seed) % 0x10001 : bench_random(&seed) % 0x400;
+        for (uint32_t i = 0; i < num_bytes; i++) {
+            data[i] = (uint8_t)bench_random(&seed);
+        }
+        memcpy(before[0], sys.ram, sizeof(sys.ram));
+        memcpy(before[1], sys.aux_ram, sizeof(sys.aux_ram));
+        mem_clear_written(&sys.mem, 0, MEM_ADDR_RANGE);
+        for (uint32_t i = 0; i < num_bytes; i++) {
+            mem_wr(&sys.mem, (uint16_t)(addr + i), data[i]);
+        }
+        if (!bench_check_written(addr, num_bytes)) {
+            printf("trial %u: mem_wr() of %u bytes to $%04X left wrong write watch bits\n", trial, num_bytes, addr);
+            failures++;
+        }
+        memcpy(expected[0], sys.ram, sizeof(sys.ram));
+        memcpy(expected[1], sys.aux_ram, sizeof(sys.aux_ram));
+        memcpy(sys.ram, before[0], sizeof(sys.ram));
+        memcpy(sys.aux_ram, before[1], sizeof(sys.aux_ram));
+        mem_clear_written(&sys.mem, 0, MEM_ADDR_RANGE);
+        mem_copy_in(&sys.mem, addr, data, num_bytes);
+        if (!bench_check_written(addr, num_bytes)) {
+            printf("trial %u: mem_copy_in() of %u bytes to $%04X left wrong write watch bits\n", trial, num_bytes,
+                   addr);
+            failures++;
+        }
+        if (memcmp(expected[0], sys.ram, sizeof(sys.ram)) || memcmp(expected[1], sys.aux_ram, sizeof(sys.aux_ram))) {
+            printf("trial %u: mem_copy_in() of %u bytes to $%04X differs from mem_wr()\n", trial, num_bytes, addr);
+            failures++;
+        }
+        for (uint32_t i = 0; i < num_bytes; i++) {
+            ref_out[i] = mem_rd(&sys.mem, (uint16_t)(addr + i));
+        }
+        mem_copy_out(&sys.mem, addr, out, num_bytes);
+        if (memcmp(ref_out, out, num_bytes)) {
+            printf("trial %u: mem_copy_out() of %u bytes from $%04X differs from mem_rd()\n", trial, num_bytes, addr);
+            failures++;
+        }
+    }
+    printf("%s: %u bulk copies\n", failures ? "FAILED" : "OK", num_trials);
+    return failures ? 1 : 0;
+}
+
+// Random writes in random memory maps, each followed by a delta snapshot applied onto a base snapshot
+static int bench_verify_deltas(uint32_t num_trials) {
+    static apple2e_t base;
+    static apple2e_t full;
+    static union {
+        apple2e_delta_t header;
+        uint8_t bytes[sizeof(apple2e_t)];
+    } delta;
+    uint32_t seed = 0xDE17A5;
+    int failures = 0;
+    apple2e_save_snapshot(&sys, &base);
+    for (uint32_t trial = 0; (trial < num_trials) && (failures < 10); trial++) {
+        uint32_t num_writes = bench_random(&seed) % 64;
+        for (uint32_t i = 0; i < num_writes; i++) {
+            if ((bench_random(&seed) & 3) == 0) {
+                bench_access(bench_switches[bench_random(&seed) % CHIPS_ARRAY_SIZE(bench_switches)]);
+            }
+            mem_wr(&sys.mem, (uint16_t)bench_random(&seed), (uint8_t)bench_random(&seed));
+        }
+        uint32_t size = apple2e_save_delta(&sys, &delta, sizeof(delta));
+        if (!size || !apple2e_apply_delta(&base, &delta, size)) {
+            printf("trial %u: delta snapshot of %u bytes not applied\n", trial, size);
+            failures++;
+            continue;
+        }
+        // A full snapshot also starts the next delta, check chains of deltas too
+        if (trial % 8 != 7) {
+            continue;
+        }
+        apple2e_save_snapshot(&sys, &full);
+        if (memcmp(base.ram, full.ram, sizeof(full.ram)) || memcmp(base.aux_ram, full.aux_ram, sizeof(full.aux_ram)) ||
+            memcmp(&base.mem, &full.mem, sizeof(full.mem)) || (base.lcram != full.lcram) ||
+            (base.lcbnk2 != full.lcbnk2) || (base.altzp != full.altzp) || (base.ramwrt != full.ramwrt)) {
+            printf("trial %u: delta snapshot of %u bytes applied onto the base differs from a full snapshot\n", trial,
+                   size);
+            failures++;
+        }
+    }
+    printf("%s: %u delta snapshots\n", failures ? "FAILED" : "OK", num_trials);
+    return failures ? 1 : 0;
+}
+
+// Random writes in random memory maps captured every frame into a small rewind history, then sought back
+static int bench_verify_rewind(uint32_t num_frames) {
+    static apple2e_rewind_t rewind;
+    static struct {
+        uint8_t ram[0x10000];
+        uint8_t aux_ram[0x10000];
+        mem_t mem;
+    } expected[BENCH_REWIND_KEEP];
+    uint32_t seed = 0x4E5E7;
+    int failures = 0;
+    size_t size = apple2e_rewind_min_size() + BENCH_REWIND_RING_SIZE;
+    uint8_t* buffer = malloc(size);
+    if (!buffer || !apple2e_rewind_init(&rewind, &sys, &(apple2e_rewind_desc_t){
+                                                          .buffer = {.ptr = buffer, .size = size},
+                                                          .interval = 1,
+                                                      })) {
+        printf("FAILED: rewind history not initialized\n");
+        return 1;
+    }
+    for (uint32_t frame = 1; frame <= num_frames; frame++) {
+        uint32_t num_writes = bench_random(&seed) % 256;
+        for (uint32_t i = 0; i < num_writes; i++) {
+            if ((bench_random(&seed) & 15) == 0) {
+                bench_access(bench_switches[bench_random(&seed) % CHIPS_ARRAY_SIZE(bench_switches)]);
+            }
+            mem_wr(&sys.mem, (uint16_t)bench_random(&seed), (uint8_t)bench_random(&seed));
+        }
+        apple2e_rewind_frame(&rewind);
+        memcpy(expected[frame % BENCH_REWIND_KEEP].ram, sys.ram, sizeof(sys.ram));
+        memcpy(expected[frame % BENCH_REWIND_KEEP].aux_ram, sys.aux_ram, sizeof(sys.aux_ram));
+        expected[frame % BENCH_REWIND_KEEP].mem = sys.mem;
+    }
+    uint32_t oldest = apple2e_rewind_oldest_frame(&rewind);
+    if ((oldest == 0) || (oldest + BENCH_REWIND_KEEP <= num_frames) || (oldest + BENCH_REWIND_KEEP / 2 > num_frames)) {
+        printf("rewind history reaches back to frame %u, should hold a few captures and have dropped older ones\n",
+               oldest);
+        failures++;
+    }
+    for (uint32_t frame = num_frames - 1; !failures && (frame >= oldest) && (frame + BENCH_REWIND_KEEP > num_frames);
+         frame--) {
+        if (!apple2e_rewind_step_back(&rewind) || (rewind.frame != frame)) {
+            printf("frame %u: rewind didn't step back to it\n", frame);
+            failures++;
+        } else if (memcmp(expected[frame % BENCH_REWIND_KEEP].ram, sys.ram, sizeof(sys.ram)) ||
+                   memcmp(expected[frame % BENCH_REWIND_KEEP].aux_ram, sys.aux_ram, sizeof(sys.aux_ram)) ||
+                   memcmp(expected[frame % BENCH_REWIND_KEEP].mem.page_table, sys.mem.page_table,
+                          sizeof(sys.mem.page_table))) {
+            printf("frame %u: rewind restored different memory\n", frame);
+            failures++;
+        }
+    }
+    if (!failures && apple2e_rewind_step_back(&rewind)) {
+        printf("rewind stepped back past the oldest frame %u\n", oldest);
+        failures++;
+    }
+    // The smallest history holds one chunk, writing two between captures starts it over
+    size = apple2e_rewind_min_size();
+    if (!failures && apple2e_rewind_init(&rewind, &sys, &(apple2e_rewind_desc_t){
+                                                            .buffer = {.ptr = buffer, .size = size},
+                                                            .interval = 1,
+                                                        })) {
+        mem_wr(&sys.mem, 0x0400, 0x55);
+        mem_wr(&sys.mem, 0x0800, 0x55);
+        apple2e_rewind_frame(&rewind);
+        if ((apple2e_rewind_oldest_frame(&rewind) != 1) || apple2e_rewind_step_back(&rewind)) {
+            printf("rewind history kept a capture whose chunks didn't fit\n");
+            failures++;
+        }
+    }
+    mem_set_write_hook(&sys.mem, 0, 0);
+    free(buffer);
+    printf("%s: %u rewind frames, back to frame %u\n", failures ? "FAILED" : "OK", num_frames, oldest);
+    return failures ? 1 : 0;
+}
+
+// Input state after an input change, the CPU may clear the keyboard strobe in between
+typedef struct {
+    uint32_t ticks;
+    uint8_t key;
+    bool buttons[5];
+    uint8_t paddles[4];
+} bench_input_t;
+
+static bench_input_t bench_input_state(void) {
+    return (bench_input_t){
+        .ticks = sys.system_ticks,
+        .key = sys.kbd_last_key & 0x7F,
+        .buttons = {sys.kbd_open_apple_pressed, sys.kbd_solid_apple_pressed, sys.butn0, sys.butn1, sys.butn2},
+        .paddles = {sys.paddl0, sys.paddl1, sys.paddl2, sys.paddl3},
+    };
+}
+
+static bool bench_input_matches(const bench_input_t* a, const bench_input_t* b) {
+    return (a->key == b->key) && !memcmp(a->buttons, b->buttons, sizeof(a->buttons)) &&
+           !memcmp(a->paddles, b->paddles, sizeof(a->paddles));
+}
+
+// Random inputs recorded at random ticks, some at the same tick, replayed from a snapshot one tick at a time
+static int bench_verify_input(uint32_t num_events) {
+    static apple2e_t start;
+    static uint8_t ram[0x10000];
+    static uint8_t stream[APPLE2E_INPUT_HEADER_SIZE + 7 * BENCH_DEFAULT_INPUT_EVENTS];
+    static bench_input_t expected[BENCH_DEFAULT_INPUT_EVENTS + 1];
+    uint32_t seed = 0x1A9E7;
+    int failures = 0;
+    apple2e_input_recorder_t rec;
+    apple2e_input_player_t play;
+    CHIPS_ASSERT(num_events <= BENCH_DEFAULT_INPUT_EVENTS);
+    uint32_t version = apple2e_save_snapshot(&sys, &start);
+    apple2e_input_record_init(&rec, &sys, &(apple2e_input_desc_t){.stream = {.ptr = stream, .size = sizeof(stream)}});
+    expected[0] = bench_input_state();
+    for (uint32_t i = 1; i <= num_events; i++) {
+        apple2e_exec_ticks(&sys, bench_random(&seed) % 256);
+        // Everything but RESET, which would only restart the random code
+        uint8_t input = (uint8_t)(bench_random(&seed) % APPLE2E_INPUT_RESET);
+        uint8_t value = (uint8_t)bench_random(&seed);
+        if ((input != APPLE2E_INPUT_KEY) && (input < APPLE2E_INPUT_PADDLE0)) {
+            value &= 1;
+        }
+        apple2e_input_record(&rec, input, value);
+        expected[i] = bench_input_state();
+    }
+    apple2e_exec_ticks(&sys, 1);
+    const uint32_t end_ticks = sys.system_ticks;
+    memcpy(ram, sys.ram, sizeof(ram));
+
+    apple2e_load_snapshot(&sys, version, &start);
+    if (rec.overflow || !apple2e_input_play_init(&play, &sys, &(apple2e_input_desc_t){
+                                                                  .stream = {.ptr = stream, .size = rec.pos},
+                                                              })) {
+        printf("FAILED: input recording not replayed\n");
+        return 1;
+    }
+    uint32_t next = 1;
+    while (!failures && (sys.system_ticks != end_ticks)) {
+        // Apply the events of this tick, then compare against the last one recorded at it
+        apple2e_input_play_exec_ticks(&play, 0);
+        while ((next <= num_events) && (expected[next].ticks == sys.system_ticks)) {
+            next++;
+        }
+        bench_input_t state = bench_input_state();
+        if (!bench_input_matches(&state, &expected[next - 1])) {
+            printf("tick %u: input state differs from the recording after event %u\n", sys.system_ticks, next - 1);
+            failures++;
+        }
+        apple2e_input_play_exec_ticks(&play, 1);
+    }
+    if (!failures && (!apple2e_input_play_done(&play) || play.num_late || play.error ||
+                      (play.num_events != rec.num_events) || memcmp(ram, sys.ram, sizeof(ram)))) {
+        printf("input replay applied %u of %u events, %u late, and ended with %s memory\n", play.num_events,
+               rec.num_events, play.num_late, memcmp(ram, sys.ram, sizeof(ram)) ? "different" : "the same");
+        failures++;
+    }
+    printf("%s: %u input events replayed, %u changes in %u bytes\n", failures ? "FAILED" : "OK", num_events,
+           rec.num_events, rec.pos);
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char* const argv[]) {
+    uint32_t num_accesses = BENCH_DEFAULT_ACCESSES;
+    bool verify = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:vh")) != -1) {
+        switch (opt) {
+            case 'n':
+                num_accesses = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'v':
+                verify = true;
+                break;
+            case 'h':
+            default:
+                print_usage(argv[0]);
+                break;
+        }
+    }
+    if (num_accesses == 0) {
+        print_usage(argv[0]);
+    }
+
+    apple2e_init_tables();
+    apple2e_init(&sys, &(apple2e_desc_t){
+                           .roms =
+                               {
+                                   .rom = {.ptr = rom, .size = sizeof(rom)},
+                                   .character_rom = {.ptr = character_rom, .size = sizeof(character_rom)},
+                                   .keyboard_rom = {.ptr = keyboard_rom, .size = sizeof(keyboard_rom)},
+                                   .fdc_rom = {.ptr = apple2_fdc_rom, .size = sizeof(apple2_fdc_rom)},
+                                   .hdc_rom = {.ptr = prodos_hdc_rom, .size = sizeof(prodos_hdc_rom)},
+                               },
+                       });
+
+    if (verify) {
+        int res = bench_verify(BENCH_DEFAULT_VERIFY_TRIALS);
+        res |= bench_verify_copies(BENCH_DEFAULT_COPY_TRIALS);
+        res |= bench_verify_deltas(BENCH_DEFAULT_DELTA_TRIALS);
+        res |= bench_verify_rewind(BENCH_DEFAULT_REWIND_FRAMES);
+        return res | bench_verify_input(BENCH_DEFAULT_INPUT_EVENTS);
+    }
+
+    for (size_t i = 0; i < CHIPS_ARRAY_SIZE(bench_patterns); i++) {
+        const bench_pattern_t* pattern = &bench_patterns[i];
+        uint32_t num = 0;
+        while ((num < BENCH_MAX_PATTERN) && pattern->accesses[num].addr) {
+            num++;
+        }
+        bench_reset_switches();
+        if (pattern->setup.addr) {
+            bench_access(pattern->setup);
+        }
+        double ns = bench_storm(pattern->accesses, num, num_accesses);
+        printf("%-8s %8.1f ns/access\n", pattern->name, ns);
+    }
+
+    // All memory soft switches in random order
+    static bench_access_t mixed[BENCH_MIXED_SIZE];
+    uint32_t seed = 0x2E2E2E2E;
+    for (int i = 0; i < BENCH_MIXED_SIZE; i++) {
+        mixed[i] = bench_switches[bench_random(&seed) % CHIPS_ARRAY_SIZE(bench_switches)];
+    }
+    bench_reset_switches();
+    double ns = bench_storm(mixed, BENCH_MIXED_SIZE, num_accesses);
+    printf("%-8s %8.1f ns/access\n", "mixed", ns);
+
+    apple2e_discard(&sys);
+    return 0;
+}
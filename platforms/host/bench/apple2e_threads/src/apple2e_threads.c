@@ -0,0 +1,331 @@
+// apple2e_threads.c
+//
+// Apple //e multithreaded stress test. Boots one emulator instance per
+// thread from the same ROM and disk image files and runs them all at the
+// same time, then reports the aggregate throughput against a single
+// instance running alone.
+//
+// A reference instance first runs the frames on the main thread and keeps
+// the tick count and hash of each frame. Every threaded instance must
+// reproduce them frame by frame, and end with the same main and aux RAM,
+// while it also takes apple2e_save_snapshot() / apple2e_load_snapshot()
+// round trips and steps back through its own rewind history and runs the
+// lost frames again, each thread at a different interval. Anything an
+// instance shares with another one shows up as a differing frame.
+//
+// The shared render tables are filled with apple2e_init_tables() and the
+// instances are initialized on the main thread before the threads start.
+//
+// ## zlib/libpng license
+//
+// Copyright (c) 2023 Veselin Sladkov
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//     1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software in a
+//     product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//     2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//     3. This notice may not be removed or altered from any source
+//     distribution.
+
+#define CHIPS_IMPL
+
+#define MEM_PAGE_SHIFT (9U)
+#define MEM_PAGE_GENERATIONS
+// Rewind history of each instance
+#define MEM_WRITE_HOOK
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "host.h"
+
+#include "chips/chips_common.h"
+#include "chips/mos6502cpu.h"
+#include "chips/beeper.h"
+#include "chips/kbd.h"
+#include "chips/mem.h"
+#include "chips/mos6502cpu_exec.h"
+#include "chips/clk.h"
+#include "devices/apple2_lc.h"
+#include "devices/disk2_fdd.h"
+#include "devices/disk2_fdc.h"
+#include "devices/apple2_fdc_rom.h"
+#include "devices/prodos_hdd.h"
+#include "devices/prodos_hdc.h"
+#include "devices/prodos_hdc_rom.h"
+
+// Disks are inserted from the command line after apple2e_init()
+uint8_t* const apple2_nib_images[] = {};
+uint8_t* apple2_po_images[] = {};
+uint32_t apple2_po_image_sizes[] = {};
+char* apple2_msc_images[] = {};
+
+#include "systems/apple2e.h"
+#include "systems/apple2e_rewind.h"
+
+#define BENCH_TICKS_PER_FRAME (17030)
+#define BENCH_DEFAULT_FRAMES (300)
+#define BENCH_MIN_THREADS (2)
+// Each thread i takes a snapshot round trip every BENCH_SNAPSHOT_FRAMES + i frames and steps back
+// through its rewind history every BENCH_REWIND_FRAMES + 3 * i frames
+#define BENCH_SNAPSHOT_FRAMES (7)
+#define BENCH_REWIND_FRAMES (23)
+#define BENCH_REWIND_INTERVAL (4)
+#define BENCH_REWIND_BUFFER_SIZE (512 * 1024)
+
+typedef struct {
+    pthread_t thread;
+    uint32_t index;
+    apple2e_t sys;
+    apple2e_t snapshot;
+    mos6502cpu_block_cache_t block_cache;
+    apple2e_rewind_t rewind;
+    uint8_t* rewind_buffer;
+    uint8_t* nib_image;
+    // First frame that differs from the reference run, or num_frames
+    uint32_t mismatch;
+    uint32_t frames_run;
+    uint32_t num_round_trips;
+    uint32_t num_rewinds;
+} bench_instance_t;
+
+static uint32_t num_frames = BENCH_DEFAULT_FRAMES;
+static uint8_t exec_mode = APPLE2E_EXEC_MODE_CYCLE;
+// Ticks at the end of each frame and frame hashes of the reference run
+static uint64_t* ref_ticks;
+static uint64_t* ref_hashes;
+
+static void print_usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s -r rom_file -c character_rom_file [options]\n"
+            "\t-r Apple //e ROM image (16 KB, $C000-$FFFF)\n"
+            "\t-c character ROM image (4 KB)\n"
+            "\t-k keyboard ROM image (2 KB, optional)\n"
+            "\t-d Disk II .nib image for drive 1, each instance gets its own copy (optional)\n"
+            "\t-j number of threads, one instance each (default number of cores, at least %d)\n"
+            "\t-n number of frames to run (default %d)\n"
+            "\t-i run instruction-granular instead of cycle-stepped\n"
+            "\t-b run predecoded blocks from a block cache\n"
+            "\t-h show this help\n",
+            argv0, BENCH_MIN_THREADS, BENCH_DEFAULT_FRAMES);
+    exit(1);
+}
+
+static uint8_t* load_rom(const char* path, size_t expected_size) {
+    size_t size = 0;
+    uint8_t* data = host_load_file(path, &size);
+    if (data && size != expected_size) {
+        fprintf(stderr, "%s: expected %zu bytes, got %zu\n", path, expected_size, size);
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+// Run one frame with the same catch-up as the runner, returns the ticks at its end
+static uint64_t bench_run_frame(apple2e_t* sys, uint32_t frame, uint64_t num_ticks) {
+    uint32_t frame_ticks = (uint32_t)((frame + 1) * (uint64_t)BENCH_TICKS_PER_FRAME - num_ticks);
+    num_ticks += apple2e_exec_ticks(sys, frame_ticks);
+    apple2e_screen_update(sys);
+    return num_ticks;
+}
+
+static void* bench_thread(void* arg) {
+    bench_instance_t* inst = (bench_instance_t*)arg;
+    apple2e_t* sys = &inst->sys;
+    const uint32_t snapshot_frames = BENCH_SNAPSHOT_FRAMES + inst->index;
+    const uint32_t rewind_frames = BENCH_REWIND_FRAMES + 3 * inst->index;
+    uint32_t next_rewind = rewind_frames;
+    uint64_t num_ticks = 0;
+    uint32_t frame = 0;
+    while (frame < num_frames) {
+        num_ticks = bench_run_frame(sys, frame, num_ticks);
+        inst->frames_run++;
+        if ((num_ticks != ref_ticks[frame]) || (apple2e_frame_hash(sys) != ref_hashes[frame])) {
+            inst->mismatch = frame;
+            break;
+        }
+        frame++;
+        apple2e_rewind_frame(&inst->rewind);
+        if ((frame % snapshot_frames) == 0) {
+            uint32_t version = apple2e_save_snapshot(sys, &inst->snapshot);
+            if (!apple2e_load_snapshot(sys, version, &inst->snapshot)) {
+                inst->mismatch = frame;
+                break;
+            }
+            inst->num_round_trips++;
+        }
+        if (frame == next_rewind) {
+            // Go back one or two captures and run the frames since then again
+            if (apple2e_rewind_step_back(&inst->rewind)) {
+                frame = inst->rewind.frame;
+                num_ticks = frame ? ref_ticks[frame - 1] : 0;
+                inst->num_rewinds++;
+            }
+            next_rewind += rewind_frames;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char* const argv[]) {
+    const char *rom_file = NULL, *character_rom_file = NULL, *keyboard_rom_file = NULL, *nib_file = NULL;
+    long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t num_threads = num_cores > BENCH_MIN_THREADS ? (uint32_t)num_cores : BENCH_MIN_THREADS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:c:k:d:j:n:ibh")) != -1) {
+        switch (opt) {
+            case 'r':
+                rom_file = optarg;
+                break;
+            case 'c':
+                character_rom_file = optarg;
+                break;
+            case 'k':
+                keyboard_rom_file = optarg;
+                break;
+            case 'd':
+                nib_file = optarg;
+                break;
+            case 'j':
+                num_threads = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                num_frames = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'i':
+                exec_mode = APPLE2E_EXEC_MODE_INSTRUCTION;
+                break;
+            case 'b':
+                exec_mode = APPLE2E_EXEC_MODE_BLOCK_CACHE;
+                break;
+            case 'h':
+            default:
+                print_usage(argv[0]);
+                break;
+        }
+    }
+
+    if (!rom_file || !character_rom_file || num_frames == 0 || num_threads == 0) {
+        print_usage(argv[0]);
+    }
+
+    uint8_t* rom = load_rom(rom_file, 0x4000);
+    uint8_t* character_rom = load_rom(character_rom_file, 0x1000);
+    uint8_t* keyboard_rom = keyboard_rom_file ? load_rom(keyboard_rom_file, 0x800) : calloc(1, 0x800);
+    uint8_t* nib_image = nib_file ? load_rom(nib_file, DISK2_FDD_NIB_IMAGE_SIZE) : NULL;
+    ref_ticks = malloc(num_frames * sizeof(uint64_t));
+    ref_hashes = malloc(num_frames * sizeof(uint64_t));
+    // Instance 0 is the reference, the others run on the threads
+    bench_instance_t* instances = calloc(num_threads + 1, sizeof(bench_instance_t));
+    if (!rom || !character_rom || !keyboard_rom || (nib_file && !nib_image) || !ref_ticks || !ref_hashes ||
+        !instances) {
+        return 1;
+    }
+
+    apple2e_init_tables();
+    for (uint32_t i = 0; i <= num_threads; i++) {
+        bench_instance_t* inst = &instances[i];
+        apple2e_init(&inst->sys, &(apple2e_desc_t){
+                                     .fdc_enabled = true,
+                                     .roms =
+                                         {
+                                             .rom = {.ptr = rom, .size = 0x4000},
+                                             .character_rom = {.ptr = character_rom, .size = 0x1000},
+                                             .keyboard_rom = {.ptr = keyboard_rom, .size = 0x800},
+                                             .fdc_rom = {.ptr = apple2_fdc_rom, .size = sizeof(apple2_fdc_rom)},
+                                             .hdc_rom = {.ptr = prodos_hdc_rom, .size = sizeof(prodos_hdc_rom)},
+                                         },
+                                 });
+        if (nib_image) {
+            // The Disk II writes into the image, so no instance may share it
+            inst->nib_image = malloc(DISK2_FDD_NIB_IMAGE_SIZE);
+            if (!inst->nib_image) {
+                return 1;
+            }
+            memcpy(inst->nib_image, nib_image, DISK2_FDD_NIB_IMAGE_SIZE);
+            disk2_fdd_insert_disk(&inst->sys.fdc.fdd[0], inst->nib_image);
+        }
+        apple2e_set_block_cache(&inst->sys, &inst->block_cache);
+        apple2e_set_exec_mode(&inst->sys, exec_mode);
+        inst->index = i - 1;
+        inst->mismatch = num_frames;
+        if (i > 0) {
+            inst->rewind_buffer = malloc(BENCH_REWIND_BUFFER_SIZE);
+            if (!inst->rewind_buffer ||
+                !apple2e_rewind_init(&inst->rewind, &inst->sys, &(apple2e_rewind_desc_t){
+                                                                    .buffer =
+                                                                        {
+                                                                            .ptr = inst->rewind_buffer,
+                                                                            .size = BENCH_REWIND_BUFFER_SIZE,
+                                                                        },
+                                                                    .interval = BENCH_REWIND_INTERVAL,
+                                                                })) {
+                return 1;
+            }
+        }
+    }
+
+    bench_instance_t* ref = &instances[0];
+    uint64_t num_ticks = 0;
+    uint64_t t0 = host_time_ns();
+    for (uint32_t frame = 0; frame < num_frames; frame++) {
+        num_ticks = bench_run_frame(&ref->sys, frame, num_ticks);
+        ref_ticks[frame] = num_ticks;
+        ref_hashes[frame] = apple2e_frame_hash(&ref->sys);
+    }
+    uint64_t ref_ns = host_time_ns() - t0;
+
+    t0 = host_time_ns();
+    for (uint32_t i = 1; i <= num_threads; i++) {
+        if (pthread_create(&instances[i].thread, NULL, bench_thread, &instances[i])) {
+            fprintf(stderr, "Failed to start thread %u\n", i - 1);
+            return 1;
+        }
+    }
+    uint64_t frames_run = 0;
+    uint32_t num_round_trips = 0, num_rewinds = 0;
+    for (uint32_t i = 1; i <= num_threads; i++) {
+        pthread_join(instances[i].thread, NULL);
+        frames_run += instances[i].frames_run;
+        num_round_trips += instances[i].num_round_trips;
+        num_rewinds += instances[i].num_rewinds;
+    }
+    uint64_t threads_ns = host_time_ns() - t0;
+
+    static const char* exec_mode_names[] = {"cycle mode", "instruction mode", "block cache mode"};
+    double ref_fps = num_frames * 1e9 / ref_ns;
+    double threads_fps = frames_run * 1e9 / threads_ns;
+    printf("apple2e_threads: %u threads x %u frames (%s), %ld cores\n", num_threads, num_frames,
+           exec_mode_names[exec_mode], num_cores);
+    printf("  single instance: %.1f fps\n", ref_fps);
+    printf("  all threads:     %.1f fps (%.2fx), %llu frames with %u snapshot round trips and %u rewinds\n",
+           threads_fps, threads_fps / ref_fps, (unsigned long long)frames_run, num_round_trips, num_rewinds);
+
+    int failures = 0;
+    for (uint32_t i = 1; i <= num_threads; i++) {
+        bench_instance_t* inst = &instances[i];
+        if (inst->mismatch < num_frames) {
+            printf("thread %u: frame %u differs from the reference run\n", inst->index, inst->mismatch);
+            failures++;
+        } else if (memcmp(inst->sys.ram, ref->sys.ram, sizeof(ref->sys.ram)) ||
+                   memcmp(inst->sys.aux_ram, ref->sys.aux_ram, sizeof(ref->sys.aux_ram))) {
+            printf("thread %u: RAM differs from the reference run\n", inst->index);
+            failures++;
+        }
+    }
+    printf("%s: %u instances on %u threads\n", failures ? "FAILED" : "OK", num_threads, num_threads);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,470 @@
+// apple2e_video.c
+//
+// Apple //e screen renderer benchmark. Fills video memory with random bytes
+// and reports the host time of full-screen redraws per video mode, into the
+// 4bpp fb or with -f into a surface of another pixel format.
+//
+// With -v the HGR, DHGR and text output of apple2e_screen_update() is checked
+// against bit-serial reference renderers on random video memory and
+// character ROMs, and the RGB232, RGB565 and RGBA8888 surfaces against the
+// 4bpp output converted through apple2e_palette. Page flips between pages
+// with random writes are checked against full redraws, and their host time
+// is reported with the full redraws. Scanline rendering is checked with a
+// video mode switch in the middle of a frame.
+//
+// ## zlib/libpng license
+//
+// Copyright (c) 2023 Veselin Sladkov
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//     1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software in a
+//     product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//     2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//     3. This notice may not be removed or altered from any source
+//     distribution.
+
+#define CHIPS_IMPL
+
+#define MEM_PAGE_SHIFT (9U)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "host.h"
+
+#include "chips/chips_common.h"
+#include "chips/mos6502cpu.h"
+#include "chips/beeper.h"
+#include "chips/kbd.h"
+#include "chips/mem.h"
+#include "chips/clk.h"
+#include "devices/apple2_lc.h"
+#include "devices/disk2_fdd.h"
+#include "devices/disk2_fdc.h"
+#include "devices/apple2_fdc_rom.h"
+#include "devices/prodos_hdd.h"
+#include "devices/prodos_hdc.h"
+#include "devices/prodos_hdc_rom.h"
+
+uint8_t* const apple2_nib_images[] = {};
+uint8_t* apple2_po_images[] = {};
+uint32_t apple2_po_image_sizes[] = {};
+char* apple2_msc_images[] = {};
+
+#include "systems/apple2e.h"
+
+#define BENCH_DEFAULT_FRAMES        (2000)
+#define BENCH_DEFAULT_VERIFY_TRIALS (200)
+
+typedef struct {
+    const char* name;
+    bool text, mixed, hires, dhires, _80col;
+} bench_mode_t;
+
+static const bench_mode_t bench_modes[] = {
+    {"text40", .text = true},
+    {"text80", .text = true, ._80col = true},
+    {"lores"},
+    {"hgr", .hires = true},
+    {"hgr+text", .hires = true, .mixed = true},
+    {"dhgr", .hires = true, .dhires = true, ._80col = true},
+};
+
+static const char* bench_format_names[] = {"4bpp", "rgb232", "rgb565", "rgba8888"};
+
+static apple2e_t sys;
+static uint32_t surface_pixels[APPLE2E_SCREEN_WIDTH * APPLE2E_SCREEN_HEIGHT];
+static uint8_t rom[0x4000];
+static uint8_t character_rom[0x1000];
+static uint8_t keyboard_rom[0x800];
+
+static void print_usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "\t-n full-screen redraws per video mode (default %d)\n"
+            "\t-f surface format: 4bpp (fb), rgb232, rgb565 or rgba8888 (default 4bpp)\n"
+            "\t-v verify the HGR, DHGR and text renderers against bit-serial references\n"
+            "\t-h show this help\n",
+            argv0, BENCH_DEFAULT_FRAMES);
+    exit(1);
+}
+
+static uint32_t bench_random(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void bench_random_video(uint32_t* seed) {
+    for (int addr = 0x400; addr < 0x6000; addr++) {
+        sys.ram[addr] = (uint8_t)bench_random(seed);
+        sys.aux_ram[addr] = (uint8_t)bench_random(seed);
+    }
+    for (int i = 0; i < (int)sizeof(character_rom); i++) {
+        character_rom[i] = (uint8_t)bench_random(seed);
+    }
+    // Same character ROM pointer with new contents, rebuild the glyph rows
+    sys.glyph_rom = 0;
+}
+
+static void bench_set_mode(const bench_mode_t* mode) {
+    sys.text = mode->text;
+    sys.mixed = mode->mixed;
+    sys.hires = mode->hires;
+    sys.dhires = mode->dhires;
+    sys._80col = mode->_80col;
+}
+
+// Forget the last video mode, the next apple2e_screen_update() redraws everything
+static void bench_redraw(void) {
+    memset(sys.screen_mode, 0xFF, sizeof(sys.screen_mode));
+    apple2e_screen_update(&sys);
+}
+
+// Bit-serial artifact color renderer, one color lookup per output pixel
+static void bench_render_line_color_reference(uint8_t* out, const uint16_t* in, bool is_80col) {
+    uint32_t w = in[0] << 3;
+
+    for (int col = 0; col < 40; col++) {
+        if (col + 1 < 40) {
+            w += in[col + 1] << 17;
+        }
+
+        for (int b = 0; b < 7; b++) {
+            uint8_t c1 = _apple2e_rotl4b(_apple2e_artifact_color_lut[w & 0x7F], col * 14 + b * 2 + is_80col);
+            w >>= 1;
+            uint8_t c2 = _apple2e_rotl4b(_apple2e_artifact_color_lut[w & 0x7F], col * 14 + b * 2 + 1 + is_80col);
+            w >>= 1;
+            out[col * 7 + b] = (c1 << 4) | (c2 & 0x0F);
+        }
+    }
+}
+
+// Bit-serial monochrome renderer, two pixels per output byte
+static void bench_render_line_monochrome_reference(uint8_t* out, const uint16_t* in) {
+    for (int col = 0; col < 40; col++) {
+        uint16_t w = in[col];
+        for (int b = 0; b < 7; b++) {
+            out[col * 7 + b] = ((w & 1) ? 0xF0 : 0x00) | ((w & 2) ? 0x0F : 0x00);
+            w >>= 2;
+        }
+    }
+}
+
+// Character ROM lookup with the alternate character set, flashing and inverse ranges
+static uint8_t bench_text_character_reference(uint8_t code, int row) {
+    bool invert = true;
+    if (!sys.altcharset && (code >= 0x40) && (code <= 0x7F)) {
+        code &= 0x3F;
+        invert = !sys.flash;
+    } else if (sys.altcharset && (code >= 0x60) && (code <= 0x7F)) {
+        code |= 0x80;
+        invert = false;
+    }
+    uint8_t bits = character_rom[code * 8 + row] & 0x7F;
+    return invert ? bits ^ 0x7F : bits;
+}
+
+// Render one row of text page 1 in 40 or 80 columns with the reference renderer
+static void bench_render_text_row_reference(uint8_t* out, int row) {
+    uint16_t address = 0x400 + ((((row / 8) & 0x07) << 7) | (((row / 8) & 0x18) * 5));
+    uint16_t words[40];
+    for (int col = 0; col < 40; col++) {
+        uint16_t main_bits = bench_text_character_reference(sys.ram[address + col], row & 7);
+        if (sys._80col) {
+            words[col] = bench_text_character_reference(sys.aux_ram[address + col], row & 7) | (main_bits << 7);
+        } else {
+            words[col] = 0;
+            for (int i = 6; i >= 0; i--) {
+                uint16_t bit = (main_bits >> i) & 1;
+                words[col] = (words[col] << 2) | (bit << 1) | bit;
+            }
+        }
+    }
+    bench_render_line_monochrome_reference(out, words);
+}
+
+// Render one row of HGR page 1 (or DHGR with is_80col) from video memory with the reference renderer
+static void bench_render_row_reference(uint8_t* out, int row, bool is_80col) {
+    uint32_t address = 0x2000 + (((row / 8) & 0x07) << 7) + (((row / 8) & 0x18) * 5) + ((row & 7) << 10);
+    const uint8_t* vram_row = &sys.ram[address];
+    const uint8_t* vaux_row = &sys.aux_ram[address];
+
+    uint16_t words[40];
+    uint16_t last_output_bit = 0;
+    for (int col = 0; col < 40; col++) {
+        if (is_80col) {
+            words[col] = (vaux_row[col] & 0x7F) | ((vram_row[col] & 0x7F) << 7);
+        } else {
+            uint16_t w = 0;
+            for (int i = 6; i >= 0; i--) {
+                uint16_t bit = (vram_row[col] >> i) & 1;
+                w = (w << 2) | (bit << 1) | bit;
+            }
+            if (vram_row[col] & 0x80) {
+                w = (w << 1 | last_output_bit) & 0x3FFF;
+            }
+            words[col] = w;
+            last_output_bit = w >> 13;
+        }
+    }
+    bench_render_line_color_reference(out, words, is_80col);
+}
+
+static void bench_set_surface(uint8_t format) {
+    static const uint32_t bytes_per_pixel[] = {0, 1, 2, 4};
+    if (format == APPLE2E_SURFACE_4BPP) {
+        apple2e_set_surface(&sys, 0);
+    } else {
+        apple2e_set_surface(&sys, &(apple2e_surface_t){
+                                      .ptr = surface_pixels,
+                                      .stride = APPLE2E_SCREEN_WIDTH * bytes_per_pixel[format],
+                                      .format = format,
+                                  });
+    }
+}
+
+// Check a surface against the fb converted through apple2e_palette, returns the number of rows that differ
+static uint32_t bench_verify_surface(uint8_t format) {
+    uint32_t failures = 0;
+    for (int row = 0; row < APPLE2E_SCREEN_HEIGHT; row++) {
+        const uint8_t* fb_row = _apple2e_get_fb_addr(&sys, row);
+        bool ok = true;
+        for (int x = 0; x < APPLE2E_SCREEN_WIDTH; x++) {
+            uint32_t c = apple2e_palette[(x & 1) ? (fb_row[x / 2] & 0xF) : (fb_row[x / 2] >> 4)];
+            uint32_t r = (c >> 16) & 0xFF, g = (c >> 8) & 0xFF, b = c & 0xFF;
+            switch (format) {
+                case APPLE2E_SURFACE_RGB232:
+                    ok &= ((uint8_t*)surface_pixels)[row * APPLE2E_SCREEN_WIDTH + x] ==
+                          (((r >> 6) << 6) | ((g >> 5) << 2) | (b >> 6));
+                    break;
+                case APPLE2E_SURFACE_RGB565:
+                    ok &= ((uint16_t*)surface_pixels)[row * APPLE2E_SCREEN_WIDTH + x] ==
+                          (((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+                    break;
+                case APPLE2E_SURFACE_RGBA8888:
+                    ok &= surface_pixels[row * APPLE2E_SCREEN_WIDTH + x] == c;
+                    break;
+            }
+        }
+        failures += ok ? 0 : 1;
+    }
+    return failures;
+}
+
+// Write a random byte to a video memory address like the CPU would, marking the scanlines that show it
+static void bench_random_write(uint32_t* seed) {
+    uint16_t addr = 0x400 + bench_random(seed) % (0x6000 - 0x400);
+    uint8_t* ram = (bench_random(seed) & 1) ? sys.aux_ram : sys.ram;
+    ram[addr] = (uint8_t)bench_random(seed);
+    _apple2e_mark_dirty(&sys, addr);
+}
+
+// Flip between display pages in random video modes with writes to both in between, each update
+// must match a full redraw, returns the number of rows that differ
+static uint32_t bench_verify_page_flips(uint32_t* seed) {
+    static uint8_t shown[APPLE2E_FRAMEBUFFER_SIZE];
+    uint32_t failures = 0;
+    for (int flip = 0; flip < 16; flip++) {
+        uint32_t num_writes = bench_random(seed) % 64;
+        for (uint32_t i = 0; i < num_writes; i++) {
+            bench_random_write(seed);
+        }
+        const bench_mode_t* mode = &bench_modes[bench_random(seed) % CHIPS_ARRAY_SIZE(bench_modes)];
+        bench_set_mode(mode);
+        sys.page2 = bench_random(seed) & 1;
+        apple2e_screen_update(&sys);
+        memcpy(shown, sys.fb, sizeof(shown));
+        // Redraw only the displayed page, the other one keeps its cached rows and dirty flags
+        sys.screen_mode[_apple2e_display_page(&sys)] = 0xFF;
+        apple2e_screen_update(&sys);
+        for (int row = 0; row < APPLE2E_SCREEN_HEIGHT; row++) {
+            if (memcmp(&shown[row * (APPLE2E_SCREEN_WIDTH / 2)], _apple2e_get_fb_addr(&sys, row),
+                       APPLE2E_SCREEN_WIDTH / 2)) {
+                if (failures < 10) {
+                    printf("%s page %d flip %d: row %d differs\n", mode->name, sys.page2 ? 2 : 1, flip, row);
+                }
+                failures++;
+            }
+        }
+    }
+    sys.page2 = false;
+    return failures;
+}
+
+// Run a frame with scanline rendering and switch from mode_a to mode_b when the beam is at split_row,
+// the rows above must show mode_a and the rest mode_b, returns the number of rows that differ
+static uint32_t bench_verify_scanlines(const bench_mode_t* mode_a, const bench_mode_t* mode_b, int split_row) {
+    static uint8_t expected[2][APPLE2E_FRAMEBUFFER_SIZE];
+    bench_set_mode(mode_a);
+    bench_redraw();
+    memcpy(expected[0], sys.fb, sizeof(expected[0]));
+    bench_set_mode(mode_b);
+    bench_redraw();
+    memcpy(expected[1], sys.fb, sizeof(expected[1]));
+
+    bench_set_mode(mode_a);
+    apple2e_set_scanline_render(&sys, true);
+    // Run to the start of the next frame and on until just before the beam reaches split_row
+    apple2e_exec_ticks(&sys, sys.frame_start_ticks + APPLE2E_FRAME_TICKS - sys.system_ticks);
+    apple2e_exec_ticks(&sys, split_row * APPLE2E_SCANLINE_TICKS - 1);
+    bench_set_mode(mode_b);
+    apple2e_exec_ticks(&sys, APPLE2E_FRAME_TICKS - split_row * APPLE2E_SCANLINE_TICKS);
+    apple2e_set_scanline_render(&sys, false);
+
+    uint32_t failures = 0;
+    for (int row = 0; row < APPLE2E_SCREEN_HEIGHT; row++) {
+        if (memcmp(&expected[row >= split_row][row * (APPLE2E_SCREEN_WIDTH / 2)], _apple2e_get_fb_addr(&sys, row),
+                   APPLE2E_SCREEN_WIDTH / 2)) {
+            if (failures < 10) {
+                printf("%s/%s split at %d: row %d differs\n", mode_a->name, mode_b->name, split_row, row);
+            }
+            failures++;
+        }
+    }
+    return failures;
+}
+
+static int bench_verify(uint32_t trials) {
+    // HGR, DHGR, 40 and 80 column text in turn
+    static const int verify_modes[] = {3, 5, 0, 1};
+    uint32_t seed = 0x2E2E2E2E;
+    uint32_t failures = 0;
+    for (uint32_t trial = 0; trial < trials; trial++) {
+        bench_random_video(&seed);
+        const bench_mode_t* mode = &bench_modes[verify_modes[trial & 3]];
+        bench_set_mode(mode);
+        sys.altcharset = bench_random(&seed) & 1;
+        sys.flash = bench_random(&seed) & 1;
+        bench_set_surface(APPLE2E_SURFACE_4BPP);
+        bench_redraw();
+        for (int row = 0; row < APPLE2E_SCREEN_HEIGHT; row++) {
+            uint8_t expected[APPLE2E_SCREEN_WIDTH / 2];
+            if (mode->text) {
+                bench_render_text_row_reference(expected, row);
+            } else {
+                bench_render_row_reference(expected, row, mode->dhires);
+            }
+            if (memcmp(expected, _apple2e_get_fb_addr(&sys, row), sizeof(expected))) {
+                if (failures < 10) {
+                    printf("trial %u: %s row %d differs\n", trial, mode->name, row);
+                }
+                failures++;
+            }
+        }
+        for (uint8_t format = APPLE2E_SURFACE_RGB232; format <= APPLE2E_SURFACE_RGBA8888; format++) {
+            bench_set_surface(format);
+            bench_redraw();
+            uint32_t rows = bench_verify_surface(format);
+            if (rows && (failures < 10)) {
+                printf("trial %u: %s %s surface differs in %u rows\n", trial, mode->name, bench_format_names[format],
+                       rows);
+            }
+            failures += rows;
+        }
+        bench_set_surface(APPLE2E_SURFACE_4BPP);
+        failures += bench_verify_page_flips(&seed);
+        failures += bench_verify_scanlines(&bench_modes[bench_random(&seed) % CHIPS_ARRAY_SIZE(bench_modes)],
+                                           &bench_modes[bench_random(&seed) % CHIPS_ARRAY_SIZE(bench_modes)],
+                                           bench_random(&seed) % APPLE2E_SCREEN_HEIGHT);
+    }
+    printf("verify: %u trials, %u rows differ\n", trials, failures);
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char* const argv[]) {
+    uint32_t num_frames = BENCH_DEFAULT_FRAMES;
+    uint8_t format = APPLE2E_SURFACE_4BPP;
+    bool verify = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:f:vh")) != -1) {
+        switch (opt) {
+            case 'n':
+                num_frames = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'f':
+                for (format = 0; format < CHIPS_ARRAY_SIZE(bench_format_names); format++) {
+                    if (!strcmp(optarg, bench_format_names[format])) {
+                        break;
+                    }
+                }
+                if (format == CHIPS_ARRAY_SIZE(bench_format_names)) {
+                    print_usage(argv[0]);
+                }
+                break;
+            case 'v':
+                verify = true;
+                break;
+            case 'h':
+            default:
+                print_usage(argv[0]);
+                break;
+        }
+    }
+    if (num_frames == 0) {
+        print_usage(argv[0]);
+    }
+
+    apple2e_init_tables();
+    apple2e_init(&sys, &(apple2e_desc_t){
+                           .roms =
+                               {
+                                   .rom = {.ptr = rom, .size = sizeof(rom)},
+                                   .character_rom = {.ptr = character_rom, .size = sizeof(character_rom)},
+                                   .keyboard_rom = {.ptr = keyboard_rom, .size = sizeof(keyboard_rom)},
+                                   .fdc_rom = {.ptr = apple2_fdc_rom, .size = sizeof(apple2_fdc_rom)},
+                                   .hdc_rom = {.ptr = prodos_hdc_rom, .size = sizeof(prodos_hdc_rom)},
+                               },
+                       });
+
+    if (verify) {
+        // Keep flashing text still while frames run for the scanline checks
+        _apple2e_cancel_event(&sys, APPLE2E_EVENT_FLASH);
+        return bench_verify(BENCH_DEFAULT_VERIFY_TRIALS);
+    }
+
+    uint32_t seed = 0x2E2E2E2E;
+    bench_random_video(&seed);
+    bench_set_surface(format);
+    printf("%s surface\n", bench_format_names[format]);
+    for (size_t i = 0; i < CHIPS_ARRAY_SIZE(bench_modes); i++) {
+        bench_set_mode(&bench_modes[i]);
+        uint64_t t0 = host_time_ns();
+        for (uint32_t frame = 0; frame < num_frames; frame++) {
+            bench_redraw();
+        }
+        uint64_t ns = host_time_ns() - t0;
+        printf("%-10s %8.2f us/frame %8.1f ns/row\n", bench_modes[i].name, ns / 1e3 / num_frames,
+               (double)ns / num_frames / APPLE2E_SCREEN_HEIGHT);
+    }
+
+    // Double buffering, PAGE2 toggles every frame and neither page changes
+    for (size_t i = 0; i < CHIPS_ARRAY_SIZE(bench_modes); i++) {
+        bench_set_mode(&bench_modes[i]);
+        bench_redraw();
+        uint64_t t0 = host_time_ns();
+        for (uint32_t frame = 0; frame < num_frames; frame++) {
+            sys.page2 = !sys.page2;
+            apple2e_screen_update(&sys);
+        }
+        uint64_t ns = host_time_ns() - t0;
+        sys.page2 = false;
+        printf("%-10s %8.2f us/flip\n", bench_modes[i].name, ns / 1e3 / num_frames);
+    }
+
+    apple2e_discard(&sys);
+    return 0;
+}
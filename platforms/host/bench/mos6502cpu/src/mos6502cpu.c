@@ -0,0 +1,700 @@
+// mos6502cpu.c
+//
+// Per-opcode cycle throughput benchmark for mos6502cpu_tick(). Each of the
+// 256 opcodes (including the undocumented ones) is run in a tight loop
+// against a flat 64 KByte mem_t, and the host time per emulated cycle and
+// per instruction is reported as text or JSON.
+//
+// With -x the instruction-granular mos6502cpu_exec() is measured instead,
+// with -b mos6502cpu_exec_cached() running predecoded blocks.
+// With -v mos6502cpu_exec() is checked against mos6502cpu_tick() on random
+// instructions, register values and I/O page layouts, and
+// mos6502cpu_exec_cached() on random self-modifying loops.
+//
+// -b and the block cache checks need MEM_PAGE_GENERATIONS (which makes every
+// mem_wr() a bit slower), see the mos6502cpu_bench_blocks target.
+//
+// ## zlib/libpng license
+//
+// Copyright (c) 2023 Veselin Sladkov
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//     1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software in a
+//     product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//     2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//     3. This notice may not be removed or altered from any source
+//     distribution.
+
+#define CHIPS_IMPL
+
+#define MEM_PAGE_SHIFT (9U)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "host.h"
+
+#include "chips/chips_common.h"
+#include "chips/mos6502cpu.h"
+#include "chips/mem.h"
+#include "chips/mos6502cpu_exec.h"
+
+#define BENCH_DEFAULT_CYCLES      (1000000)
+#define BENCH_DEFAULT_REPETITIONS (3)
+
+// Kernel layout: code runs from $8000, operands point into zero page ($10)
+// and the data area ($3010), the stack page is filled with $80 so that RTS
+// and RTI return into the code area
+#define BENCH_CODE_ADDR    (0x8000)
+#define BENCH_ZP_OPERAND   (0x10)
+#define BENCH_ABS_OPERAND  (0x3010)
+#define BENCH_KERNEL_COUNT (1000)
+
+#define BENCH_DEFAULT_VERIFY_TRIALS (200)
+#define BENCH_IO_LOG_SIZE           (16)
+
+// Block cache verify mode: random loops of up to BENCH_LOOP_SIZE bytes, each
+// run for BENCH_LOOP_CALLS calls with random cycle budgets
+#define BENCH_LOOP_TRIALS (2000)
+#define BENCH_LOOP_SIZE   (64)
+#define BENCH_LOOP_CALLS  (64)
+
+// Opcode names, undocumented opcodes are prefixed with '*'
+// clang-format off
+static const char* bench_opcode_names[256] = {
+    "BRK", "ORA (zp,X)", "*JAM", "*SLO (zp,X)", "*NOP zp", "ORA zp", "ASL zp", "*SLO zp",
+    "PHP", "ORA #", "ASL A", "*ANC #", "*NOP abs", "ORA abs", "ASL abs", "*SLO abs",
+    "BPL rel", "ORA (zp),Y", "*JAM", "*SLO (zp),Y", "*NOP zp,X", "ORA zp,X", "ASL zp,X", "*SLO zp,X",
+    "CLC", "ORA abs,Y", "*NOP", "*SLO abs,Y", "*NOP abs,X", "ORA abs,X", "ASL abs,X", "*SLO abs,X",
+    "JSR abs", "AND (zp,X)", "*JAM", "*RLA (zp,X)", "BIT zp", "AND zp", "ROL zp", "*RLA zp",
+    "PLP", "AND #", "ROL A", "*ANC #", "BIT abs", "AND abs", "ROL abs", "*RLA abs",
+    "BMI rel", "AND (zp),Y", "*JAM", "*RLA (zp),Y", "*NOP zp,X", "AND zp,X", "ROL zp,X", "*RLA zp,X",
+    "SEC", "AND abs,Y", "*NOP", "*RLA abs,Y", "*NOP abs,X", "AND abs,X", "ROL abs,X", "*RLA abs,X",
+    "RTI", "EOR (zp,X)", "*JAM", "*SRE (zp,X)", "*NOP zp", "EOR zp", "LSR zp", "*SRE zp",
+    "PHA", "EOR #", "LSR A", "*ASR #", "JMP abs", "EOR abs", "LSR abs", "*SRE abs",
+    "BVC rel", "EOR (zp),Y", "*JAM", "*SRE (zp),Y", "*NOP zp,X", "EOR zp,X", "LSR zp,X", "*SRE zp,X",
+    "CLI", "EOR abs,Y", "*NOP", "*SRE abs,Y", "*NOP abs,X", "EOR abs,X", "LSR abs,X", "*SRE abs,X",
+    "RTS", "ADC (zp,X)", "*JAM", "*RRA (zp,X)", "*NOP zp", "ADC zp", "ROR zp", "*RRA zp",
+    "PLA", "ADC #", "ROR A", "*ARR #", "JMP (ind)", "ADC abs", "ROR abs", "*RRA abs",
+    "BVS rel", "ADC (zp),Y", "*JAM", "*RRA (zp),Y", "*NOP zp,X", "ADC zp,X", "ROR zp,X", "*RRA zp,X",
+    "SEI", "ADC abs,Y", "*NOP", "*RRA abs,Y", "*NOP abs,X", "ADC abs,X", "ROR abs,X", "*RRA abs,X",
+    "*NOP #", "STA (zp,X)", "*NOP #", "*SAX (zp,X)", "STY zp", "STA zp", "STX zp", "*SAX zp",
+    "DEY", "*NOP #", "TXA", "*ANE #", "STY abs", "STA abs", "STX abs", "*SAX abs",
+    "BCC rel", "STA (zp),Y", "*JAM", "*SHA (zp),Y", "STY zp,X", "STA zp,X", "STX zp,Y", "*SAX zp,Y",
+    "TYA", "STA abs,Y", "TXS", "*SHS abs,Y", "*SHY abs,X", "STA abs,X", "*SHX abs,Y", "*SHA abs,Y",
+    "LDY #", "LDA (zp,X)", "LDX #", "*LAX (zp,X)", "LDY zp", "LDA zp", "LDX zp", "*LAX zp",
+    "TAY", "LDA #", "TAX", "*LXA #", "LDY abs", "LDA abs", "LDX abs", "*LAX abs",
+    "BCS rel", "LDA (zp),Y", "*JAM", "*LAX (zp),Y", "LDY zp,X", "LDA zp,X", "LDX zp,Y", "*LAX zp,Y",
+    "CLV", "LDA abs,Y", "TSX", "*LAS abs,Y", "LDY abs,X", "LDA abs,X", "LDX abs,Y", "*LAX abs,Y",
+    "CPY #", "CMP (zp,X)", "*NOP #", "*DCP (zp,X)", "CPY zp", "CMP zp", "DEC zp", "*DCP zp",
+    "INY", "CMP #", "DEX", "*SBX #", "CPY abs", "CMP abs", "DEC abs", "*DCP abs",
+    "BNE rel", "CMP (zp),Y", "*JAM", "*DCP (zp),Y", "*NOP zp,X", "CMP zp,X", "DEC zp,X", "*DCP zp,X",
+    "CLD", "CMP abs,Y", "*NOP", "*DCP abs,Y", "*NOP abs,X", "CMP abs,X", "DEC abs,X", "*DCP abs,X",
+    "CPX #", "SBC (zp,X)", "*NOP #", "*ISB (zp,X)", "CPX zp", "SBC zp", "INC zp", "*ISB zp",
+    "INX", "SBC #", "NOP", "*SBC #", "CPX abs", "SBC abs", "INC abs", "*ISB abs",
+    "BEQ rel", "SBC (zp),Y", "*JAM", "*ISB (zp),Y", "*NOP zp,X", "SBC zp,X", "INC zp,X", "*ISB zp,X",
+    "SED", "SBC abs,Y", "*NOP", "*ISB abs,Y", "*NOP abs,X", "SBC abs,X", "INC abs,X", "*ISB abs,X",
+};
+// clang-format on
+
+typedef struct {
+    uint8_t opcode;
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t ns;
+} bench_result_t;
+
+typedef struct {
+    uint16_t addr;
+    bool rw;
+    uint8_t data;
+} bench_io_access_t;
+
+// Machine state compared by the -v verify mode
+typedef struct {
+    mos6502cpu_t cpu;
+    uint32_t cycles;
+    uint8_t ram[0x10000];
+    uint8_t io[0x10000];
+    int num_io_accesses;
+    bench_io_access_t io_log[BENCH_IO_LOG_SIZE];
+} bench_state_t;
+
+static mos6502cpu_t cpu;
+static mem_t mem;
+static mos6502cpu_bus_t bus;
+#ifdef MOS6502CPU_EXEC_CACHED
+static mos6502cpu_block_cache_t block_cache;
+#endif
+static uint8_t ram[0x10000];
+
+// I/O space of the -v verify mode, reads have a side effect so that missing or extra accesses show up
+static uint8_t io[0x10000];
+static int num_io_accesses;
+static bench_io_access_t io_log[BENCH_IO_LOG_SIZE];
+
+// Instruction length of an NMOS 6502 opcode in bytes
+static int bench_opcode_length(uint8_t op) {
+    switch (op & 0x1F) {
+        case 0x00:
+            return (op == 0x20) ? 3 : ((op & 0x80) ? 2 : 1);
+        case 0x02:
+            return (op & 0x80) ? 2 : 1;
+        case 0x08:
+        case 0x0A:
+        case 0x12:
+        case 0x18:
+        case 0x1A:
+            return 1;
+        case 0x0C:
+        case 0x0D:
+        case 0x0E:
+        case 0x0F:
+        case 0x19:
+        case 0x1B:
+        case 0x1C:
+        case 0x1D:
+        case 0x1E:
+        case 0x1F:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
+static bool bench_is_jam(uint8_t op) { return ((op & 0x0F) == 0x02) && (((op & 0x10) != 0) || (op < 0x80)); }
+
+static inline void bench_tick(void) {
+    mos6502cpu_tick(&cpu);
+    if (cpu.rw) {
+        cpu.data = mem_rd(&mem, cpu.addr);
+    } else {
+        mem_wr(&mem, cpu.addr, cpu.data);
+    }
+}
+
+static uint8_t bench_io(uint16_t addr, bool rw, uint8_t data, void* user_data) {
+    (void)user_data;
+    if (num_io_accesses < BENCH_IO_LOG_SIZE) {
+        io_log[num_io_accesses] = (bench_io_access_t){.addr = addr, .rw = rw, .data = rw ? io[addr] : data};
+    }
+    num_io_accesses++;
+    if (rw) {
+        return io[addr]++;
+    }
+    io[addr] = data;
+    return data;
+}
+
+static void bench_set_vector(uint16_t addr, uint16_t target) {
+    ram[addr] = target & 0xFF;
+    ram[addr + 1] = target >> 8;
+}
+
+// Build the benchmark kernel for one opcode and run the CPU reset sequence into it
+static void bench_setup(uint8_t op) {
+    memset(ram, 0x30, sizeof(ram));
+    memset(&ram[0x0100], 0x80, 0x100);
+    uint16_t entry = BENCH_CODE_ADDR;
+    uint8_t* p = &ram[BENCH_CODE_ADDR];
+
+    switch (op) {
+        case 0x00:  // BRK vectors back to itself
+            *p = op;
+            bench_set_vector(0xFFFE, BENCH_CODE_ADDR);
+            break;
+        case 0x20:  // JSR to itself
+        case 0x4C:  // JMP to itself
+            p[0] = op;
+            p[1] = BENCH_CODE_ADDR & 0xFF;
+            p[2] = BENCH_CODE_ADDR >> 8;
+            break;
+        case 0x6C:  // JMP (ind) to itself
+            p[0] = op;
+            p[1] = BENCH_ZP_OPERAND;
+            p[2] = 0x00;
+            bench_set_vector(BENCH_ZP_OPERAND, BENCH_CODE_ADDR);
+            break;
+        case 0x40:  // RTI pulls P=$80 and PC=$8080 from the stack page
+            entry = 0x8080;
+            ram[entry] = op;
+            break;
+        case 0x60:  // RTS pulls $8080 from the stack page and returns to $8081
+            entry = 0x8081;
+            ram[entry] = op;
+            break;
+        default:
+            if (bench_is_jam(op)) {
+                *p = op;
+                break;
+            }
+            for (int i = 0; i < BENCH_KERNEL_COUNT; i++) {
+                int len = bench_opcode_length(op);
+                *p++ = op;
+                if (len == 2) {
+                    // Branches use a zero offset so both paths continue with the next instruction
+                    *p++ = ((op & 0x1F) == 0x10) ? 0x00 : BENCH_ZP_OPERAND;
+                } else if (len == 3) {
+                    *p++ = BENCH_ABS_OPERAND & 0xFF;
+                    *p++ = BENCH_ABS_OPERAND >> 8;
+                }
+            }
+            p[0] = 0x4C;
+            p[1] = BENCH_CODE_ADDR & 0xFF;
+            p[2] = BENCH_CODE_ADDR >> 8;
+            break;
+    }
+    bench_set_vector(0xFFFC, entry);
+
+    mos6502cpu_init(&cpu, &(mos6502cpu_desc_t){0});
+    do {
+        bench_tick();
+    } while (!cpu.sync);
+}
+
+static bench_result_t bench_opcode(uint8_t op, uint32_t num_cycles, uint32_t repetitions) {
+    bench_result_t res = {.opcode = op, .cycles = num_cycles, .ns = UINT64_MAX};
+
+    // Untimed pass to count instruction starts
+    bench_setup(op);
+    for (uint32_t i = 0; i < num_cycles; i++) {
+        bench_tick();
+        res.instructions += cpu.sync;
+    }
+
+    for (uint32_t r = 0; r < repetitions; r++) {
+        bench_setup(op);
+        uint64_t t0 = host_time_ns();
+        for (uint32_t i = 0; i < num_cycles; i++) {
+            bench_tick();
+        }
+        uint64_t ns = host_time_ns() - t0;
+        if (ns < res.ns) {
+            res.ns = ns;
+        }
+    }
+    return res;
+}
+
+static bench_result_t bench_opcode_exec(uint8_t op, uint32_t num_cycles, uint32_t repetitions) {
+    bench_result_t res = {.opcode = op, .ns = UINT64_MAX};
+
+    for (uint32_t r = 0; r < repetitions; r++) {
+        bench_setup(op);
+        uint64_t cycles = 0, instructions = 0;
+        uint64_t t0 = host_time_ns();
+        while (cycles < num_cycles) {
+            cycles += mos6502cpu_exec(&cpu, &bus);
+            instructions++;
+        }
+        uint64_t ns = host_time_ns() - t0;
+        if (ns < res.ns) {
+            res.ns = ns;
+        }
+        res.cycles = cycles;
+        // JAM never finishes an instruction, mos6502cpu_exec() steps it cycle by cycle
+        res.instructions = bench_is_jam(op) ? 0 : instructions;
+    }
+    return res;
+}
+
+#ifdef MOS6502CPU_EXEC_CACHED
+static bench_result_t bench_opcode_cached(uint8_t op, uint32_t num_cycles, uint32_t repetitions) {
+    bench_result_t res = {.opcode = op, .ns = UINT64_MAX};
+
+    // Untimed pass through mos6502cpu_exec() to count instructions
+    bench_setup(op);
+    uint64_t cycles = 0, instructions = 0;
+    while (cycles < num_cycles) {
+        cycles += mos6502cpu_exec(&cpu, &bus);
+        instructions++;
+    }
+    res.instructions = bench_is_jam(op) ? 0 : instructions;
+
+    for (uint32_t r = 0; r < repetitions; r++) {
+        bench_setup(op);
+        // bench_setup() writes the kernel directly to ram[]
+        mos6502cpu_block_cache_init(&block_cache);
+        uint64_t t0 = host_time_ns();
+        res.cycles = mos6502cpu_exec_cached(&cpu, &bus, &block_cache, num_cycles);
+        uint64_t ns = host_time_ns() - t0;
+        if (ns < res.ns) {
+            res.ns = ns;
+        }
+    }
+    // Both passes stop at the first instruction boundary after num_cycles
+    CHIPS_ASSERT(bench_is_jam(op) || (res.cycles == cycles));
+    return res;
+}
+#endif
+
+static uint32_t bench_random(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void bench_save_state(bench_state_t* state, uint32_t cycles) {
+    state->cpu = cpu;
+    state->cycles = cycles;
+    memcpy(state->ram, ram, sizeof(ram));
+    memcpy(state->io, io, sizeof(io));
+    state->num_io_accesses = num_io_accesses;
+    memcpy(state->io_log, io_log, sizeof(io_log));
+}
+
+static void bench_load_state(const bench_state_t* state) {
+    cpu = state->cpu;
+    memcpy(ram, state->ram, sizeof(ram));
+    memcpy(io, state->io, sizeof(io));
+    num_io_accesses = state->num_io_accesses;
+    memcpy(io_log, state->io_log, sizeof(io_log));
+}
+
+static bool bench_compare_state(const bench_state_t* a, const bench_state_t* b) {
+    const mos6502cpu_t* ca = &a->cpu;
+    const mos6502cpu_t* cb = &b->cpu;
+    return (a->cycles == b->cycles) && (ca->A == cb->A) && (ca->X == cb->X) && (ca->Y == cb->Y) && (ca->S == cb->S) &&
+           (ca->PC == cb->PC) && (ca->cf == cb->cf) && (ca->zf == cb->zf) && (ca->iflag == cb->iflag) &&
+           (ca->df == cb->df) && (ca->bf == cb->bf) && (ca->xf == cb->xf) && (ca->vf == cb->vf) && (ca->nf == cb->nf) &&
+           (ca->addr == cb->addr) && (ca->data == cb->data) && (ca->sync == cb->sync) &&
+           (a->num_io_accesses == b->num_io_accesses) && !memcmp(a->io_log, b->io_log, sizeof(a->io_log)) &&
+           !memcmp(a->ram, b->ram, sizeof(a->ram)) && !memcmp(a->io, b->io, sizeof(a->io));
+}
+
+static void bench_print_state(const char* name, const bench_state_t* state) {
+    const mos6502cpu_t* c = &state->cpu;
+    uint8_t p = (c->nf << 7) | (c->vf << 6) | (c->xf << 5) | (c->bf << 4) | (c->df << 3) | (c->iflag << 2) |
+                (c->zf << 1) | c->cf;
+    printf("  %-5s cycles=%u A=%02X X=%02X Y=%02X S=%02X PC=%04X P=%02X addr=%04X data=%02X io=%d:", name,
+           state->cycles, c->A, c->X, c->Y, c->S, c->PC, p, c->addr, c->data, state->num_io_accesses);
+    for (int i = 0; (i < state->num_io_accesses) && (i < BENCH_IO_LOG_SIZE); i++) {
+        printf(" %c%04X=%02X", state->io_log[i].rw ? 'R' : 'W', state->io_log[i].addr, state->io_log[i].data);
+    }
+    printf("\n");
+}
+
+// Random I/O layout, about a quarter of the pages are I/O and another quarter only trap writes
+static void bench_random_bus(uint32_t* seed) {
+    mos6502cpu_bus_init(&bus, &(mos6502cpu_bus_desc_t){.mem = &mem, .io_cb = bench_io});
+    for (uint32_t page = 0; page < 0x100; page++) {
+        uint32_t r = bench_random(seed) & 3;
+        if (r == 0) {
+            mos6502cpu_bus_add_io_range(&bus, page << 8, (page << 8) | 0xFF);
+        } else if (r == 1) {
+            mos6502cpu_bus_add_write_trap(&bus, page << 8, (page << 8) | 0xFF);
+        }
+    }
+}
+
+// Random memory, I/O and registers, with the CPU at an instruction boundary at pc
+static void bench_random_cpu(uint32_t* seed, uint16_t pc) {
+    for (uint32_t i = 0; i < sizeof(ram); i += 4) {
+        uint32_t r = bench_random(seed);
+        memcpy(&ram[i], &r, 4);
+        r = bench_random(seed);
+        memcpy(&io[i], &r, 4);
+    }
+    num_io_accesses = 0;
+
+    mos6502cpu_init(&cpu, &(mos6502cpu_desc_t){0});
+    uint32_t r = bench_random(seed);
+    cpu.res = false;
+    cpu.PC = pc;
+    cpu.A = r >> 16;
+    cpu.X = r >> 24;
+    r = bench_random(seed);
+    cpu.Y = r;
+    cpu.S = r >> 8;
+    _set_flags(&cpu, r >> 16);
+    cpu.bf = (r >> 28) & 1;
+    cpu.addr = cpu.PC;
+    cpu.data = ram[cpu.PC];
+}
+
+// Run one random instance of an opcode through mos6502cpu_tick() and mos6502cpu_exec() and compare the results
+static bool bench_verify_trial(uint8_t op, uint32_t* seed, bench_state_t* start, bench_state_t* ref,
+                               bench_state_t* res) {
+    bench_random_bus(seed);
+    bench_random_cpu(seed, (uint16_t)bench_random(seed));
+    ram[cpu.PC] = op;
+    cpu.data = op;
+    bench_save_state(start, 0);
+
+    uint32_t cycles = 0;
+    do {
+        cycles += mos6502cpu_exec_tick(&cpu, &bus);
+    } while (!cpu.sync);
+    bench_save_state(ref, cycles);
+
+    bench_load_state(start);
+    cycles = mos6502cpu_exec(&cpu, &bus);
+    bench_save_state(res, cycles);
+
+    if (!bench_compare_state(ref, res)) {
+        printf("$%02X  %-16s  mismatch\n", op, bench_opcode_names[op]);
+        bench_print_state("start", start);
+        bench_print_state("tick", ref);
+        bench_print_state("exec", res);
+        return false;
+    }
+    return true;
+}
+
+static int bench_verify(int only_opcode, uint32_t num_trials) {
+    static bench_state_t start, ref, res;
+    uint32_t seed = 0x6502;
+    int num_failed = 0;
+    for (int op = 0; op < 256; op++) {
+        if ((only_opcode >= 0 && only_opcode != op) || bench_is_jam((uint8_t)op)) {
+            continue;
+        }
+        for (uint32_t i = 0; i < num_trials; i++) {
+            if (!bench_verify_trial((uint8_t)op, &seed, &start, &ref, &res)) {
+                num_failed++;
+                break;
+            }
+        }
+    }
+    printf("verify: %d opcodes failed\n", num_failed);
+    return num_failed ? 1 : 0;
+}
+
+#ifdef MOS6502CPU_EXEC_CACHED
+// Run instructions with mos6502cpu_tick() like mos6502cpu_exec_cached() does: until
+// num_cycles have passed or an instruction accessed I/O, also stops at JAM
+static uint32_t bench_exec_reference(uint32_t num_cycles) {
+    const uint32_t io_accesses = bus.io_accesses;
+    uint32_t cycles = 0;
+    do {
+        do {
+            cycles += mos6502cpu_exec_tick(&cpu, &bus);
+        } while (!cpu.sync);
+    } while ((cycles < num_cycles) && (bus.io_accesses == io_accesses) && !bench_is_jam(cpu.data));
+    return cycles;
+}
+
+// Write a random loop at pc: random instructions (no JAM and no jumps out of
+// the loop), branches back into the loop and a JMP to the start. A quarter of
+// the absolute operands point into the loop itself for self-modifying code.
+static void bench_random_loop(uint32_t* seed, uint16_t pc) {
+    uint16_t addr = pc;
+    while ((uint16_t)(addr - pc) < BENCH_LOOP_SIZE) {
+        uint8_t op = (uint8_t)bench_random(seed);
+        if (bench_is_jam(op) || (op == 0x00) || (op == 0x20) || (op == 0x40) || (op == 0x60) || (op == 0x4C) ||
+            (op == 0x6C)) {
+            continue;
+        }
+        int len = bench_opcode_length(op);
+        uint32_t r = bench_random(seed);
+        ram[addr] = op;
+        if ((op & 0x1F) == 0x10) {
+            // Branch to a random instruction start before it
+            ram[(uint16_t)(addr + 1)] = (uint8_t)(-(int)(r % ((uint16_t)(addr - pc) + 2)) - 2);
+        } else if ((len == 3) && ((r & 3) == 0)) {
+            uint16_t target = pc + ((r >> 8) % BENCH_LOOP_SIZE);
+            ram[(uint16_t)(addr + 1)] = target & 0xFF;
+            ram[(uint16_t)(addr + 2)] = target >> 8;
+        }
+        addr += len;
+    }
+    ram[addr] = 0x4C;
+    ram[(uint16_t)(addr + 1)] = pc & 0xFF;
+    ram[(uint16_t)(addr + 2)] = pc >> 8;
+}
+
+// Run a random loop through mos6502cpu_exec_cached() and mos6502cpu_tick() and compare after every call
+static bool bench_verify_loop_trial(uint32_t trial, uint32_t* seed, bench_state_t* start, bench_state_t* ref,
+                                    bench_state_t* res) {
+    bench_random_bus(seed);
+    bench_random_cpu(seed, (uint16_t)bench_random(seed));
+    bench_random_loop(seed, cpu.PC);
+    cpu.data = ram[cpu.PC];
+    mem_mark_written(&mem, 0x0000, 0x10000);
+
+    for (uint32_t call = 0; (call < BENCH_LOOP_CALLS) && !bench_is_jam(cpu.data); call++) {
+        uint32_t num_cycles = bench_random(seed) % 200;
+        bench_save_state(start, 0);
+        bench_save_state(ref, bench_exec_reference(num_cycles));
+        // Restoring memory bypasses mem_wr(), but the pages that differ were
+        // written by the reference run, which already invalidated their blocks
+        bench_load_state(start);
+        bench_save_state(res, mos6502cpu_exec_cached(&cpu, &bus, &block_cache, num_cycles));
+        if (bench_is_jam(ref->cpu.data)) {
+            // The reference stops at JAM, mos6502cpu_exec_cached() runs into it
+            break;
+        }
+        if (!bench_compare_state(ref, res)) {
+            printf("loop %u call %u (%u cycles) mismatch\n", trial, call, num_cycles);
+            bench_print_state("start", start);
+            bench_print_state("tick", ref);
+            bench_print_state("block", res);
+            return false;
+        }
+    }
+    return true;
+}
+
+static int bench_verify_loops(uint32_t num_trials) {
+    static bench_state_t start, ref, res;
+    uint32_t seed = 0x6510;
+    int num_failed = 0;
+    mos6502cpu_block_cache_init(&block_cache);
+    for (uint32_t i = 0; i < num_trials; i++) {
+        if (!bench_verify_loop_trial(i, &seed, &start, &ref, &res)) {
+            num_failed++;
+        }
+    }
+    printf("verify: %d block cache loops failed\n", num_failed);
+    return num_failed ? 1 : 0;
+}
+#endif
+
+static void print_usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "\t-c emulated cycles per opcode (default %d)\n"
+            "\t-r timed repetitions per opcode, the fastest is reported (default %d)\n"
+            "\t-o only run a single opcode (e.g. -o 0xA9)\n"
+            "\t-x benchmark mos6502cpu_exec() instead of mos6502cpu_tick()\n"
+            "\t-b benchmark mos6502cpu_exec_cached() (mos6502cpu_bench_blocks only)\n"
+            "\t-v verify mos6502cpu_exec() and mos6502cpu_exec_cached() against mos6502cpu_tick()\n"
+            "\t-j print results as JSON\n"
+            "\t-h show this help\n",
+            argv0, BENCH_DEFAULT_CYCLES, BENCH_DEFAULT_REPETITIONS);
+    exit(1);
+}
+
+static void print_text(const bench_result_t* results, int num_results) {
+    printf("op   name              cyc/instr  ns/cycle  ns/instr\n");
+    for (int i = 0; i < num_results; i++) {
+        const bench_result_t* r = &results[i];
+        printf("$%02X  %-16s  ", r->opcode, bench_opcode_names[r->opcode]);
+        if (r->instructions) {
+            printf("%9.2f  %8.3f  %8.3f\n", (double)r->cycles / r->instructions, (double)r->ns / r->cycles,
+                   (double)r->ns / r->instructions);
+        } else {
+            printf("%9s  %8.3f  %8s\n", "-", (double)r->ns / r->cycles, "-");
+        }
+    }
+}
+
+static void print_json(const bench_result_t* results, int num_results, uint32_t num_cycles, const char* mode) {
+    printf("{\n  \"cpu\": \"mos6502cpu\",\n  \"mode\": \"%s\",\n  \"cycles_per_opcode\": %u,\n  \"opcodes\": [\n",
+           mode, num_cycles);
+    for (int i = 0; i < num_results; i++) {
+        const bench_result_t* r = &results[i];
+        const char* name = bench_opcode_names[r->opcode];
+        bool undocumented = (name[0] == '*');
+        printf("    {\"opcode\": %u, \"name\": \"%s\", \"undocumented\": %s, \"cycles\": %llu, \"instructions\": %llu, ",
+               r->opcode, undocumented ? name + 1 : name, undocumented ? "true" : "false",
+               (unsigned long long)r->cycles, (unsigned long long)r->instructions);
+        printf("\"ns\": %llu, \"ns_per_cycle\": %.4f, ", (unsigned long long)r->ns, (double)r->ns / r->cycles);
+        if (r->instructions) {
+            printf("\"ns_per_instruction\": %.4f}", (double)r->ns / r->instructions);
+        } else {
+            printf("\"ns_per_instruction\": null}");
+        }
+        printf("%s\n", (i + 1 < num_results) ? "," : "");
+    }
+    printf("  ]\n}\n");
+}
+
+int main(int argc, char* const argv[]) {
+    uint32_t num_cycles = BENCH_DEFAULT_CYCLES;
+    uint32_t repetitions = BENCH_DEFAULT_REPETITIONS;
+    int only_opcode = -1;
+    bool json = false;
+    const char* mode = "tick";
+    bool verify = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:r:o:xbvjh")) != -1) {
+        switch (opt) {
+            case 'c':
+                num_cycles = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                repetitions = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                only_opcode = (int)strtol(optarg, NULL, 0) & 0xFF;
+                break;
+            case 'x':
+                mode = "exec";
+                break;
+#ifdef MOS6502CPU_EXEC_CACHED
+            case 'b':
+                mode = "block";
+                break;
+#endif
+            case 'v':
+                verify = true;
+                break;
+            case 'j':
+                json = true;
+                break;
+            case 'h':
+            default:
+                print_usage(argv[0]);
+                break;
+        }
+    }
+    if (num_cycles == 0 || repetitions == 0) {
+        print_usage(argv[0]);
+    }
+
+    mem_init(&mem);
+    mem_map_ram(&mem, 0, 0x0000, 0x10000, ram);
+
+    if (verify) {
+        int res = bench_verify(only_opcode, BENCH_DEFAULT_VERIFY_TRIALS);
+#ifdef MOS6502CPU_EXEC_CACHED
+        res |= bench_verify_loops(BENCH_LOOP_TRIALS);
+#endif
+        return res;
+    }
+    mos6502cpu_bus_init(&bus, &(mos6502cpu_bus_desc_t){.mem = &mem, .io_cb = bench_io});
+
+    static bench_result_t results[256];
+    int num_results = 0;
+    for (int op = 0; op < 256; op++) {
+        if (only_opcode < 0 || only_opcode == op) {
+            if (!strcmp(mode, "exec")) {
+                results[num_results++] = bench_opcode_exec((uint8_t)op, num_cycles, repetitions);
+#ifdef MOS6502CPU_EXEC_CACHED
+            } else if (!strcmp(mode, "block")) {
+                results[num_results++] = bench_opcode_cached((uint8_t)op, num_cycles, repetitions);
+#endif
+            } else {
+                results[num_results++] = bench_opcode((uint8_t)op, num_cycles, repetitions);
+            }
+        }
+    }
+
+    if (json) {
+        print_json(results, num_results, num_cycles, mode);
+    } else {
+        print_text(results, num_results);
+        uint64_t total_ns = 0, total_cycles = 0;
+        for (int i = 0; i < num_results; i++) {
+            total_ns += results[i].ns;
+            total_cycles += results[i].cycles;
+        }
+        printf("total: %llu cycles, %.3f ns/cycle\n", (unsigned long long)total_cycles,
+               (double)total_ns / total_cycles);
+    }
+    return 0;
+}
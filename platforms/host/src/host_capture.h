@@ -0,0 +1,212 @@
+#pragma once
+
+// host_capture.h
+//
+// Streams emulated frames to a file or stdout as Y4M or raw PPM video. The
+// emulation thread only copies the packed 4bpp framebuffer into a bounded
+// ring, a worker thread expands it through the system palette and writes
+// it out. Frames that arrive while the ring is full are dropped and counted.
+//
+// ## zlib/libpng license
+//
+// Copyright (c) 2023 Veselin Sladkov
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//     1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software in a
+//     product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//     2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//     3. This notice may not be removed or altered from any source
+//     distribution.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define HOST_CAPTURE_Y4M (0)  // YUV4MPEG2 stream, 4:4:4 BT.601 limited range
+#define HOST_CAPTURE_PPM (1)  // Concatenated binary PPM (P6) images
+
+#define HOST_CAPTURE_DEFAULT_SLOTS (32)
+
+typedef struct {
+    const char* path;         // Output file, "-" for stdout
+    uint8_t format;           // HOST_CAPTURE_Y4M or HOST_CAPTURE_PPM
+    int width, height;        // Frame size in pixels, two pixels per framebuffer byte
+    const uint32_t* palette;  // 16 RGBA8() colors for the 4bpp pixel values
+    uint32_t fps_num;         // Frame rate as a fraction for the Y4M header
+    uint32_t fps_den;
+    uint32_t num_slots;  // Frames the ring can hold (default HOST_CAPTURE_DEFAULT_SLOTS)
+} host_capture_desc_t;
+
+typedef struct {
+    FILE* out;
+    uint8_t format;
+    int width, height;
+    uint8_t rgb[16][3];  // Palette as R, G, B
+    uint8_t yuv[16][3];  // Palette as Y, Cb, Cr
+    uint32_t fps_num, fps_den;
+
+    // Ring of packed 4bpp frames, head and tail count frames in and out
+    uint8_t* slots;
+    uint8_t* expanded;  // The worker's RGB or YCbCr copy of the frame it writes
+    size_t frame_size;
+    uint32_t num_slots;
+    uint32_t head;
+    uint32_t tail;
+    bool done;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+
+    uint32_t frames_dropped;  // Ring was full when host_capture_frame() was called
+    uint32_t frames_written;
+    bool write_error;
+} host_capture_t;
+
+// Expand one packed 4bpp frame and write it out
+static void _host_capture_write(host_capture_t* cap, const uint8_t* frame, uint8_t* out) {
+    size_t num_pixels = (size_t)cap->width * cap->height;
+    size_t size = num_pixels * 3;
+    if (cap->format == HOST_CAPTURE_Y4M) {
+        uint8_t* y = out;
+        uint8_t* u = y + num_pixels;
+        uint8_t* v = u + num_pixels;
+        for (size_t i = 0; i < num_pixels; i++) {
+            uint8_t c = (i & 1) ? (frame[i / 2] & 0x0F) : (frame[i / 2] >> 4);
+            y[i] = cap->yuv[c][0];
+            u[i] = cap->yuv[c][1];
+            v[i] = cap->yuv[c][2];
+        }
+        cap->write_error |= fputs("FRAME\n", cap->out) < 0;
+    } else {
+        for (size_t i = 0; i < num_pixels; i++) {
+            uint8_t c = (i & 1) ? (frame[i / 2] & 0x0F) : (frame[i / 2] >> 4);
+            memcpy(&out[i * 3], cap->rgb[c], 3);
+        }
+        cap->write_error |= fprintf(cap->out, "P6\n%d %d\n255\n", cap->width, cap->height) < 0;
+    }
+    cap->write_error |= fwrite(out, 1, size, cap->out) != size;
+}
+
+static void* _host_capture_worker(void* arg) {
+    host_capture_t* cap = (host_capture_t*)arg;
+    pthread_mutex_lock(&cap->lock);
+    for (;;) {
+        while ((cap->head == cap->tail) && !cap->done) {
+            pthread_cond_wait(&cap->cond, &cap->lock);
+        }
+        if (cap->head == cap->tail) {
+            break;
+        }
+        // The slot stays owned by the worker until tail moves past it
+        const uint8_t* frame = &cap->slots[(cap->tail % cap->num_slots) * cap->frame_size];
+        pthread_mutex_unlock(&cap->lock);
+        _host_capture_write(cap, frame, cap->expanded);
+        pthread_mutex_lock(&cap->lock);
+        cap->tail++;
+        cap->frames_written++;
+    }
+    pthread_mutex_unlock(&cap->lock);
+    return NULL;
+}
+
+// Free the buffers and close the output
+static void _host_capture_free(host_capture_t* cap) {
+    free(cap->slots);
+    free(cap->expanded);
+    cap->slots = 0;
+    cap->expanded = 0;
+    if (cap->out != stdout) {
+        cap->write_error |= fclose(cap->out) != 0;
+    }
+}
+
+// Open the output and start the worker thread, returns false on failure
+static inline bool host_capture_open(host_capture_t* cap, const host_capture_desc_t* desc) {
+    memset(cap, 0, sizeof(host_capture_t));
+    cap->out = strcmp(desc->path, "-") ? fopen(desc->path, "wb") : stdout;
+    if (!cap->out) {
+        fprintf(stderr, "Failed to open file for writing: %s\n", desc->path);
+        return false;
+    }
+    cap->format = desc->format;
+    cap->width = desc->width;
+    cap->height = desc->height;
+    cap->fps_num = desc->fps_num;
+    cap->fps_den = desc->fps_den;
+    for (int c = 0; c < 16; c++) {
+        float r = (float)((desc->palette[c] >> 16) & 0xFF);
+        float g = (float)((desc->palette[c] >> 8) & 0xFF);
+        float b = (float)(desc->palette[c] & 0xFF);
+        cap->rgb[c][0] = (uint8_t)r;
+        cap->rgb[c][1] = (uint8_t)g;
+        cap->rgb[c][2] = (uint8_t)b;
+        cap->yuv[c][0] = (uint8_t)(16.5f + (65.738f * r + 129.057f * g + 25.064f * b) / 256.0f);
+        cap->yuv[c][1] = (uint8_t)(128.5f + (-37.945f * r - 74.494f * g + 112.439f * b) / 256.0f);
+        cap->yuv[c][2] = (uint8_t)(128.5f + (112.439f * r - 94.154f * g - 18.285f * b) / 256.0f);
+    }
+    cap->frame_size = (size_t)cap->width * cap->height / 2;
+    cap->num_slots = desc->num_slots ? desc->num_slots : HOST_CAPTURE_DEFAULT_SLOTS;
+    cap->slots = malloc(cap->frame_size * cap->num_slots);
+    cap->expanded = malloc((size_t)cap->width * cap->height * 3);
+    if (!cap->slots || !cap->expanded) {
+        fprintf(stderr, "Failed to allocate the capture buffers\n");
+        _host_capture_free(cap);
+        return false;
+    }
+    if (cap->format == HOST_CAPTURE_Y4M) {
+        fprintf(cap->out, "YUV4MPEG2 W%d H%d F%u:%u Ip A1:1 C444\n", cap->width, cap->height, cap->fps_num,
+                cap->fps_den);
+    }
+    pthread_mutex_init(&cap->lock, NULL);
+    pthread_cond_init(&cap->cond, NULL);
+    if (pthread_create(&cap->thread, NULL, _host_capture_worker, cap)) {
+        fprintf(stderr, "Failed to start the capture thread\n");
+        pthread_cond_destroy(&cap->cond);
+        pthread_mutex_destroy(&cap->lock);
+        _host_capture_free(cap);
+        return false;
+    }
+    return true;
+}
+
+// Queue a packed 4bpp frame, returns false if the ring is full and the frame was dropped
+static inline bool host_capture_frame(host_capture_t* cap, const uint8_t* fb) {
+    pthread_mutex_lock(&cap->lock);
+    bool full = (cap->head - cap->tail) == cap->num_slots;
+    pthread_mutex_unlock(&cap->lock);
+    if (full) {
+        cap->frames_dropped++;
+        return false;
+    }
+    // Only the emulation thread moves head, the slot is free until then
+    memcpy(&cap->slots[(cap->head % cap->num_slots) * cap->frame_size], fb, cap->frame_size);
+    pthread_mutex_lock(&cap->lock);
+    cap->head++;
+    pthread_cond_signal(&cap->cond);
+    pthread_mutex_unlock(&cap->lock);
+    return true;
+}
+
+// Write out the queued frames, stop the worker thread and close the output, returns false on write errors
+static inline bool host_capture_close(host_capture_t* cap) {
+    pthread_mutex_lock(&cap->lock);
+    cap->done = true;
+    pthread_cond_signal(&cap->cond);
+    pthread_mutex_unlock(&cap->lock);
+    pthread_join(cap->thread, NULL);
+    pthread_cond_destroy(&cap->cond);
+    pthread_mutex_destroy(&cap->lock);
+    cap->write_error |= fflush(cap->out) != 0;
+    _host_capture_free(cap);
+    return !cap->write_error;
+}
@@ -0,0 +1,88 @@
+# Runs apple2e_batch on a manifest with more jobs than its first allocation (64) holds.
+#
+# cmake -DBATCH=<apple2e_batch> -DWORK_DIR=<dir> -P apple2e_batch_test.cmake
+#
+# The ROM is generated: NOPs everywhere, so the reset vector is $EAEA, and at
+# $EAEA a loop that reads block 0 of the ProDOS hard disk onto the low-res
+# screen at $0400. Every job that got the right disk image has the hash of a
+# one-job run of that image. CMake strings can't hold zero bytes, the program
+# makes its zeros with INX.
+
+if(NOT BATCH OR NOT WORK_DIR)
+	message(FATAL_ERROR "BATCH and WORK_DIR must be set")
+endif()
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+function(repeat_byte out byte count)
+	string(ASCII ${byte} char)
+	string(REPEAT "${char}" ${count} bytes)
+	set(${out} "${bytes}" PARENT_SCOPE)
+endfunction()
+
+# LDX #$FF, INX, then the READ parameters: command 1, unit $70, buffer $0400, block 0
+string(ASCII
+	162 255 232
+	169 1 133 66
+	169 112 133 67
+	134 68 169 4 133 69
+	134 70 134 71
+	169 101 141 247 192
+	76 4 235
+	program)
+string(LENGTH "${program}" program_size)
+repeat_byte(head 234 10986)
+math(EXPR tail_size "16384 - 10986 - ${program_size}")
+repeat_byte(tail 234 ${tail_size})
+file(WRITE ${WORK_DIR}/rom.bin "${head}${program}${tail}")
+repeat_byte(character_rom 234 4096)
+file(WRITE ${WORK_DIR}/chr.bin "${character_rom}")
+repeat_byte(nib 234 209440)
+file(WRITE ${WORK_DIR}/a.nib "${nib}")
+repeat_byte(po 66 1024)
+file(WRITE ${WORK_DIR}/b.po "${po}")
+repeat_byte(po 67 1024)
+file(WRITE ${WORK_DIR}/c.po "${po}")
+
+set(disks a.nib b.po c.po -)
+set(run_args -r ${WORK_DIR}/rom.bin -c ${WORK_DIR}/chr.bin -j 3)
+
+# One job per disk for the reference hashes
+set(manifest "")
+foreach(disk ${disks})
+	string(APPEND manifest "apple2e ${disk} - 10 -\n")
+endforeach()
+file(WRITE ${WORK_DIR}/reference.txt "${manifest}")
+execute_process(COMMAND ${BATCH} ${run_args} ${WORK_DIR}/reference.txt
+	OUTPUT_VARIABLE json RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+	message(FATAL_ERROR "reference run failed (${result}):\n${json}")
+endif()
+foreach(disk ${disks})
+	if(disk STREQUAL "-")
+		set(pattern "\"disk\": null,[^\n]*\"hash\": \"([0-9a-f]+)\"")
+	else()
+		set(pattern "\"disk\": \"[^\"]*${disk}\",[^\n]*\"hash\": \"([0-9a-f]+)\"")
+	endif()
+	if(NOT json MATCHES "${pattern}")
+		message(FATAL_ERROR "no hash for ${disk}:\n${json}")
+	endif()
+	set(hash_${disk} ${CMAKE_MATCH_1})
+endforeach()
+if(hash_b.po STREQUAL hash_c.po)
+	message(FATAL_ERROR "the ROM doesn't tell the disk images apart")
+endif()
+
+# 200 jobs expecting those hashes, the runner exits with 1 if one differs
+set(manifest "")
+foreach(i RANGE 199)
+	math(EXPR index "${i} % 4")
+	list(GET disks ${index} disk)
+	string(APPEND manifest "apple2e ${disk} - 10 ${hash_${disk}}\n")
+endforeach()
+file(WRITE ${WORK_DIR}/manifest.txt "${manifest}")
+execute_process(COMMAND ${BATCH} ${run_args} ${WORK_DIR}/manifest.txt
+	OUTPUT_VARIABLE json RESULT_VARIABLE result)
+if(NOT result EQUAL 0 OR NOT json MATCHES "\"jobs\": 200, \"pass\": 200,")
+	message(FATAL_ERROR "200 job run failed (${result}):\n${json}")
+endif()
@@ -0,0 +1,499 @@
+// apple2e.c
+//
+// Headless Apple //e runner for desktop hosts. Boots the portable core from
+// ROM and disk image files and reports emulation throughput.
+//
+// ## zlib/libpng license
+//
+// Copyright (c) 2023 Veselin Sladkov
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//     1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software in a
+//     product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//     2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//     3. This notice may not be removed or altered from any source
+//     distribution.
+
+#define CHIPS_IMPL
+
+#define MEM_PAGE_SHIFT (9U)
+#define MEM_PAGE_GENERATIONS
+// Delta snapshots, see -S
+#define MEM_WRITE_WATCH
+// Rewind history, see -R
+#define MEM_WRITE_HOOK
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "host.h"
+#include "host_capture.h"
+
+#include "chips/chips_common.h"
+#include "chips/mos6502cpu.h"
+#include "chips/beeper.h"
+#include "chips/kbd.h"
+#include "chips/mem.h"
+#include "chips/mos6502cpu_exec.h"
+#include "chips/clk.h"
+#include "devices/apple2_lc.h"
+#include "devices/disk2_fdd.h"
+#include "devices/disk2_fdc.h"
+#include "devices/apple2_fdc_rom.h"
+#include "devices/prodos_hdd.h"
+#include "devices/prodos_hdc.h"
+#include "devices/prodos_hdc_rom.h"
+
+// Disks are inserted from the command line after apple2e_init()
+uint8_t* const apple2_nib_images[] = {};
+uint8_t* apple2_po_images[] = {};
+uint32_t apple2_po_image_sizes[] = {};
+char* apple2_msc_images[] = {};
+
+#include "systems/apple2e.h"
+#include "systems/apple2e_rewind.h"
+#include "systems/apple2e_input.h"
+
+#define APPLE2E_TICKS_PER_FRAME (17030)
+#define APPLE2E_DEFAULT_FRAMES  (600)
+#define APPLE2E_DEFAULT_REWIND_KB (1024)
+
+static apple2e_t apple2e;
+static mos6502cpu_block_cache_t block_cache;
+
+// Base snapshot the -S deltas are applied onto, and a full snapshot at the end to check it against
+static apple2e_t delta_base;
+static apple2e_t delta_check;
+static union {
+    apple2e_delta_t header;
+    uint8_t bytes[sizeof(apple2e_t)];
+} delta_buf;
+
+// Compare two snapshots without the parts apple2e_load_snapshot() rebuilds
+static bool snapshots_equal(const apple2e_t* a, const apple2e_t* b) {
+    const size_t glyphs_end = offsetof(apple2e_t, glyphs) + sizeof(a->glyphs);
+    return !memcmp(a, b, offsetof(apple2e_t, page_fb)) &&
+           !memcmp(&a->surface, &b->surface, offsetof(apple2e_t, glyphs) - offsetof(apple2e_t, surface)) &&
+           !memcmp((const uint8_t*)a + glyphs_end, (const uint8_t*)b + glyphs_end, sizeof(apple2e_t) - glyphs_end);
+}
+
+static void print_usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s -r rom_file -c character_rom_file [options]\n"
+            "\t-r Apple //e ROM image (16 KB, $C000-$FFFF)\n"
+            "\t-c character ROM image (4 KB)\n"
+            "\t-k keyboard ROM image (2 KB, optional)\n"
+            "\t-d Disk II .nib image for drive 1 (optional)\n"
+            "\t-H ProDOS .hdv/.po hard disk image (optional)\n"
+            "\t-n number of frames to run (default %d)\n"
+            "\t-i run instruction-granular instead of cycle-stepped\n"
+            "\t-b run predecoded blocks from a block cache\n"
+            "\t-t accelerate while loading, skip screen updates while a disk is busy\n"
+            "\t-s render each scanline when the beam reaches it (included in the tick time)\n"
+            "\t-G record the frame hashes to a golden file, one per line\n"
+            "\t-g compare the frame hashes against a golden file recorded with -G\n"
+            "\t-y stream every frame to a Y4M file (- for stdout)\n"
+            "\t-p stream every frame to a file of concatenated PPM images (- for stdout)\n"
+            "\t-S take a delta snapshot every n frames and check them against a full snapshot at the end\n"
+            "\t-R capture every n frames into a rewind history, then rewind as far as it goes and replay\n"
+            "\t-M rewind history budget in KB (default %d)\n"
+            "\t-P replay an input recording at the system_ticks it was recorded at (not with -R)\n"
+            "\t-h show this help\n",
+            argv0, APPLE2E_DEFAULT_FRAMES, APPLE2E_DEFAULT_REWIND_KB);
+    exit(1);
+}
+
+static uint8_t* load_rom(const char* path, size_t expected_size) {
+    size_t size = 0;
+    uint8_t* data = host_load_file(path, &size);
+    if (data && size != expected_size) {
+        fprintf(stderr, "%s: expected %zu bytes, got %zu\n", path, expected_size, size);
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+int main(int argc, char* const argv[]) {
+    const char *rom_file = NULL, *character_rom_file = NULL, *keyboard_rom_file = NULL;
+    const char *nib_file = NULL, *hdv_file = NULL;
+    const char *record_file = NULL, *golden_file = NULL, *capture_file = NULL, *input_file = NULL;
+    uint8_t capture_format = HOST_CAPTURE_Y4M;
+    uint32_t num_frames = APPLE2E_DEFAULT_FRAMES;
+    uint8_t exec_mode = APPLE2E_EXEC_MODE_CYCLE;
+    bool turbo = false;
+    bool scanline_render = false;
+    uint32_t delta_frames = 0;
+    uint32_t rewind_frames = 0;
+    uint32_t rewind_kb = APPLE2E_DEFAULT_REWIND_KB;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:c:k:d:H:n:ibtsG:g:y:p:S:R:M:P:h")) != -1) {
+        switch (opt) {
+            case 'r':
+                rom_file = optarg;
+                break;
+            case 'c':
+                character_rom_file = optarg;
+                break;
+            case 'k':
+                keyboard_rom_file = optarg;
+                break;
+            case 'd':
+                nib_file = optarg;
+                break;
+            case 'H':
+                hdv_file = optarg;
+                break;
+            case 'n':
+                num_frames = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'i':
+                exec_mode = APPLE2E_EXEC_MODE_INSTRUCTION;
+                break;
+            case 'b':
+                exec_mode = APPLE2E_EXEC_MODE_BLOCK_CACHE;
+                break;
+            case 't':
+                turbo = true;
+                break;
+            case 's':
+                scanline_render = true;
+                break;
+            case 'G':
+                record_file = optarg;
+                break;
+            case 'g':
+                golden_file = optarg;
+                break;
+            case 'y':
+                capture_file = optarg;
+                capture_format = HOST_CAPTURE_Y4M;
+                break;
+            case 'p':
+                capture_file = optarg;
+                capture_format = HOST_CAPTURE_PPM;
+                break;
+            case 'S':
+                delta_frames = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'R':
+                rewind_frames = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'M':
+                rewind_kb = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'P':
+                input_file = optarg;
+                break;
+            case 'h':
+            default:
+                print_usage(argv[0]);
+                break;
+        }
+    }
+
+    // The rewind replay runs the frames again without the recorded inputs
+    if (!rom_file || !character_rom_file || num_frames == 0 || (input_file && rewind_frames)) {
+        print_usage(argv[0]);
+    }
+
+    uint8_t* rom = load_rom(rom_file, 0x4000);
+    uint8_t* character_rom = load_rom(character_rom_file, 0x1000);
+    uint8_t* keyboard_rom = keyboard_rom_file ? load_rom(keyboard_rom_file, 0x800) : calloc(1, 0x800);
+    uint8_t* nib_image = nib_file ? load_rom(nib_file, DISK2_FDD_NIB_IMAGE_SIZE) : NULL;
+    size_t input_size = 0;
+    uint8_t* input = input_file ? host_load_file(input_file, &input_size) : NULL;
+    if (!rom || !character_rom || !keyboard_rom || (nib_file && !nib_image) || (input_file && !input)) {
+        return 1;
+    }
+
+    apple2e_init_tables();
+    apple2e_init(&apple2e, &(apple2e_desc_t){
+                               .fdc_enabled = true,
+                               .hdc_enabled = true,
+                               .roms =
+                                   {
+                                       .rom = {.ptr = rom, .size = 0x4000},
+                                       .character_rom = {.ptr = character_rom, .size = 0x1000},
+                                       .keyboard_rom = {.ptr = keyboard_rom, .size = 0x800},
+                                       .fdc_rom = {.ptr = apple2_fdc_rom, .size = sizeof(apple2_fdc_rom)},
+                                       .hdc_rom = {.ptr = prodos_hdc_rom, .size = sizeof(prodos_hdc_rom)},
+                                   },
+                           });
+    FILE* record = record_file ? fopen(record_file, "w") : NULL;
+    FILE* golden = golden_file ? fopen(golden_file, "r") : NULL;
+    if ((record_file && !record) || (golden_file && !golden)) {
+        perror(record_file && !record ? record_file : golden_file);
+        return 1;
+    }
+
+    // The report goes to stderr when the frames go to stdout
+    FILE* report = stdout;
+    static host_capture_t capture;
+    if (capture_file) {
+        if (!host_capture_open(&capture, &(host_capture_desc_t){
+                                             .path = capture_file,
+                                             .format = capture_format,
+                                             .width = APPLE2E_SCREEN_WIDTH,
+                                             .height = APPLE2E_SCREEN_HEIGHT,
+                                             .palette = apple2e_palette,
+                                             .fps_num = APPLE2E_FREQUENCY,
+                                             .fps_den = APPLE2E_TICKS_PER_FRAME,
+                                         })) {
+            return 1;
+        }
+        if (!strcmp(capture_file, "-")) {
+            report = stderr;
+        }
+    }
+
+    if (nib_image) {
+        disk2_fdd_insert_disk(&apple2e.fdc.fdd[0], nib_image);
+    }
+    if (hdv_file && !prodos_hdd_insert_disk_msc(&apple2e.hdc.hdd[0], hdv_file)) {
+        return 1;
+    }
+    apple2e_set_block_cache(&apple2e, &block_cache);
+    apple2e_set_exec_mode(&apple2e, exec_mode);
+    apple2e_set_scanline_render(&apple2e, scanline_render);
+    static apple2e_input_player_t play;
+    if (input && !apple2e_input_play_init(&play, &apple2e, &(apple2e_input_desc_t){
+                                                              .stream = {.ptr = input, .size = input_size},
+                                                          })) {
+        fprintf(stderr, "%s: not an input recording of this execution mode\n", input_file);
+        return 1;
+    }
+
+    uint64_t tick_ns = 0;
+    uint64_t screen_ns = 0;
+    uint64_t num_ticks = 0;
+    uint32_t num_screen_updates = 0;
+    // Frames up to and including the last one that was loading, and the host time they took
+    uint32_t boot_frames = 0;
+    uint64_t boot_ns = 0;
+    // Frames with the same hash as the one before, a frontend doesn't need to present them
+    uint32_t unchanged_frames = 0;
+    uint64_t last_hash = 0;
+    // First frame whose hash differs from the golden file, or num_frames
+    uint32_t golden_mismatch = num_frames;
+    // Delta snapshots taken, their total and largest size and the host time apple2e_save_delta() took
+    uint32_t num_deltas = 0;
+    uint64_t delta_bytes = 0;
+    uint32_t delta_max_bytes = 0;
+    uint64_t delta_ns = 0;
+    bool delta_applied = true;
+    uint64_t snapshot_ns = 0;
+    if (delta_frames) {
+        uint64_t t0 = host_time_ns();
+        apple2e_save_snapshot(&apple2e, &delta_base);
+        snapshot_ns += host_time_ns() - t0;
+    }
+    // Rewind captures, the host time they took, and the ticks and hash of each frame to replay against
+    static apple2e_rewind_t rewind;
+    uint8_t* rewind_buffer = NULL;
+    uint64_t* frame_end_ticks = NULL;
+    uint64_t* frame_hashes = NULL;
+    uint32_t num_captures = 0;
+    uint64_t capture_ns = 0;
+    if (rewind_frames) {
+        rewind_buffer = malloc((size_t)rewind_kb * 1024);
+        frame_end_ticks = malloc(num_frames * sizeof(uint64_t));
+        frame_hashes = malloc(num_frames * sizeof(uint64_t));
+        if (!rewind_buffer || !frame_end_ticks || !frame_hashes ||
+            !apple2e_rewind_init(&rewind, &apple2e, &(apple2e_rewind_desc_t){
+                                                        .buffer = {.ptr = rewind_buffer, .size = rewind_kb * 1024},
+                                                        .interval = rewind_frames,
+                                                    })) {
+            fprintf(stderr, "rewind budget must be at least %u bytes\n", apple2e_rewind_min_size());
+            return 1;
+        }
+    }
+
+    for (uint32_t frame = 0; frame < num_frames; frame++) {
+        // Same policy as the rp2040 main loop, frames that are loading are not shown and have no audio
+        bool loading = turbo && apple2e_is_loading(&apple2e);
+        apple2e_set_audio_muted(&apple2e, loading);
+
+        // Instruction mode can overshoot a frame by a few ticks, catch up in the next one
+        uint32_t frame_ticks = (uint32_t)((frame + 1) * (uint64_t)APPLE2E_TICKS_PER_FRAME - num_ticks);
+        uint64_t t0 = host_time_ns();
+        if (input) {
+            num_ticks += apple2e_input_play_exec_ticks(&play, frame_ticks);
+        } else {
+            num_ticks += apple2e_exec_ticks(&apple2e, frame_ticks);
+        }
+        uint64_t t1 = host_time_ns();
+        if (!loading || !apple2e_is_loading(&apple2e)) {
+            apple2e_screen_update(&apple2e);
+            num_screen_updates++;
+        }
+        uint64_t t2 = host_time_ns();
+
+        if (capture_file) {
+            host_capture_frame(&capture, apple2e.fb);
+        }
+
+        uint64_t hash = apple2e_frame_hash(&apple2e);
+        if ((frame > 0) && (hash == last_hash)) {
+            unchanged_frames++;
+        }
+        last_hash = hash;
+        if (record) {
+            fprintf(record, "%016llx\n", (unsigned long long)hash);
+        }
+        if (golden && (golden_mismatch == num_frames)) {
+            unsigned long long golden_hash;
+            if ((fscanf(golden, "%llx", &golden_hash) != 1) || (golden_hash != hash)) {
+                golden_mismatch = frame;
+            }
+        }
+
+        if (delta_frames && ((((frame + 1) % delta_frames) == 0) || (frame + 1 == num_frames))) {
+            uint64_t t3 = host_time_ns();
+            uint32_t size = apple2e_save_delta(&apple2e, &delta_buf, sizeof(delta_buf));
+            delta_ns += host_time_ns() - t3;
+            delta_applied &= (size > 0) && apple2e_apply_delta(&delta_base, &delta_buf, size);
+            num_deltas++;
+            delta_bytes += size;
+            delta_max_bytes = size > delta_max_bytes ? size : delta_max_bytes;
+        }
+
+        if (rewind_frames) {
+            frame_end_ticks[frame] = num_ticks;
+            frame_hashes[frame] = hash;
+            uint64_t t3 = host_time_ns();
+            if (apple2e_rewind_frame(&rewind)) {
+                capture_ns += host_time_ns() - t3;
+                num_captures++;
+            }
+        }
+
+        tick_ns += t1 - t0;
+        screen_ns += t2 - t1;
+        if (loading) {
+            boot_frames = frame + 1;
+            boot_ns = tick_ns + screen_ns;
+        }
+    }
+
+    uint64_t total_ns = tick_ns + screen_ns;
+    static const char *exec_mode_names[] = {"cycle mode", "instruction mode", "block cache mode"};
+    fprintf(report, "apple2e: %u frames, %llu ticks in %.1f ms (%s)\n", num_frames, (unsigned long long)num_ticks,
+            total_ns / 1e6, exec_mode_names[apple2e.exec_mode]);
+    fprintf(report, "  emulated speed: %.2f MHz (%.2fx realtime)\n", num_ticks * 1e3 / total_ns,
+            (num_ticks * 1e9 / total_ns) / APPLE2E_FREQUENCY);
+    fprintf(report, "  host time:      %.2f ns/cycle (%.2f ns/cycle without screen update)\n",
+            (double)total_ns / num_ticks, (double)tick_ns / num_ticks);
+    fprintf(report, "  screen update:  %.1f us/frame (%u of %u frames shown)\n",
+            num_screen_updates ? screen_ns / 1e3 / num_screen_updates : 0.0, num_screen_updates, num_frames);
+    fprintf(report, "  frame rate:     %.1f fps\n", num_frames * 1e9 / total_ns);
+    fprintf(report, "  frame hashes:   %u of %u frames unchanged, last %016llx\n", unchanged_frames, num_frames,
+            (unsigned long long)last_hash);
+    if (turbo) {
+        // At realtime pacing the loading frames take boot_frames / 60 seconds
+        fprintf(report, "  loading:        %u frames, %.2f s realtime in %.1f ms (%.1fx)\n", boot_frames,
+                boot_frames * (double)APPLE2E_TICKS_PER_FRAME / APPLE2E_FREQUENCY, boot_ns / 1e6,
+                boot_ns ? (boot_frames * (double)APPLE2E_TICKS_PER_FRAME / APPLE2E_FREQUENCY) * 1e9 / boot_ns : 0.0);
+    }
+
+    int result = 0;
+    if (delta_frames) {
+        // The base with all deltas applied must equal a full snapshot of the same moment, before the rewind replay
+        uint64_t t0 = host_time_ns();
+        apple2e_save_snapshot(&apple2e, &delta_check);
+        snapshot_ns += host_time_ns() - t0;
+        bool match = delta_applied && snapshots_equal(&delta_base, &delta_check);
+        fprintf(report, "  delta snapshot: %u every %u frames, %.0f bytes and %.1f us avg, %u bytes max, %s\n",
+                num_deltas, delta_frames, (double)delta_bytes / num_deltas, delta_ns / 1e3 / num_deltas,
+                delta_max_bytes, match ? "applied onto the base they match" : "applied onto the base they DIFFER");
+        fprintf(report, "  full snapshot:  %zu bytes, %.1f us avg\n", sizeof(apple2e_t), snapshot_ns / 1e3 / 2);
+        result = match ? 0 : 1;
+    }
+    if (rewind_frames) {
+        // Go back as far as the history reaches and run the same frames again, they must not differ
+        fprintf(report,
+                "  rewind:         %u captures every %u frames, %.1f us avg, %u entries of %.0f bytes avg in %u KB\n",
+                num_captures, rewind_frames, num_captures ? capture_ns / 1e3 / num_captures : 0.0, rewind.num_entries,
+                rewind.num_entries ? (double)rewind.used / rewind.num_entries : 0.0, rewind_kb);
+        uint32_t oldest = apple2e_rewind_oldest_frame(&rewind);
+        uint64_t t0 = host_time_ns();
+        bool sought = apple2e_rewind_seek(&rewind, oldest);
+        uint64_t seek_ns = host_time_ns() - t0;
+        uint64_t replay_ticks = oldest ? frame_end_ticks[oldest - 1] : 0;
+        uint32_t replay_mismatch = num_frames;
+        for (uint32_t frame = oldest; sought && (frame < num_frames) && (replay_mismatch == num_frames); frame++) {
+            bool loading = turbo && apple2e_is_loading(&apple2e);
+            apple2e_set_audio_muted(&apple2e, loading);
+            uint32_t frame_ticks = (uint32_t)((frame + 1) * (uint64_t)APPLE2E_TICKS_PER_FRAME - replay_ticks);
+            replay_ticks += apple2e_exec_ticks(&apple2e, frame_ticks);
+            if (!loading || !apple2e_is_loading(&apple2e)) {
+                apple2e_screen_update(&apple2e);
+            }
+            if ((replay_ticks != frame_end_ticks[frame]) || (apple2e_frame_hash(&apple2e) != frame_hashes[frame])) {
+                replay_mismatch = frame;
+            }
+        }
+        if (!sought) {
+            fprintf(report, "  rewind replay:  can't go back to frame %u\n", oldest);
+            result = 1;
+        } else if (replay_mismatch < num_frames) {
+            fprintf(report, "  rewind replay:  back to frame %u in %.1f us, frame %u differs\n", oldest, seek_ns / 1e3,
+                    replay_mismatch);
+            result = 1;
+        } else {
+            fprintf(report, "  rewind replay:  back to frame %u in %.1f us, frames %u-%u match\n", oldest,
+                    seek_ns / 1e3, oldest, num_frames - 1);
+        }
+        free(frame_hashes);
+        free(frame_end_ticks);
+        mem_set_write_hook(&apple2e.mem, 0, 0);
+        free(rewind_buffer);
+    }
+    if (input) {
+        fprintf(report, "  input replay:   %u events applied, %u late%s%s\n", play.num_events, play.num_late,
+                apple2e_input_play_done(&play) ? "" : ", more after the last frame",
+                play.error ? ", recording damaged" : "");
+        if (play.num_late || play.error) {
+            result = 1;
+        }
+        free(input);
+    }
+    if (golden) {
+        if (golden_mismatch < num_frames) {
+            fprintf(report, "  golden:         frame %u differs from %s\n", golden_mismatch, golden_file);
+            result = 1;
+        } else {
+            fprintf(report, "  golden:         all %u frames match %s\n", num_frames, golden_file);
+        }
+        fclose(golden);
+    }
+    if (record) {
+        fclose(record);
+    }
+    if (capture_file) {
+        // Wait for the worker to write out the queued frames
+        if (!host_capture_close(&capture)) {
+            fprintf(stderr, "%s: write error\n", capture_file);
+            result = 1;
+        }
+        fprintf(report, "  capture:        %u frames written to %s, %u dropped (ring full)\n", capture.frames_written,
+                capture_file, capture.frames_dropped);
+    }
+
+    apple2e_discard(&apple2e);
+    free(nib_image);
+    free(keyboard_rom);
+    free(character_rom);
+    free(rom);
+    return result;
+}
@@ -0,0 +1,878 @@
+// apple2e_batch.c
+//
+// Headless Apple //e batch runner for regression farms. Runs the jobs of a
+// manifest on a work-stealing pool of worker threads, one emulator instance
+// per worker, and writes the result of each job and the throughput as JSON.
+//
+// The manifest has one job per line, fields separated by whitespace and
+// quoted with "" when they contain spaces, # starts a comment:
+//
+// ~~~
+// # system  disk image               input script  frames  last frame hash
+// apple2e   "Total Replay v5.2.hdv"  -             600     -
+// apple2e   game.nib                 game.txt      1800    5f1c09e2a7d4b318
+// ~~~
+//
+// A .nib disk goes into Disk II drive 1, each job gets its own copy of it.
+// A .hdv or .po image is loaded once and shared by all jobs as a write
+// protected ProDOS hard disk. Relative paths are relative to the manifest.
+// The hash is what apple2e_frame_hash() returns for the last frame, - only
+// reports it.
+//
+// An input script has one event per line, applied before its frame runs:
+//
+// ~~~
+// # frame  event
+// 120      key RETURN          # a character, a name or 0xNN
+// 200      type "BRUN GAME"    # one key every BATCH_TYPE_FRAMES frames
+// 300      button 0 1          # open apple / button 0 pressed
+// 310      paddle 1 255        # paddle 1 position
+// ~~~
+//
+// With -w each job records its input changes with the system_ticks they were
+// applied at (systems/apple2e_input.h). A recording can take the place of the
+// input script in a manifest; it is replayed at the exact ticks instead of at
+// the start of frames, in the execution mode it was recorded in.
+//
+// Each worker starts with a share of the jobs, longest last, and takes them
+// from the end of its own queue. A worker whose queue is empty steals the
+// shortest job from the front of another worker's queue, so the long jobs
+// start first and the short ones fill the gaps at the end.
+//
+// ## zlib/libpng license
+//
+// Copyright (c) 2023 Veselin Sladkov
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//     1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software in a
+//     product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//     2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//     3. This notice may not be removed or altered from any source
+//     distribution.
+
+#define CHIPS_IMPL
+
+#define MEM_PAGE_SHIFT (9U)
+#define MEM_PAGE_GENERATIONS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "host.h"
+
+#include "chips/chips_common.h"
+#include "chips/mos6502cpu.h"
+#include "chips/beeper.h"
+#include "chips/kbd.h"
+#include "chips/mem.h"
+#include "chips/mos6502cpu_exec.h"
+#include "chips/clk.h"
+#include "devices/apple2_lc.h"
+#include "devices/disk2_fdd.h"
+#include "devices/disk2_fdc.h"
+#include "devices/apple2_fdc_rom.h"
+#include "devices/prodos_hdd.h"
+#include "devices/prodos_hdc.h"
+#include "devices/prodos_hdc_rom.h"
+
+// Disks are inserted by each job after apple2e_init()
+uint8_t* const apple2_nib_images[] = {};
+uint8_t* apple2_po_images[] = {};
+uint32_t apple2_po_image_sizes[] = {};
+char* apple2_msc_images[] = {};
+
+#include "systems/apple2e.h"
+#include "systems/apple2e_input.h"
+
+#define BATCH_TICKS_PER_FRAME (17030)
+#define BATCH_TYPE_FRAMES (3)
+#define BATCH_MAX_TOKENS (8)
+#define BATCH_MAX_LINE (1024)
+#define BATCH_MAX_ERROR (128)
+#define BATCH_NO_IMAGE (-1)
+
+typedef struct {
+    uint32_t frame;
+    uint32_t seq;  // Order in the script, events of the same frame are applied in it
+    uint8_t input;  // APPLE2E_INPUT_*
+    uint8_t value;
+} batch_event_t;
+
+typedef enum {
+    BATCH_IMAGE_NONE,
+    BATCH_IMAGE_NIB,
+    BATCH_IMAGE_PO,
+} batch_image_type_t;
+
+// A disk image loaded before the workers start, read-only afterwards
+typedef struct {
+    char* path;
+    uint8_t type;
+    uint8_t* data;
+    size_t size;
+} batch_image_t;
+
+typedef enum {
+    BATCH_STATUS_PASS,
+    BATCH_STATUS_FAIL,
+    BATCH_STATUS_UNCHECKED,
+    BATCH_STATUS_ERROR,
+} batch_status_t;
+
+typedef struct {
+    uint32_t line;
+    char* system;
+    char* disk;
+    char* script;
+    uint32_t num_frames;
+    bool check_hash;
+    uint64_t expected_hash;
+    int32_t image;  // Index in images (which grows while the manifest is read) or BATCH_NO_IMAGE
+    batch_event_t* events;
+    uint32_t num_events;
+    // Input recording to replay instead of events
+    uint8_t* recording;
+    size_t recording_size;
+    // Results
+    uint8_t status;
+    char error[BATCH_MAX_ERROR];
+    uint64_t hash;
+    uint64_t num_ticks;
+    uint64_t ns;
+    uint64_t cpu_ns;
+    uint32_t worker;
+    uint32_t num_inputs;  // Input changes applied
+} batch_job_t;
+
+typedef struct {
+    pthread_t thread;
+    uint32_t index;
+    // Job indices, the owner takes from the tail and thieves from the head
+    pthread_mutex_t lock;
+    uint32_t* queue;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t num_jobs;
+    uint32_t num_stolen;
+    uint64_t cpu_ns;
+    apple2e_t sys;
+    mos6502cpu_block_cache_t block_cache;
+    uint8_t nib_image[DISK2_FDD_NIB_IMAGE_SIZE];
+    // Input recording of the current job, see -w
+    uint8_t* record_buffer;
+    uint32_t record_size;
+} batch_worker_t;
+
+static const char* batch_status_names[] = {"pass", "fail", "unchecked", "error"};
+static const char* batch_exec_mode_names[] = {"cycle", "instruction", "block_cache"};
+
+static batch_job_t* jobs;
+static uint32_t num_jobs;
+static batch_image_t* images;
+static uint32_t num_images;
+static batch_worker_t* workers;
+static uint32_t num_workers;
+// Runnable job indices, shortest first
+static uint32_t* order;
+static uint32_t num_runnable;
+static uint8_t* rom;
+static uint8_t* character_rom;
+static uint8_t* keyboard_rom;
+static uint8_t exec_mode = APPLE2E_EXEC_MODE_CYCLE;
+static bool turbo = false;
+// Directory to write the input recording of each job to, see -w
+static const char* record_dir = NULL;
+
+static void print_usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s -r rom_file -c character_rom_file [options] manifest\n"
+            "\t-r Apple //e ROM image (16 KB, $C000-$FFFF)\n"
+            "\t-c character ROM image (4 KB)\n"
+            "\t-k keyboard ROM image (2 KB, optional)\n"
+            "\t-j number of worker threads (default number of cores)\n"
+            "\t-o write the JSON results to a file instead of stdout\n"
+            "\t-i run instruction-granular instead of cycle-stepped\n"
+            "\t-b run predecoded blocks from a block cache\n"
+            "\t-t skip screen updates while a disk is busy, except for the last frame\n"
+            "\t-w record the input of each job to line<n>.rec in a directory, to replay as input script\n"
+            "\t-s run the manifest on one worker first and report the speedup against it\n"
+            "\t-h show this help\n",
+            argv0);
+    exit(1);
+}
+
+static uint8_t* load_rom(const char* path, size_t expected_size) {
+    size_t size = 0;
+    uint8_t* data = host_load_file(path, &size);
+    if (data && size != expected_size) {
+        fprintf(stderr, "%s: expected %zu bytes, got %zu\n", path, expected_size, size);
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+// Split a line into whitespace separated tokens in place, "" quote a token, # starts a comment
+static int batch_tokenize(char* line, char** tokens, int max_tokens) {
+    int num_tokens = 0;
+    char* p = line;
+    while (num_tokens < max_tokens) {
+        while ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n')) {
+            p++;
+        }
+        if ((*p == 0) || (*p == '#')) {
+            break;
+        }
+        if (*p == '"') {
+            tokens[num_tokens++] = ++p;
+            while (*p && (*p != '"')) {
+                p++;
+            }
+        } else {
+            tokens[num_tokens++] = p;
+            while (*p && (*p != ' ') && (*p != '\t') && (*p != '\r') && (*p != '\n')) {
+                p++;
+            }
+        }
+        if (*p) {
+            *p++ = 0;
+        }
+    }
+    return num_tokens;
+}
+
+// Join a manifest relative path with the directory of the manifest
+static char* batch_path(const char* dir, const char* path) {
+    size_t dir_len = (path[0] == '/') ? 0 : strlen(dir);
+    char* result = malloc(dir_len + strlen(path) + 1);
+    if (result) {
+        memcpy(result, dir, dir_len);
+        strcpy(result + dir_len, path);
+    }
+    return result;
+}
+
+static bool batch_parse_number(const char* token, uint32_t max, uint32_t* value) {
+    char* end;
+    unsigned long v = strtoul(token, &end, 0);
+    if ((end == token) || *end || (v > max)) {
+        return false;
+    }
+    *value = (uint32_t)v;
+    return true;
+}
+
+static bool batch_parse_key(const char* token, uint8_t* code) {
+    static const struct {
+        const char* name;
+        uint8_t code;
+    } names[] = {
+        {"RETURN", 0x0D}, {"ESC", 0x1B},  {"SPACE", 0x20}, {"TAB", 0x09},    {"DELETE", 0x7F},
+        {"LEFT", 0x08},   {"RIGHT", 0x15}, {"UP", 0x0B},    {"DOWN", 0x0A},
+    };
+    if (token[0] && !token[1]) {
+        *code = (uint8_t)token[0] & 0x7F;
+        return true;
+    }
+    for (size_t i = 0; i < CHIPS_ARRAY_SIZE(names); i++) {
+        if (!strcmp(token, names[i].name)) {
+            *code = names[i].code;
+            return true;
+        }
+    }
+    uint32_t value;
+    if (batch_parse_number(token, 0x7F, &value)) {
+        *code = (uint8_t)value;
+        return true;
+    }
+    return false;
+}
+
+static bool batch_add_event(batch_job_t* job, uint32_t* capacity, batch_event_t event) {
+    if (job->num_events == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 64;
+        batch_event_t* events = realloc(job->events, *capacity * sizeof(batch_event_t));
+        if (!events) {
+            return false;
+        }
+        job->events = events;
+    }
+    event.seq = job->num_events;
+    job->events[job->num_events++] = event;
+    return true;
+}
+
+static int batch_compare_events(const void* a, const void* b) {
+    const batch_event_t* ea = (const batch_event_t*)a;
+    const batch_event_t* eb = (const batch_event_t*)b;
+    if (ea->frame != eb->frame) {
+        return ea->frame < eb->frame ? -1 : 1;
+    }
+    return ea->seq < eb->seq ? -1 : (ea->seq > eb->seq);
+}
+
+// Read the input script of a job into its sorted event list, or load it whole if it is an input recording,
+// sets the job error on failure
+static bool batch_load_script(batch_job_t* job) {
+    FILE* f = fopen(job->script, "r");
+    if (!f) {
+        snprintf(job->error, sizeof(job->error), "can't open input script");
+        return false;
+    }
+    char magic[4] = {0};
+    if ((fread(magic, 1, sizeof(magic), f) == sizeof(magic)) && !memcmp(magic, "A2EI", sizeof(magic))) {
+        fclose(f);
+        job->recording = host_load_file(job->script, &job->recording_size);
+        if (!job->recording) {
+            snprintf(job->error, sizeof(job->error), "can't read input recording");
+        }
+        return job->recording != NULL;
+    }
+    rewind(f);
+    char line[BATCH_MAX_LINE];
+    uint32_t line_number = 0;
+    uint32_t capacity = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f)) {
+        line_number++;
+        char* tokens[BATCH_MAX_TOKENS];
+        int num_tokens = batch_tokenize(line, tokens, BATCH_MAX_TOKENS);
+        if (num_tokens == 0) {
+            continue;
+        }
+        batch_event_t event = {0};
+        uint32_t index = 0, value = 0;
+        if ((num_tokens < 3) || !batch_parse_number(tokens[0], UINT32_MAX, &event.frame)) {
+            ok = false;
+        } else if (!strcmp(tokens[1], "key") && (num_tokens == 3)) {
+            event.input = APPLE2E_INPUT_KEY;
+            ok = batch_parse_key(tokens[2], &event.value) && batch_add_event(job, &capacity, event);
+        } else if (!strcmp(tokens[1], "type") && (num_tokens == 3)) {
+            event.input = APPLE2E_INPUT_KEY;
+            for (const char* c = tokens[2]; ok && *c; c++) {
+                event.value = (uint8_t)*c & 0x7F;
+                ok = batch_add_event(job, &capacity, event);
+                event.frame += BATCH_TYPE_FRAMES;
+            }
+        } else if (!strcmp(tokens[1], "button") && (num_tokens == 4)) {
+            ok = batch_parse_number(tokens[2], 2, &index) && batch_parse_number(tokens[3], 1, &value);
+            event.input = APPLE2E_INPUT_BUTTON0 + index;
+        } else if (!strcmp(tokens[1], "paddle") && (num_tokens == 4)) {
+            ok = batch_parse_number(tokens[2], 3, &index) && batch_parse_number(tokens[3], 0xFF, &value);
+            event.input = APPLE2E_INPUT_PADDLE0 + index;
+        } else {
+            ok = false;
+        }
+        if (ok && (event.input != APPLE2E_INPUT_KEY)) {
+            event.value = (uint8_t)value;
+            ok = batch_add_event(job, &capacity, event);
+        }
+    }
+    fclose(f);
+    if (!ok) {
+        snprintf(job->error, sizeof(job->error), "input script line %u: bad event", line_number);
+        return false;
+    }
+    qsort(job->events, job->num_events, sizeof(batch_event_t), batch_compare_events);
+    return true;
+}
+
+static bool batch_has_suffix(const char* path, const char* suffix) {
+    size_t len = strlen(path), suffix_len = strlen(suffix);
+    return (len >= suffix_len) && !strcasecmp(path + len - suffix_len, suffix);
+}
+
+// Load each disk image once, jobs that boot the same image share it, returns its index or BATCH_NO_IMAGE
+static int32_t batch_load_image(batch_job_t* job) {
+    for (uint32_t i = 0; i < num_images; i++) {
+        if (!strcmp(images[i].path, job->disk)) {
+            return images[i].data ? (int32_t)i : BATCH_NO_IMAGE;
+        }
+    }
+    batch_image_t* image = &images[num_images++];
+    image->path = job->disk;
+    if (batch_has_suffix(job->disk, ".nib")) {
+        image->type = BATCH_IMAGE_NIB;
+        image->data = load_rom(job->disk, DISK2_FDD_NIB_IMAGE_SIZE);
+        image->size = DISK2_FDD_NIB_IMAGE_SIZE;
+    } else if (batch_has_suffix(job->disk, ".hdv") || batch_has_suffix(job->disk, ".po")) {
+        image->type = BATCH_IMAGE_PO;
+        image->data = host_load_file(job->disk, &image->size);
+    }
+    return image->data ? (int32_t)(num_images - 1) : BATCH_NO_IMAGE;
+}
+
+// Read the manifest and prepare each job's disk image and input events, returns false on a syntax error
+static bool batch_load_manifest(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    const char* slash = strrchr(path, '/');
+    char* dir = strndup(path, slash ? (size_t)(slash - path + 1) : 0);
+    uint32_t capacity = 0;
+    char line[BATCH_MAX_LINE];
+    uint32_t line_number = 0;
+    bool ok = true;
+    while (ok && dir && fgets(line, sizeof(line), f)) {
+        line_number++;
+        char* tokens[BATCH_MAX_TOKENS];
+        int num_tokens = batch_tokenize(line, tokens, BATCH_MAX_TOKENS);
+        if (num_tokens == 0) {
+            continue;
+        }
+        if (num_jobs == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            // At most one disk image per job
+            batch_job_t* more = realloc(jobs, capacity * sizeof(batch_job_t));
+            batch_image_t* more_images = realloc(images, capacity * sizeof(batch_image_t));
+            if (more) {
+                jobs = more;
+            }
+            if (more_images) {
+                images = more_images;
+            }
+            if (!more || !more_images) {
+                ok = false;
+                break;
+            }
+        }
+        batch_job_t* job = &jobs[num_jobs];
+        memset(job, 0, sizeof(batch_job_t));
+        job->line = line_number;
+        job->image = BATCH_NO_IMAGE;
+        unsigned long long hash = 0;
+        char* end = NULL;
+        ok = (num_tokens == 5) && batch_parse_number(tokens[3], UINT32_MAX, &job->num_frames) &&
+             (job->num_frames > 0);
+        if (ok && strcmp(tokens[4], "-")) {
+            hash = strtoull(tokens[4], &end, 16);
+            ok = (end != tokens[4]) && !*end;
+            job->check_hash = true;
+            job->expected_hash = hash;
+        }
+        if (!ok) {
+            fprintf(stderr, "%s:%u: expected system, disk image, input script, frames and hash\n", path, line_number);
+            break;
+        }
+        job->system = strdup(tokens[0]);
+        job->disk = strcmp(tokens[1], "-") ? batch_path(dir, tokens[1]) : NULL;
+        job->script = strcmp(tokens[2], "-") ? batch_path(dir, tokens[2]) : NULL;
+        num_jobs++;
+
+        if (strcmp(job->system, "apple2e")) {
+            snprintf(job->error, sizeof(job->error), "system not supported by this runner");
+        } else if (job->disk && ((job->image = batch_load_image(job)) == BATCH_NO_IMAGE)) {
+            snprintf(job->error, sizeof(job->error), "can't load disk image, expected .nib, .hdv or .po");
+        } else if (job->script) {
+            batch_load_script(job);
+        }
+        job->status = job->error[0] ? BATCH_STATUS_ERROR : BATCH_STATUS_UNCHECKED;
+    }
+    fclose(f);
+    free(dir);
+    return ok;
+}
+
+static apple2e_desc_t batch_desc(void) {
+    return (apple2e_desc_t){
+        .fdc_enabled = true,
+        .hdc_enabled = true,
+        .roms =
+            {
+                .rom = {.ptr = rom, .size = 0x4000},
+                .character_rom = {.ptr = character_rom, .size = 0x1000},
+                .keyboard_rom = {.ptr = keyboard_rom, .size = 0x800},
+                .fdc_rom = {.ptr = apple2_fdc_rom, .size = sizeof(apple2_fdc_rom)},
+                .hdc_rom = {.ptr = prodos_hdc_rom, .size = sizeof(prodos_hdc_rom)},
+            },
+    };
+}
+
+// Write the input recording of a job to record_dir, sets the job error on failure
+static bool batch_save_recording(batch_job_t* job, const apple2e_input_recorder_t* rec) {
+    char path[BATCH_MAX_LINE];
+    snprintf(path, sizeof(path), "%s/line%u.rec", record_dir, job->line);
+    FILE* f = fopen(path, "wb");
+    bool ok = f && (fwrite(rec->stream, 1, rec->pos, f) == rec->pos);
+    if (f) {
+        ok &= (fclose(f) == 0);
+    }
+    if (!ok) {
+        snprintf(job->error, sizeof(job->error), "can't write input recording");
+    }
+    return ok;
+}
+
+// CPU time of the calling thread in nanoseconds, unlike host_time_ns() it doesn't count time preempted
+static uint64_t batch_thread_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void batch_run_job(batch_worker_t* worker, batch_job_t* job) {
+    apple2e_t* sys = &worker->sys;
+    uint64_t t0 = host_time_ns();
+    uint64_t cpu_t0 = batch_thread_time_ns();
+    apple2e_desc_t desc = batch_desc();
+    apple2e_init(sys, &desc);
+    const batch_image_t* image = (job->image != BATCH_NO_IMAGE) ? &images[job->image] : NULL;
+    if (image && (image->type == BATCH_IMAGE_NIB)) {
+        // The Disk II writes into the image, so each job starts from a fresh copy
+        memcpy(worker->nib_image, image->data, DISK2_FDD_NIB_IMAGE_SIZE);
+        disk2_fdd_insert_disk(&sys->fdc.fdd[0], worker->nib_image);
+    } else if (image) {
+        prodos_hdd_insert_disk_internal(&sys->hdc.hdd[0], image->data, (uint32_t)image->size);
+    }
+    apple2e_set_block_cache(sys, &worker->block_cache);
+    apple2e_set_exec_mode(sys, exec_mode);
+
+    // Replay the input recording at its system_ticks, or apply the script events at the start of their frame
+    apple2e_input_player_t play = {0};
+    if (job->recording && !apple2e_input_play_init(&play, sys, &(apple2e_input_desc_t){
+                                                                    .stream =
+                                                                        {
+                                                                            .ptr = job->recording,
+                                                                            .size = job->recording_size,
+                                                                        },
+                                                                })) {
+        snprintf(job->error, sizeof(job->error), "input recording doesn't match this execution mode");
+        job->status = BATCH_STATUS_ERROR;
+        return;
+    }
+    // Jobs that replay a recording already have one
+    const bool record = record_dir && !job->recording;
+    apple2e_input_recorder_t rec;
+    if (record) {
+        apple2e_input_record_init(&rec, sys, &(apple2e_input_desc_t){
+                                                 .stream = {.ptr = worker->record_buffer, .size = worker->record_size},
+                                             });
+    }
+
+    uint64_t num_ticks = 0;
+    uint32_t next_event = 0;
+    for (uint32_t frame = 0; frame < job->num_frames; frame++) {
+        while ((next_event < job->num_events) && (job->events[next_event].frame <= frame)) {
+            const batch_event_t* event = &job->events[next_event++];
+            if (record) {
+                apple2e_input_record(&rec, event->input, event->value);
+            } else {
+                apple2e_input(sys, event->input, event->value);
+            }
+        }
+        bool loading = turbo && apple2e_is_loading(sys);
+        apple2e_set_audio_muted(sys, loading);
+        // Instruction mode can overshoot a frame by a few ticks, catch up in the next one
+        uint32_t frame_ticks = (uint32_t)((frame + 1) * (uint64_t)BATCH_TICKS_PER_FRAME - num_ticks);
+        if (job->recording) {
+            num_ticks += apple2e_input_play_exec_ticks(&play, frame_ticks);
+        } else {
+            num_ticks += apple2e_exec_ticks(sys, frame_ticks);
+        }
+        if (!loading || !apple2e_is_loading(sys) || (frame + 1 == job->num_frames)) {
+            apple2e_screen_update(sys);
+        }
+    }
+    job->num_inputs = job->recording ? play.num_events : next_event;
+    if (job->recording && (play.num_late || play.error)) {
+        if (play.error) {
+            snprintf(job->error, sizeof(job->error), "input recording is damaged");
+        } else {
+            snprintf(job->error, sizeof(job->error), "%u recorded inputs applied late", play.num_late);
+        }
+        job->status = BATCH_STATUS_ERROR;
+        return;
+    }
+    if (record && !batch_save_recording(job, &rec)) {
+        job->status = BATCH_STATUS_ERROR;
+        return;
+    }
+    job->hash = apple2e_frame_hash(sys);
+    job->num_ticks = num_ticks;
+    job->ns = host_time_ns() - t0;
+    job->cpu_ns = batch_thread_time_ns() - cpu_t0;
+    job->worker = worker->index;
+    if (job->check_hash) {
+        job->status = (job->hash == job->expected_hash) ? BATCH_STATUS_PASS : BATCH_STATUS_FAIL;
+    }
+}
+
+// Take the next job from the own queue, or steal one from another worker, returns false when all are taken
+static bool batch_take_job(batch_worker_t* worker, uint32_t* job_index) {
+    bool found = false;
+    pthread_mutex_lock(&worker->lock);
+    if (worker->head < worker->tail) {
+        *job_index = worker->queue[--worker->tail];
+        found = true;
+    }
+    pthread_mutex_unlock(&worker->lock);
+    for (uint32_t i = 1; !found && (i < num_workers); i++) {
+        batch_worker_t* victim = &workers[(worker->index + i) % num_workers];
+        pthread_mutex_lock(&victim->lock);
+        if (victim->head < victim->tail) {
+            *job_index = victim->queue[victim->head++];
+            found = true;
+            worker->num_stolen++;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+    return found;
+}
+
+static void* batch_worker(void* arg) {
+    batch_worker_t* worker = (batch_worker_t*)arg;
+    uint32_t job_index;
+    while (batch_take_job(worker, &job_index)) {
+        batch_run_job(worker, &jobs[job_index]);
+        worker->num_jobs++;
+        worker->cpu_ns += jobs[job_index].cpu_ns;
+    }
+    return NULL;
+}
+
+// Sort job indices by frame count, shortest first
+static int batch_compare_jobs(const void* a, const void* b) {
+    const batch_job_t* ja = &jobs[*(const uint32_t*)a];
+    const batch_job_t* jb = &jobs[*(const uint32_t*)b];
+    if (ja->num_frames != jb->num_frames) {
+        return ja->num_frames < jb->num_frames ? -1 : 1;
+    }
+    return ja->line < jb->line ? -1 : (ja->line > jb->line);
+}
+
+static void print_json_string(FILE* out, const char* s) {
+    if (!s) {
+        fprintf(out, "null");
+        return;
+    }
+    fputc('"', out);
+    for (; *s; s++) {
+        if ((*s == '"') || (*s == '\\')) {
+            fprintf(out, "\\%c", *s);
+        } else if ((uint8_t)*s < 0x20) {
+            fprintf(out, "\\u%04x", (uint8_t)*s);
+        } else {
+            fputc(*s, out);
+        }
+    }
+    fputc('"', out);
+}
+
+// Deal the runnable jobs to n workers and run them, returns the wall time in nanoseconds or 0 on failure
+static uint64_t batch_run(uint32_t n) {
+    num_workers = n;
+    // Round robin, shortest first so each queue ends with its longest
+    for (uint32_t i = 0; i < num_workers; i++) {
+        batch_worker_t* worker = &workers[i];
+        worker->head = worker->tail = 0;
+        worker->num_jobs = worker->num_stolen = 0;
+        worker->cpu_ns = 0;
+    }
+    for (uint32_t i = 0; i < num_runnable; i++) {
+        batch_worker_t* worker = &workers[i % num_workers];
+        worker->queue[worker->tail++] = order[i];
+    }
+    uint64_t t0 = host_time_ns();
+    for (uint32_t i = 0; i < num_workers; i++) {
+        if (pthread_create(&workers[i].thread, NULL, batch_worker, &workers[i])) {
+            fprintf(stderr, "Failed to start worker %u\n", i);
+            return 0;
+        }
+    }
+    for (uint32_t i = 0; i < num_workers; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    return host_time_ns() - t0;
+}
+
+// base_wall_ns is the wall time of the same jobs on one worker, 0 if it wasn't measured
+static void print_json(FILE* out, uint64_t wall_ns, uint64_t base_wall_ns) {
+    uint32_t counts[4] = {0};
+    uint64_t num_frames = 0, num_ticks = 0, cpu_ns = 0;
+    uint32_t num_stolen = 0;
+    fprintf(out, "{\n  \"system\": \"apple2e\",\n  \"mode\": \"%s\",\n  \"workers\": %u,\n  \"jobs\": [\n",
+            batch_exec_mode_names[exec_mode], num_workers);
+    for (uint32_t i = 0; i < num_jobs; i++) {
+        const batch_job_t* job = &jobs[i];
+        counts[job->status]++;
+        fprintf(out, "    {\"line\": %u, \"system\": ", job->line);
+        print_json_string(out, job->system);
+        fprintf(out, ", \"disk\": ");
+        print_json_string(out, job->disk);
+        fprintf(out, ", \"script\": ");
+        print_json_string(out, job->script);
+        fprintf(out, ", \"frames\": %u, \"status\": \"%s\", ", job->num_frames, batch_status_names[job->status]);
+        if (job->status == BATCH_STATUS_ERROR) {
+            fprintf(out, "\"error\": ");
+            print_json_string(out, job->error);
+            fprintf(out, "}");
+        } else {
+            fprintf(out, "\"hash\": \"%016llx\", ", (unsigned long long)job->hash);
+            if (job->check_hash) {
+                fprintf(out, "\"expected\": \"%016llx\", ", (unsigned long long)job->expected_hash);
+            } else {
+                fprintf(out, "\"expected\": null, ");
+            }
+            fprintf(out,
+                    "\"ticks\": %llu, \"inputs\": %u, \"ms\": %.3f, \"cpu_ms\": %.3f, \"mhz\": %.2f, \"fps\": %.1f, "
+                    "\"worker\": %u}",
+                    (unsigned long long)job->num_ticks, job->num_inputs, job->ns / 1e6, job->cpu_ns / 1e6,
+                    job->num_ticks * 1e3 / job->cpu_ns, job->num_frames * 1e9 / job->cpu_ns, job->worker);
+            num_frames += job->num_frames;
+            num_ticks += job->num_ticks;
+            cpu_ns += job->cpu_ns;
+        }
+        fprintf(out, "%s\n", (i + 1 < num_jobs) ? "," : "");
+    }
+    fprintf(out, "  ],\n  \"worker_stats\": [\n");
+    for (uint32_t i = 0; i < num_workers; i++) {
+        const batch_worker_t* worker = &workers[i];
+        num_stolen += worker->num_stolen;
+        fprintf(out, "    {\"worker\": %u, \"jobs\": %u, \"stolen\": %u, \"cpu_ms\": %.3f}%s\n", i, worker->num_jobs,
+                worker->num_stolen, worker->cpu_ns / 1e6, (i + 1 < num_workers) ? "," : "");
+    }
+    fprintf(out,
+            "  ],\n  \"summary\": {\"jobs\": %u, \"pass\": %u, \"fail\": %u, \"unchecked\": %u, \"error\": %u, "
+            "\"frames\": %llu, \"ticks\": %llu, \"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"fps\": %.1f, \"mhz\": %.2f, "
+            "\"stolen\": %u",
+            num_jobs, counts[BATCH_STATUS_PASS], counts[BATCH_STATUS_FAIL], counts[BATCH_STATUS_UNCHECKED],
+            counts[BATCH_STATUS_ERROR], (unsigned long long)num_frames, (unsigned long long)num_ticks, wall_ns / 1e6,
+            cpu_ns / 1e6, wall_ns ? num_frames * 1e9 / wall_ns : 0.0, wall_ns ? num_ticks * 1e3 / wall_ns : 0.0,
+            num_stolen);
+    // The speedup compares wall times, so workers slowing each other down through caches and memory show in it
+    if (base_wall_ns && wall_ns) {
+        fprintf(out, ", \"base_wall_ms\": %.3f, \"base_fps\": %.1f, \"speedup\": %.2f", base_wall_ns / 1e6,
+                num_frames * 1e9 / base_wall_ns, (double)base_wall_ns / wall_ns);
+    }
+    fprintf(out, "}\n}\n");
+}
+
+int main(int argc, char* const argv[]) {
+    const char *rom_file = NULL, *character_rom_file = NULL, *keyboard_rom_file = NULL, *output_file = NULL;
+    long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    num_workers = num_cores > 0 ? (uint32_t)num_cores : 1;
+    bool scaling = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:c:k:j:o:ibtw:sh")) != -1) {
+        switch (opt) {
+            case 'r':
+                rom_file = optarg;
+                break;
+            case 'c':
+                character_rom_file = optarg;
+                break;
+            case 'k':
+                keyboard_rom_file = optarg;
+                break;
+            case 'j':
+                num_workers = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                output_file = optarg;
+                break;
+            case 'i':
+                exec_mode = APPLE2E_EXEC_MODE_INSTRUCTION;
+                break;
+            case 'b':
+                exec_mode = APPLE2E_EXEC_MODE_BLOCK_CACHE;
+                break;
+            case 't':
+                turbo = true;
+                break;
+            case 'w':
+                record_dir = optarg;
+                break;
+            case 's':
+                scaling = true;
+                break;
+            case 'h':
+            default:
+                print_usage(argv[0]);
+                break;
+        }
+    }
+
+    if (!rom_file || !character_rom_file || (optind + 1 != argc) || (num_workers == 0)) {
+        print_usage(argv[0]);
+    }
+
+    rom = load_rom(rom_file, 0x4000);
+    character_rom = load_rom(character_rom_file, 0x1000);
+    keyboard_rom = keyboard_rom_file ? load_rom(keyboard_rom_file, 0x800) : calloc(1, 0x800);
+    if (!rom || !character_rom || !keyboard_rom || !batch_load_manifest(argv[optind])) {
+        return 1;
+    }
+    FILE* out = output_file ? fopen(output_file, "w") : stdout;
+    if (!out) {
+        perror(output_file);
+        return 1;
+    }
+
+    num_workers = num_workers < num_jobs ? num_workers : (num_jobs ? num_jobs : 1);
+    workers = calloc(num_workers, sizeof(batch_worker_t));
+    order = malloc((num_jobs + 1) * sizeof(uint32_t));
+    if (!workers || !order) {
+        return 1;
+    }
+    for (uint32_t i = 0; i < num_jobs; i++) {
+        if (jobs[i].status != BATCH_STATUS_ERROR) {
+            order[num_runnable++] = i;
+        }
+    }
+    qsort(order, num_runnable, sizeof(uint32_t), batch_compare_jobs);
+    // A recorded event takes 7 bytes at most
+    uint32_t max_events = 0;
+    for (uint32_t i = 0; i < num_jobs; i++) {
+        max_events = jobs[i].num_events > max_events ? jobs[i].num_events : max_events;
+    }
+    for (uint32_t i = 0; i < num_workers; i++) {
+        batch_worker_t* worker = &workers[i];
+        worker->index = i;
+        // A single worker takes all jobs in the -s run
+        worker->queue = malloc((num_runnable + 1) * sizeof(uint32_t));
+        worker->record_size = APPLE2E_INPUT_HEADER_SIZE + 7 * max_events;
+        worker->record_buffer = record_dir ? malloc(worker->record_size) : NULL;
+        if (!worker->queue || (record_dir && !worker->record_buffer)) {
+            return 1;
+        }
+        pthread_mutex_init(&worker->lock, NULL);
+    }
+
+    // The shared render tables are filled before the workers start
+    apple2e_init_tables();
+
+    // The jobs are deterministic, the second run repeats the results of the first one
+    const uint32_t max_workers = num_workers;
+    uint64_t base_wall_ns = scaling ? batch_run(1) : 0;
+    uint64_t wall_ns = (!scaling || base_wall_ns) ? batch_run(max_workers) : 0;
+    if (!wall_ns) {
+        return 1;
+    }
+
+    print_json(out, wall_ns, base_wall_ns);
+    if (out != stdout) {
+        fclose(out);
+    }
+    int result = 0;
+    for (uint32_t i = 0; i < num_jobs; i++) {
+        if ((jobs[i].status == BATCH_STATUS_FAIL) || (jobs[i].status == BATCH_STATUS_ERROR)) {
+            result = 1;
+        }
+    }
+    return result;
+}
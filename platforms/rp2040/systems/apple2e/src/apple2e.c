@@ -21,6 +21,16 @@
 #define CHIPS_IMPL
 
 #define MEM_PAGE_SHIFT (9U)
+// Rewind history, the chunks are what a capture keeps of the RAM written after it
+#define MEM_WRITE_HOOK
+#define MEM_WRITE_WATCH_SHIFT (8)
+
+// apple2e_screen_update() renders straight into the DVI framebuffer
+#define APPLE2E_NO_FRAMEBUFFER
+// The two rendered page copies (105 KB) don't fit in SRAM next to the DVI framebuffer
+#define APPLE2E_NO_PAGE_CACHE
+// Frames are always presented, nothing reads apple2e_frame_hash()
+#define APPLE2E_NO_FRAME_HASH
 
 #define RGBA8(r, g, b) (0xFF000000 | (r << 16) | (g << 8) | (b))
 
@@ -58,6 +68,8 @@
 #include "devices/prodos_hdc.h"
 #include "devices/prodos_hdc_rom.h"
 #include "systems/apple2e.h"
+#include "systems/apple2e_input.h"
+#include "systems/apple2e_rewind.h"
 
 #include "hardware/clocks.h"
 #include "hardware/dma.h"
@@ -77,11 +89,27 @@ typedef struct {
     apple2e_t apple2e;
 } apple2e_snapshot_t;
 
+// F11 records the inputs from power on to APPLE2E_INPUT_FILE on the FatFS volume, Open Apple+F11 replays it
+#define APPLE2E_INPUT_FILE        "apple2e.rec"
+#define APPLE2E_INPUT_STREAM_SIZE (16 * 1024)
+
+// Pause steps back to the last capture, a few seconds of history unless the game writes much of RAM
+#define APPLE2E_REWIND_BUDGET (48 * 1024)
+
 typedef struct {
     apple2e_t apple2e;
     uint32_t frame_time_us;
     uint32_t ticks;
     // double emu_time_ms;
+    // Input recording or replay, the stream is the recorded bytes or the file read back
+    bool recording;
+    bool replaying;
+    apple2e_input_recorder_t rec;
+    apple2e_input_player_t play;
+    uint8_t input_stream[APPLE2E_INPUT_STREAM_SIZE];
+    // Rewind history from power on or the last disk change
+    apple2e_rewind_t rewind;
+    uint8_t rewind_buffer[APPLE2E_REWIND_BUDGET];
 } state_t;
 
 static state_t __not_in_flash() state;
@@ -113,11 +141,6 @@ apple2e_desc_t apple2e_desc(void) {
     };
 }
 
-void app_init(void) {
-    apple2e_desc_t desc = apple2e_desc();
-    apple2e_init(&state.apple2e, &desc);
-}
-
 #if 0 // def OLIMEX_NEO6502
 // TMDS bit clock 400 MHz
 // DVDD 1.3V
@@ -133,6 +156,108 @@ void app_init(void) {
 #define VREG_VSEL    VREG_VOLTAGE_1_20
 #endif  // OLIMEX_NEO6502
 
+#define APPLE2E_EMPTY_LINES   ((FRAME_HEIGHT - APPLE2E_SCREEN_HEIGHT * 2) / 4)
+#define APPLE2E_EMPTY_COLUMNS ((FRAME_WIDTH - APPLE2E_SCREEN_WIDTH) / 2)
+
+picodvi_framebuffer_obj_t picodvi;
+
+// Start the rewind history over from the current state
+static void app_rewind_init(void) {
+    apple2e_rewind_init(&state.rewind, &state.apple2e,
+                        &(apple2e_rewind_desc_t){
+                            .buffer = {.ptr = state.rewind_buffer, .size = sizeof(state.rewind_buffer)},
+                        });
+}
+
+// Power on the system and render into the DVI framebuffer
+static void app_power_on(void) {
+    apple2e_desc_t desc = apple2e_desc();
+    apple2e_init(&state.apple2e, &desc);
+    apple2e_set_surface(&state.apple2e,
+                        &(apple2e_surface_t){
+                            .ptr = &((uint8_t *)picodvi.framebuffer)[APPLE2E_EMPTY_LINES * picodvi.width +
+                                                                      APPLE2E_EMPTY_COLUMNS],
+                            .stride = picodvi.width,
+                            .format = APPLE2E_SURFACE_RGB232,
+                        });
+    app_rewind_init();
+}
+
+void app_init(void) {
+    apple2e_init_tables();
+    app_power_on();
+}
+
+// Apply an input change, through the recorder while recording, the recorded ones take its place while replaying
+static void app_input(uint8_t input, uint8_t value) {
+    if (state.replaying) {
+        return;
+    }
+    if (state.recording) {
+        apple2e_input_record(&state.rec, input, value);
+    } else {
+        apple2e_input(&state.apple2e, input, value);
+    }
+}
+
+// End a recording and write it to APPLE2E_INPUT_FILE, or end a replay
+static void app_input_stop(void) {
+    if (state.recording) {
+        FIL fil;
+        UINT written = 0;
+        FRESULT fr = f_open(&fil, APPLE2E_INPUT_FILE, FA_WRITE | FA_CREATE_ALWAYS);
+        if (fr == FR_OK) {
+            fr = f_write(&fil, state.rec.stream, state.rec.pos, &written);
+            FRESULT close_fr = f_close(&fil);
+            fr = (fr == FR_OK) ? close_fr : fr;
+        }
+        if ((fr != FR_OK) || (written != state.rec.pos)) {
+            printf("Failed to write %s\n", APPLE2E_INPUT_FILE);
+        } else {
+            printf("Recorded %lu inputs to %s%s\n", (unsigned long)state.rec.num_events, APPLE2E_INPUT_FILE,
+                   state.rec.overflow ? ", the buffer ran full" : "");
+        }
+    } else if (state.replaying) {
+        printf("Replayed %lu inputs\n", (unsigned long)state.play.num_events);
+    }
+    state.recording = false;
+    state.replaying = false;
+}
+
+// Power on and record the inputs from there, the built-in disk and the MSC image are inserted again
+static void app_input_record(void) {
+    app_power_on();
+    state.recording = apple2e_input_record_init(&state.rec, &state.apple2e,
+                                                &(apple2e_input_desc_t){
+                                                    .stream = {.ptr = state.input_stream,
+                                                               .size = sizeof(state.input_stream)},
+                                                });
+    printf("Recording inputs\n");
+}
+
+// Read APPLE2E_INPUT_FILE, power on and replay it, from the device or recorded on the host from power on
+static void app_input_replay(void) {
+    FIL fil;
+    UINT size = 0;
+    FRESULT fr = f_open(&fil, APPLE2E_INPUT_FILE, FA_READ);
+    if (fr == FR_OK) {
+        fr = f_read(&fil, state.input_stream, sizeof(state.input_stream), &size);
+        f_close(&fil);
+    }
+    if ((fr != FR_OK) || (size == sizeof(state.input_stream))) {
+        printf("Failed to read %s\n", APPLE2E_INPUT_FILE);
+        return;
+    }
+    app_power_on();
+    state.replaying = apple2e_input_play_init(&state.play, &state.apple2e,
+                                              &(apple2e_input_desc_t){
+                                                  .stream = {.ptr = state.input_stream, .size = size},
+                                              });
+    if (!state.replaying) {
+        printf("%s is not a cycle-stepped input recording from power on\n", APPLE2E_INPUT_FILE);
+    }
+}
+
 void kbd_raw_key_down(int code) {
     if (isascii(code)) {
         if (isupper(code)) {
@@ -172,43 +297,64 @@ void kbd_raw_key_down(int code) {
             if (sys->fdc.valid) {
                 uint8_t index = code - 0x13A;
                 if (CHIPS_ARRAY_SIZE(apple2_nib_images) > index) {
+                    // Disk changes aren't recorded
+                    app_input_stop();
                     if (sys->kbd_open_apple_pressed) {
                         prodos_hdd_remove_disk(&sys->hdc.hdd[0]);
-                        apple2e_desc_t desc = apple2e_desc();
-                        apple2e_init(&state.apple2e, &desc);
+                        app_power_on();
                     }
                     disk2_fdd_insert_disk(&sys->fdc.fdd[0], apple2_nib_images[index]);
+                    app_rewind_init();
                 }
             }
             break;
         }
         case 0x143:  // F10
             if (sys->hdc.valid) {
+                app_input_stop();
                 if (sys->kbd_open_apple_pressed) {
-                    apple2e_desc_t desc = apple2e_desc();
-                    apple2e_init(&state.apple2e, &desc);
+                    app_power_on();
                 }
                 if (CHIPS_ARRAY_SIZE(apple2_msc_images) > 0) {
                     prodos_hdd_insert_disk_msc(&sys->hdc.hdd[0], apple2_msc_images[0]);
                 }
+                app_rewind_init();
+            }
+            break;
+
+        case 0x144:  // F11
+            if (state.recording || state.replaying) {
+                app_input_stop();
+            } else if (sys->kbd_open_apple_pressed) {
+                app_input_replay();
+            } else {
+                app_input_record();
             }
             break;
 
         case 0x145:  // F12
-            apple2e_reset(sys);
+            app_input(APPLE2E_INPUT_RESET, 0);
+            break;
+
+        case 0x148:  // Pause
+            // The recording or replay doesn't go back with it
+            app_input_stop();
+            if (!apple2e_rewind_step_back(&state.rewind)) {
+                printf("No earlier frame to rewind to\n");
+            }
             break;
 
         case 0x1E3:  // GUI LEFT
-            sys->kbd_open_apple_pressed = true;
+            app_input(APPLE2E_INPUT_OPEN_APPLE, 1);
             break;
 
         case 0x1E7:  // GUI RIGHT
-            sys->kbd_solid_apple_pressed = true;
+            app_input(APPLE2E_INPUT_SOLID_APPLE, 1);
             break;
 
         default:
             if (code < 128) {
-                sys->kbd_last_key = code | 0x80;
+                app_input(APPLE2E_INPUT_KEY, code);
             }
             break;
     }
@@ -224,15 +370,13 @@ void kbd_raw_key_up(int code) {
         }
     }
 
-    apple2e_t *sys = &state.apple2e;
-
     switch (code) {
         case 0x1E3:  // GUI LEFT
-            sys->kbd_open_apple_pressed = false;
+            app_input(APPLE2E_INPUT_OPEN_APPLE, 0);
             break;
 
         case 0x1E7:  // GUI RIGHT
-            sys->kbd_solid_apple_pressed = false;
+            app_input(APPLE2E_INPUT_SOLID_APPLE, 0);
             break;
 
         default:
@@ -242,12 +386,8 @@ void kbd_raw_key_up(int code) {
 }
 
 void gamepad_state_update(uint8_t index, uint8_t hat_state, uint32_t button_state) {
-    apple2e_t *sys = &state.apple2e;
-
-    sys->paddl0 = 0x80;
-    sys->paddl1 = 0x80;
-    sys->paddl2 = 0x80;
-    sys->paddl3 = 0x80;
+    uint8_t paddl[4] = {0x80, 0x80, 0x80, 0x80};
+    bool butn[3];
 
     switch (hat_state) {
 
@@ -256,73 +396,73 @@ void gamepad_state_update(uint8_t index, uint8_t hat_state, uint32_t button_stat
 
         case GAMEPAD_HAT_UP:
             if (index == 0) {
-                sys->paddl1 = 0x00;
+                paddl[1] = 0x00;
             } else {
-                sys->paddl3 = 0x00;
+                paddl[3] = 0x00;
             }
             break;
 
         case GAMEPAD_HAT_UP_RIGHT:
             if (index == 0) {
-                sys->paddl0 = 0xFF;
-                sys->paddl1 = 0x00;
+                paddl[0] = 0xFF;
+                paddl[1] = 0x00;
             } else {
-                sys->paddl2 = 0xFF;
-                sys->paddl3 = 0x00;
+                paddl[2] = 0xFF;
+                paddl[3] = 0x00;
             }
             break;
 
         case GAMEPAD_HAT_RIGHT:
             if (index == 0) {
-                sys->paddl0 = 0xFF;
+                paddl[0] = 0xFF;
             } else {
-                sys->paddl2 = 0xFF;
+                paddl[2] = 0xFF;
             }
             break;
 
         case GAMEPAD_HAT_DOWN_RIGHT:
             if (index == 0) {
-                sys->paddl0 = 0xFF;
-                sys->paddl1 = 0xFF;
+                paddl[0] = 0xFF;
+                paddl[1] = 0xFF;
             } else {
-                sys->paddl2 = 0xFF;
-                sys->paddl3 = 0xFF;
+                paddl[2] = 0xFF;
+                paddl[3] = 0xFF;
             }
             break;
 
         case GAMEPAD_HAT_DOWN:
             if (index == 0) {
-                sys->paddl1 = 0xFF;
+                paddl[1] = 0xFF;
             } else {
-                sys->paddl3 = 0xFF;
+                paddl[3] = 0xFF;
             }
             break;
 
         case GAMEPAD_HAT_DOWN_LEFT:
             if (index == 0) {
-                sys->paddl0 = 0x00;
-                sys->paddl1 = 0xFF;
+                paddl[0] = 0x00;
+                paddl[1] = 0xFF;
             } else {
-                sys->paddl2 = 0x00;
-                sys->paddl3 = 0xFF;
+                paddl[2] = 0x00;
+                paddl[3] = 0xFF;
             }
             break;
 
         case GAMEPAD_HAT_LEFT:
             if (index == 0) {
-                sys->paddl0 = 0x00;
+                paddl[0] = 0x00;
             } else {
-                sys->paddl2 = 0x00;
+                paddl[2] = 0x00;
             }
             break;
 
         case GAMEPAD_HAT_UP_LEFT:
             if (index == 0) {
-                sys->paddl0 = 0x00;
-                sys->paddl1 = 0x00;
+                paddl[0] = 0x00;
+                paddl[1] = 0x00;
             } else {
-                sys->paddl2 = 0x00;
-                sys->paddl3 = 0x00;
+                paddl[2] = 0x00;
+                paddl[3] = 0x00;
             }
             break;
 
@@ -330,22 +470,30 @@ void gamepad_state_update(uint8_t index, uint8_t hat_state, uint32_t button_stat
             break;
     }
 
-    sys->butn0 = false;
-    sys->butn1 = false;
-    sys->butn2 = false;
+    butn[0] = false;
+    butn[1] = false;
+    butn[2] = false;
 
     if (button_state & GAMEPAD_BUTTON_A) {
         if (index == 0) {
-            sys->butn0 = true;
+            butn[0] = true;
         } else {
-            sys->butn2 = true;
+            butn[2] = true;
         }
     }
     if (button_state & GAMEPAD_BUTTON_B) {
         if (index == 0) {
-            sys->butn1 = true;
+            butn[1] = true;
         }
     }
+
+    // Through app_input() like the keyboard, so the changes can be recorded with their system_ticks
+    for (uint8_t i = 0; i < 4; i++) {
+        app_input(APPLE2E_INPUT_PADDLE0 + i, paddl[i]);
+    }
+    for (uint8_t i = 0; i < 3; i++) {
+        app_input(APPLE2E_INPUT_BUTTON0 + i, butn[i]);
+    }
     // printf("Gamepad state update: %d %d %d\n", index, hat_state, button_state);
 }
 
@@ -371,51 +519,6 @@ static inline void __not_in_flash_func(render_scanline)(const uint32_t *pixbuf,
     apple2e_render_scanline(pixbuf, scanbuf, n_pix);
 }
 
-#define APPLE2E_EMPTY_LINES   ((FRAME_HEIGHT - APPLE2E_SCREEN_HEIGHT * 2) / 4)
-#define APPLE2E_EMPTY_COLUMNS ((FRAME_WIDTH - APPLE2E_SCREEN_WIDTH) / 2)
-
-picodvi_framebuffer_obj_t picodvi;
-
-#define RGB232(r, g, b) ( \
-    (((r) >> 6) << 6) | \
-    (((g) >> 5) << 2) | \
-    (((b) >> 6)))
-
-uint8_t hstx_lut[16] = {
-    RGB232(0x00, 0x00, 0x00), /* Black */
-    RGB232(0xA7, 0x0B, 0x4C), /* Dark Red */
-    RGB232(0x40, 0x1C, 0xF7), /* Dark Blue */
-    RGB232(0xE6, 0x28, 0xFF), /* Purple */
-    RGB232(0x00, 0x74, 0x40), /* Dark Green */
-    RGB232(0x80, 0x80, 0x80), /* Dark Gray */
-    RGB232(0x19, 0x90, 0xFF), /* Medium Blue */
-    RGB232(0xBF, 0x9C, 0xFF), /* Light Blue */
-    RGB232(0x40, 0x63, 0x00), /* Brown */
-    RGB232(0xE6, 0x6F, 0x00), /* Orange */
-    RGB232(0x80, 0x80, 0x80), /* Light Grey */
-    RGB232(0xFF, 0x8B, 0xBF), /* Pink */
-    RGB232(0x19, 0xD7, 0x00), /* Light Green */
-    RGB232(0xBF, 0xE3, 0x08), /* Yellow */
-    RGB232(0x58, 0xF4, 0xBF), /* Aquamarine */
-    RGB232(0xFF, 0xFF, 0xFF)  /* White */
-};
-
-static inline void __not_in_flash_func(screen_to_hstx()) {
-    for (int y = 0; y < APPLE2E_SCREEN_HEIGHT; y ++) {
-        uint8_t *apple_fb = _apple2e_get_fb_addr(&state.apple2e, y);
-        uint8_t *hstx_fb = &((uint8_t*)picodvi.framebuffer)[(APPLE2E_EMPTY_LINES + y) * picodvi.width + APPLE2E_EMPTY_COLUMNS];
-
-        for(int x = 0; x < APPLE2E_SCREEN_WIDTH / 2; x++) {
-            uint8_t in = *apple_fb++;
-            uint8_t c1 = hstx_lut[in >> 4];
-            uint8_t c2 = hstx_lut[in & 0xf];
-            hstx_fb[0] = c1;
-            hstx_fb[1] = c2;
-            hstx_fb += 2;
-        }
-    } 
-}
-
 void __not_in_flash_func(core1_main()) {
     audio_init(44100);
 
@@ -485,16 +588,39 @@ int main() {
 
     app_init();
 
+    uint32_t display_time = 0;
+
     while (1) {
         uint32_t start_time_in_micros = time_us_32();
 
+        // Accelerate while loading: run as many frames as fit into one frame
+        // time without audio, and only show the last one
+        bool loading = apple2e_is_loading(&state.apple2e);
+        apple2e_set_audio_muted(&state.apple2e, loading);
+
         uint32_t num_ticks = 17030;
-        for (uint32_t ticks = 0; ticks < num_ticks; ticks++) {
-            apple2e_tick(&state.apple2e);
-        }
+        uint32_t frame_time = 0;
+        do {
+            uint32_t frame_start_in_micros = time_us_32();
+            if (state.replaying) {
+                // Stops at the system_ticks of each recorded input to apply it
+                apple2e_input_play_exec_ticks(&state.play, num_ticks);
+            } else {
+                for (uint32_t ticks = 0; ticks < num_ticks; ticks++) {
+                    apple2e_tick(&state.apple2e);
+                }
+            }
+            apple2e_rewind_frame(&state.rewind);
+            frame_time = time_us_32() - frame_start_in_micros;
+        } while (loading && apple2e_is_loading(&state.apple2e) &&
+                 (time_us_32() - start_time_in_micros + frame_time + display_time < 16666));
 
+        uint32_t display_start_in_micros = time_us_32();
         apple2e_screen_update(&state.apple2e);
-        screen_to_hstx();
+        display_time = time_us_32() - display_start_in_micros;
+        if (state.replaying && apple2e_input_play_done(&state.play)) {
+            app_input_stop();
+        }
         tuh_task();
 
         uint32_t end_time_in_micros = time_us_32();
@@ -66,6 +66,10 @@ static inline void beeper_toggle(beeper_t* beeper) { beeper->state = !beeper->st
 static inline void beeper_set_volume(beeper_t* beeper, float vol) { beeper->volume = vol; }
 // Tick the beeper, return true if a new sample is ready
 bool beeper_tick(beeper_t* beeper);
+// Return the number of beeper_tick() calls until the next sample is ready
+int beeper_sample_ticks(beeper_t* beeper);
+// Tick the beeper num_ticks times in one step (at most beeper_sample_ticks()), return true if a new sample is ready
+bool beeper_advance(beeper_t* beeper, int num_ticks);
 
 #ifdef __cplusplus
 }  // extern "C"
@@ -101,7 +105,7 @@ void beeper_reset(beeper_t* b) {
 // from the chip simulation which is >0.0 gets converted to
 // a +/- sample value)
 
-static float _beeper_dcadjust(beeper_t* bp, float s) {
+static inline float _beeper_dcadjust(beeper_t* bp, float s) {
     bp->dcadj_sum -= bp->dcadj_buf[bp->dcadj_pos];
     bp->dcadj_sum += s;
     bp->dcadj_buf[bp->dcadj_pos] = s;
@@ -121,4 +125,22 @@ bool beeper_tick(beeper_t* bp) {
     return false;
 }
 
+int beeper_sample_ticks(beeper_t* bp) {
+    if (bp->counter <= BEEPER_FIXEDPOINT_SCALE) {
+        return 1;
+    }
+    return (bp->counter + BEEPER_FIXEDPOINT_SCALE - 1) / BEEPER_FIXEDPOINT_SCALE;
+}
+
+bool beeper_advance(beeper_t* bp, int num_ticks) {
+    CHIPS_ASSERT((num_ticks > 0) && (num_ticks <= beeper_sample_ticks(bp)));
+    bp->counter -= num_ticks * BEEPER_FIXEDPOINT_SCALE;
+    if (bp->counter <= 0) {
+        bp->counter += bp->period;
+        bp->sample = (float)bp->state * bp->volume * bp->base_volume;
+        return true;
+    }
+    return false;
+}
+
 #endif  // CHIPS_IMPL
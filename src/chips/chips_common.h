@@ -86,6 +86,8 @@ void chips_audio_callback_snapshot_onload(chips_audio_callback_t* snapshot, chip
 void chips_debug_snapshot_onsave(chips_debug_t* snapshot);
 // Fixup chips_debug_t snapshot after loading
 void chips_debug_snapshot_onload(chips_debug_t* snapshot, chips_debug_t* sys);
+// 64-bit xxHash (XXH64) of size bytes, e.g. to tell rendered frames apart
+uint64_t chips_hash64(const void* ptr, size_t size, uint64_t seed);
 
 #ifdef __cplusplus
 }  // extern "C"
@@ -116,4 +118,84 @@ void chips_debug_snapshot_onload(chips_debug_t* snapshot, chips_debug_t* sys) {
     snapshot->stopped = sys->stopped;
 }
 
+#define _CHIPS_XXH_PRIME1 (0x9E3779B185EBCA87ULL)
+#define _CHIPS_XXH_PRIME2 (0xC2B2AE3D27D4EB4FULL)
+#define _CHIPS_XXH_PRIME3 (0x165667B19E3779F9ULL)
+#define _CHIPS_XXH_PRIME4 (0x85EBCA77C2B2AE63ULL)
+#define _CHIPS_XXH_PRIME5 (0x27D4EB2F165667C5ULL)
+
+static inline uint64_t _chips_rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+// Little endian loads without alignment requirements
+static inline uint64_t _chips_read64(const uint8_t* p) {
+    return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+           ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static inline uint32_t _chips_read32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t _chips_xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * _CHIPS_XXH_PRIME2;
+    acc = _chips_rotl64(acc, 31);
+    return acc * _CHIPS_XXH_PRIME1;
+}
+
+static inline uint64_t _chips_xxh_merge_round(uint64_t acc, uint64_t val) {
+    acc ^= _chips_xxh_round(0, val);
+    return acc * _CHIPS_XXH_PRIME1 + _CHIPS_XXH_PRIME4;
+}
+
+uint64_t chips_hash64(const void* ptr, size_t size, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*)ptr;
+    const uint8_t* end = p + size;
+    uint64_t h;
+
+    if (size >= 32) {
+        // Four lanes of 8 bytes each
+        uint64_t v1 = seed + _CHIPS_XXH_PRIME1 + _CHIPS_XXH_PRIME2;
+        uint64_t v2 = seed + _CHIPS_XXH_PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - _CHIPS_XXH_PRIME1;
+        do {
+            v1 = _chips_xxh_round(v1, _chips_read64(p));
+            v2 = _chips_xxh_round(v2, _chips_read64(p + 8));
+            v3 = _chips_xxh_round(v3, _chips_read64(p + 16));
+            v4 = _chips_xxh_round(v4, _chips_read64(p + 24));
+            p += 32;
+        } while (p + 32 <= end);
+        h = _chips_rotl64(v1, 1) + _chips_rotl64(v2, 7) + _chips_rotl64(v3, 12) + _chips_rotl64(v4, 18);
+        h = _chips_xxh_merge_round(h, v1);
+        h = _chips_xxh_merge_round(h, v2);
+        h = _chips_xxh_merge_round(h, v3);
+        h = _chips_xxh_merge_round(h, v4);
+    } else {
+        h = seed + _CHIPS_XXH_PRIME5;
+    }
+    h += (uint64_t)size;
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= _chips_xxh_round(0, _chips_read64(p));
+        h = _chips_rotl64(h, 27) * _CHIPS_XXH_PRIME1 + _CHIPS_XXH_PRIME4;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)_chips_read32(p) * _CHIPS_XXH_PRIME1;
+        h = _chips_rotl64(h, 23) * _CHIPS_XXH_PRIME2 + _CHIPS_XXH_PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= *p * _CHIPS_XXH_PRIME5;
+        h = _chips_rotl64(h, 11) * _CHIPS_XXH_PRIME1;
+    }
+
+    // Final avalanche
+    h ^= h >> 33;
+    h *= _CHIPS_XXH_PRIME2;
+    h ^= h >> 29;
+    h *= _CHIPS_XXH_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
 #endif  // CHIPS_IMPL
@@ -25,6 +25,15 @@
 // - memory pages can be mapped as RAM, ROM or RAM-behind-ROM (where
 //     read accesses are mapped to a different memory page then write accesses)
 // - 4 independent page-table layers to simplify bank-switching implementations
+// - per-page read and write trap flags, so a system can send only accesses
+//     to I/O or otherwise special pages down its slow path
+// - optional write watch bitmap (define MEM_WRITE_WATCH before including
+//     mem.h), one bit per page or per MEM_WRITE_WATCH_SHIFT sized chunk of
+//     the CPU address space that is set by every mem_wr(), for dirty
+//     tracking and write watchpoints, see mem_written()
+// - optional write hook (define MEM_WRITE_HOOK), called before the first
+//     write to each chunk of the same size after it was armed, so undo logs
+//     can keep what the chunk held, see mem_set_write_hook()
 //
 // ## Usage
 //
@@ -37,6 +46,8 @@
 // 4. if needed, call the functions from step (2) to change the memory
 //     mapping (for instance to switch memory banks in and out of the
 //     16-bit address space)
+// 5. for banks that are switched very often, prepare the pages of each
+//     bank once with **mem_init_pages()** and switch with **mem_map_pages()**
 //
 // ## Layers, Pages and mapping to CPU-visible addresses
 //
@@ -67,9 +78,12 @@
 // Each page item consists of two host system pointers, one for read access,
 // and one for write access.
 //
-// There are 2 internal special 'junk pages', one for write accesses to
-// read-only-memory or unmapped memory, and one for read-access from unmapped
-// memory. A read access from unmapped memory always returns 0xFF.
+// There are 2 internal special 'junk pages' in each mem_t, one for write
+// accesses to read-only-memory or unmapped memory, and one for read-access
+// from unmapped memory. A read access from unmapped memory always returns
+// 0xFF. Keeping them in the instance means that mem_t has no shared state and
+// instances can run on different threads, but also that a copy of a mem_t
+// still points to the junk pages of the original.
 //
 // The different page-mapping scenarios are then implemented as follows:
 //
@@ -123,6 +137,30 @@ extern "C" {
 #define MEM_NUM_PAGES  (MEM_ADDR_RANGE / MEM_PAGE_SIZE)
 #define MEM_NUM_LAYERS (1U)
 
+#if defined(MEM_WRITE_WATCH) || defined(MEM_WRITE_HOOK)
+#ifndef MEM_WRITE_WATCH_SHIFT
+// Write watch chunk size (one page, 8 for 256 bytes)
+#define MEM_WRITE_WATCH_SHIFT MEM_PAGE_SHIFT
+#endif  // MEM_WRITE_WATCH_SHIFT
+#if (MEM_WRITE_WATCH_SHIFT < 8) || (MEM_WRITE_WATCH_SHIFT > 16)
+#error "MEM_WRITE_WATCH_SHIFT must be between 8 and 16"
+#endif
+#define MEM_WRITE_WATCH_CHUNKS (MEM_ADDR_RANGE >> MEM_WRITE_WATCH_SHIFT)
+#define MEM_WRITE_WATCH_WORDS  ((MEM_WRITE_WATCH_CHUNKS + 31) / 32)
+#endif  // MEM_WRITE_WATCH || MEM_WRITE_HOOK
+
+#ifdef MEM_WRITE_HOOK
+#if MEM_WRITE_WATCH_SHIFT > MEM_PAGE_SHIFT
+#error "MEM_WRITE_HOOK needs chunks no larger than a page"
+#endif
+// Called before the first write to an armed chunk with the host memory of the chunk the write goes to
+typedef void (*mem_write_hook_t)(uint8_t* chunk, void* user_data);
+#endif  // MEM_WRITE_HOOK
+
+// Page trap flags, see mem_add_trap()
+#define MEM_TRAP_READ  (1U << 0)
+#define MEM_TRAP_WRITE (1U << 1)
+
 // Memory page item maps a chunk of emulator memory to host memory
 typedef struct {
     uint8_t* read_ptr;
@@ -135,6 +173,26 @@ typedef struct {
     mem_page_t page_table[MEM_NUM_PAGES];
     // <emory-mapped layers, layer 0 is highest priority
     mem_page_t layers[MEM_NUM_LAYERS][MEM_NUM_PAGES];
+    // Per CPU-visible page trap flags, independent of the mapping
+    uint8_t page_trap[MEM_NUM_PAGES];
+#ifdef MEM_PAGE_GENERATIONS
+    // Per CPU-visible page write counters, for invalidating predecoded code
+    uint32_t page_gen[MEM_NUM_PAGES];
+#endif
+#ifdef MEM_WRITE_WATCH
+    // One bit per MEM_WRITE_WATCH_SHIFT chunk of the CPU address space written since it was cleared
+    uint32_t write_watch[MEM_WRITE_WATCH_WORDS];
+#endif
+#ifdef MEM_WRITE_HOOK
+    // One bit per MEM_WRITE_WATCH_SHIFT chunk whose next write calls write_hook first
+    uint32_t write_armed[MEM_WRITE_WATCH_WORDS];
+    mem_write_hook_t write_hook;
+    void* write_hook_user_data;
+#endif
+    // Dummy page for currently unmapped memory, reads as 0xFF
+    uint8_t unmapped_page[MEM_PAGE_SIZE];
+    // Write-only 'junk table' for writes to ROM areas
+    uint8_t junk_page[MEM_PAGE_SIZE];
 } mem_t;
 
 // Initialize a new mem instance
@@ -145,6 +203,10 @@ void mem_map_ram(mem_t* mem, size_t layer, uint16_t addr, uint32_t size, uint8_t
 void mem_map_rom(mem_t* mem, size_t layer, uint16_t addr, uint32_t size, const uint8_t* ptr);
 // Map a range of memory to different read/write pointers (e.g. for RAM behind ROM)
 void mem_map_rw(mem_t* mem, size_t layer, uint16_t addr, uint32_t size, const uint8_t* read_ptr, uint8_t* write_ptr);
+// Fill a run of pages mapping a range to read/write pointers (write_ptr 0 for ROM), for mem_map_pages()
+void mem_init_pages(mem_t* mem, mem_page_t* pages, uint32_t size, const uint8_t* read_ptr, uint8_t* write_ptr);
+// Map a range to a run of pages prepared with mem_init_pages(), a few memcpy()s instead of a loop over the pages
+void mem_map_pages(mem_t* mem, size_t layer, uint16_t addr, uint32_t size, const mem_page_t* pages);
 // Unmap all memory pages in a layer, also updates the CPU-visible page-table
 void mem_unmap_layer(mem_t* mem, size_t layer);
 // Unmap all memory pages in all layers, also updates the CPU-visible page-table
@@ -153,14 +215,54 @@ void mem_unmap_all(mem_t* mem);
 uint8_t* mem_readptr(mem_t* mem, uint16_t addr);
 // Copy a range of bytes into memory via mem_wr()
 void mem_write_range(mem_t* mem, uint16_t addr, const uint8_t* src, uint32_t num_bytes);
-
+// Copy a range of bytes into memory with one memcpy() per page, ROM pages take the writes like mem_wr()
+void mem_copy_in(mem_t* mem, uint16_t addr, const uint8_t* src, uint32_t num_bytes);
+// Copy a range of bytes out of memory with one memcpy() per page, unmapped pages read as 0xFF
+void mem_copy_out(mem_t* mem, uint16_t addr, uint8_t* dst, uint32_t num_bytes);
+// Add trap flags (MEM_TRAP_READ, MEM_TRAP_WRITE) to all pages overlapping a range
+void mem_add_trap(mem_t* mem, uint16_t addr, uint32_t size, uint8_t flags);
+// Remove all trap flags
+void mem_clear_traps(mem_t* mem);
+// Report a range modified without mem_wr() (e.g. through mem_writeptr()), bumps the page generations,
+// the write hook doesn't see such writes
+void mem_mark_written(mem_t* mem, uint16_t addr, uint32_t num_bytes);
+#ifdef MEM_WRITE_WATCH
+// Return true if any write watch chunk overlapping a range was written since it was cleared
+bool mem_written(mem_t* mem, uint16_t addr, uint32_t num_bytes);
+// Return the first written chunk index (address >> MEM_WRITE_WATCH_SHIFT) from chunk on, or -1
+int mem_next_written(mem_t* mem, uint32_t chunk);
+// Clear the write watch bits of all chunks overlapping a range, (0, MEM_ADDR_RANGE) clears all
+void mem_clear_written(mem_t* mem, uint16_t addr, uint32_t num_bytes);
+#endif  // MEM_WRITE_WATCH
+#ifdef MEM_WRITE_HOOK
+// Set the write hook (NULL removes it) and arm all chunks, a chunk is armed again when its page is remapped
+void mem_set_write_hook(mem_t* mem, mem_write_hook_t hook, void* user_data);
+// Disarm the chunk of addr and call the write hook, for writes to armed chunks
+void mem_call_write_hook(mem_t* mem, uint16_t addr);
+#endif  // MEM_WRITE_HOOK
+
+// Return true if a read (rw) or write (!rw) access to a 16-bit address hits a trapped page
+static inline bool mem_is_trapped(mem_t* mem, uint16_t addr, bool rw) {
+    return mem->page_trap[addr >> MEM_PAGE_SHIFT] & (rw ? MEM_TRAP_READ : MEM_TRAP_WRITE);
+}
 // Read a byte at 16-bit address
 static inline uint8_t mem_rd(mem_t* mem, uint16_t addr) {
     return mem->page_table[addr >> MEM_PAGE_SHIFT].read_ptr[addr & MEM_PAGE_MASK];
 }
 // Write a byte to 16-bit address
 static inline void mem_wr(mem_t* mem, uint16_t addr, uint8_t data) {
+#ifdef MEM_WRITE_HOOK
+    if (mem->write_armed[addr >> (MEM_WRITE_WATCH_SHIFT + 5)] & (1U << ((addr >> MEM_WRITE_WATCH_SHIFT) & 31))) {
+        mem_call_write_hook(mem, addr);
+    }
+#endif
     mem->page_table[addr >> MEM_PAGE_SHIFT].write_ptr[addr & MEM_PAGE_MASK] = data;
+#ifdef MEM_PAGE_GENERATIONS
+    mem->page_gen[addr >> MEM_PAGE_SHIFT]++;
+#endif
+#ifdef MEM_WRITE_WATCH
+    mem->write_watch[addr >> (MEM_WRITE_WATCH_SHIFT + 5)] |= 1U << ((addr >> MEM_WRITE_WATCH_SHIFT) & 31);
+#endif
 }
 // Helper method to write a 16-bit value, does 2 mem_wr()
 static inline void mem_wr16(mem_t* mem, uint16_t addr, uint16_t data) {
@@ -196,18 +298,27 @@ void mem_snapshot_onload(mem_t* snapshot, void* base);
 #define CHIPS_ASSERT(c) assert(c)
 #endif
 
-// Dummy page for currently unmapped memory
-static uint8_t _mem_unmapped_page[MEM_PAGE_SIZE];
-// Write-only 'junk table' for writes to ROM areas
-static uint8_t _mem_junk_page[MEM_PAGE_SIZE];
-
 void mem_init(mem_t* m) {
     CHIPS_ASSERT(m);
     *m = (mem_t){0};
-    memset(_mem_unmapped_page, 0xFF, sizeof(_mem_unmapped_page));
+    memset(m->unmapped_page, 0xFF, sizeof(m->unmapped_page));
     mem_unmap_all(m);
 }
 
+#ifdef MEM_WRITE_HOOK
+// Arm the chunks overlapping a range if there is a write hook
+static void _mem_arm_range(mem_t* m, uint16_t addr, uint32_t num_bytes) {
+    if (m->write_hook && (num_bytes > 0)) {
+        const uint32_t first = addr >> MEM_WRITE_WATCH_SHIFT;
+        const uint32_t last = (addr + num_bytes - 1) >> MEM_WRITE_WATCH_SHIFT;
+        for (uint32_t chunk = first; chunk <= last; chunk++) {
+            const uint32_t index = chunk & (MEM_WRITE_WATCH_CHUNKS - 1);
+            m->write_armed[index >> 5] |= 1U << (index & 31);
+        }
+    }
+}
+#endif  // MEM_WRITE_HOOK
+
 // This sets the CPU-visible mapping of a page in the page-table
 static void _mem_update_page_table(mem_t* m, size_t page_index) {
     // Find highest priority layer which maps this memory page
@@ -251,9 +362,13 @@ static void _mem_update_page_table(mem_t* m, size_t page_index) {
         m->page_table[page_index].write_ptr = m->layers[layer_index][page_index].write_ptr;
     } else {
         // No mapping exists for this page, set to special 'unmapped page'
-        m->page_table[page_index].read_ptr = _mem_unmapped_page;
-        m->page_table[page_index].write_ptr = _mem_junk_page;
+        m->page_table[page_index].read_ptr = m->unmapped_page;
+        m->page_table[page_index].write_ptr = m->junk_page;
     }
+#ifdef MEM_WRITE_HOOK
+    // The writes may go to other host memory now
+    _mem_arm_range(m, (uint16_t)(page_index << MEM_PAGE_SHIFT), MEM_PAGE_SIZE);
+#endif
 }
 
 static void _mem_map(mem_t* m, size_t layer, uint16_t addr, uint32_t size, const uint8_t* read_ptr,
@@ -275,7 +390,7 @@ static void _mem_map(mem_t* m, size_t layer, uint16_t addr, uint32_t size, const
         if (0 != write_ptr) {
             page->write_ptr = write_ptr + offset;
         } else {
-            page->write_ptr = _mem_junk_page;
+            page->write_ptr = m->junk_page;
         }
         _mem_update_page_table(m, page_index);
     }
@@ -296,6 +411,39 @@ void mem_map_rw(mem_t* m, size_t layer, uint16_t addr, uint32_t size, const uint
     _mem_map(m, layer, addr, size, read_ptr, write_ptr);
 }
 
+void mem_init_pages(mem_t* m, mem_page_t* pages, uint32_t size, const uint8_t* read_ptr, uint8_t* write_ptr) {
+    CHIPS_ASSERT(m && pages && read_ptr);
+    CHIPS_ASSERT((size & MEM_PAGE_MASK) == 0);
+    const size_t num = size >> MEM_PAGE_SHIFT;
+    for (size_t i = 0; i < num; i++) {
+        const uint32_t offset = i * MEM_PAGE_SIZE;
+        pages[i].read_ptr = (uint8_t*)read_ptr + offset;
+        pages[i].write_ptr = write_ptr ? write_ptr + offset : m->junk_page;
+    }
+}
+
+void mem_map_pages(mem_t* m, size_t layer, uint16_t addr, uint32_t size, const mem_page_t* pages) {
+    CHIPS_ASSERT(m && pages);
+    CHIPS_ASSERT(layer < MEM_NUM_LAYERS);
+    CHIPS_ASSERT((addr & MEM_PAGE_MASK) == 0);
+    CHIPS_ASSERT((size & MEM_PAGE_MASK) == 0);
+    CHIPS_ASSERT((addr + size) <= MEM_ADDR_RANGE);
+    const size_t first = addr >> MEM_PAGE_SHIFT;
+    const size_t num = size >> MEM_PAGE_SHIFT;
+    memcpy(&m->layers[layer][first], pages, num * sizeof(mem_page_t));
+#if MEM_NUM_LAYERS == 1
+    // The only layer is what the CPU sees
+    memcpy(&m->page_table[first], pages, num * sizeof(mem_page_t));
+#ifdef MEM_WRITE_HOOK
+    _mem_arm_range(m, addr, size);
+#endif
+#else
+    for (size_t page_index = first; page_index < first + num; page_index++) {
+        _mem_update_page_table(m, page_index);
+    }
+#endif
+}
+
 void mem_unmap_layer(mem_t* m, size_t layer) {
     CHIPS_ASSERT(m);
     CHIPS_ASSERT(layer < MEM_NUM_LAYERS);
@@ -336,6 +484,167 @@ void mem_write_range(mem_t* m, uint16_t addr, const uint8_t* src, uint32_t num_b
     }
 }
 
+#ifdef MEM_WRITE_WATCH
+// Set the write watch bits of all chunks overlapping a range
+static void _mem_watch_range(mem_t* m, uint16_t addr, uint32_t num_bytes) {
+    if (num_bytes > 0) {
+        const uint32_t first = addr >> MEM_WRITE_WATCH_SHIFT;
+        const uint32_t last = (addr + num_bytes - 1) >> MEM_WRITE_WATCH_SHIFT;
+        for (uint32_t chunk = first; chunk <= last; chunk++) {
+            const uint32_t index = chunk & (MEM_WRITE_WATCH_CHUNKS - 1);
+            m->write_watch[index >> 5] |= 1U << (index & 31);
+        }
+    }
+}
+#endif  // MEM_WRITE_WATCH
+
+// Bytes from addr to the end of its page, at most num_bytes
+static inline uint32_t _mem_page_run(uint16_t addr, uint32_t num_bytes) {
+    const uint32_t run = MEM_PAGE_SIZE - (addr & MEM_PAGE_MASK);
+    return (run < num_bytes) ? run : num_bytes;
+}
+
+void mem_copy_in(mem_t* m, uint16_t addr, const uint8_t* src, uint32_t num_bytes) {
+    CHIPS_ASSERT(m && (src || (num_bytes == 0)));
+    while (num_bytes > 0) {
+        const uint32_t run = _mem_page_run(addr, num_bytes);
+        const uint32_t page_index = addr >> MEM_PAGE_SHIFT;
+#ifdef MEM_WRITE_HOOK
+        // The run stays within one page, and with it within the chunks of that page
+        const uint32_t last_chunk = (addr + run - 1) >> MEM_WRITE_WATCH_SHIFT;
+        for (uint32_t chunk = addr >> MEM_WRITE_WATCH_SHIFT; chunk <= last_chunk; chunk++) {
+            if (m->write_armed[chunk >> 5] & (1U << (chunk & 31))) {
+                mem_call_write_hook(m, (uint16_t)(chunk << MEM_WRITE_WATCH_SHIFT));
+            }
+        }
+#endif
+        memcpy(&m->page_table[page_index].write_ptr[addr & MEM_PAGE_MASK], src, run);
+#ifdef MEM_PAGE_GENERATIONS
+        m->page_gen[page_index]++;
+#endif
+#ifdef MEM_WRITE_WATCH
+        _mem_watch_range(m, addr, run);
+#endif
+        // The address wraps around at $FFFF
+        addr = (uint16_t)(addr + run);
+        src += run;
+        num_bytes -= run;
+    }
+}
+
+void mem_copy_out(mem_t* m, uint16_t addr, uint8_t* dst, uint32_t num_bytes) {
+    CHIPS_ASSERT(m && (dst || (num_bytes == 0)));
+    while (num_bytes > 0) {
+        const uint32_t run = _mem_page_run(addr, num_bytes);
+        memcpy(dst, &m->page_table[addr >> MEM_PAGE_SHIFT].read_ptr[addr & MEM_PAGE_MASK], run);
+        addr = (uint16_t)(addr + run);
+        dst += run;
+        num_bytes -= run;
+    }
+}
+
+void mem_add_trap(mem_t* m, uint16_t addr, uint32_t size, uint8_t flags) {
+    CHIPS_ASSERT(m);
+    CHIPS_ASSERT((size > 0) && ((addr + size) <= MEM_ADDR_RANGE));
+    CHIPS_ASSERT((flags & ~(MEM_TRAP_READ | MEM_TRAP_WRITE)) == 0);
+    const uint32_t first = addr >> MEM_PAGE_SHIFT;
+    const uint32_t last = (addr + size - 1) >> MEM_PAGE_SHIFT;
+    for (uint32_t page = first; page <= last; page++) {
+        m->page_trap[page] |= flags;
+    }
+}
+
+void mem_clear_traps(mem_t* m) {
+    CHIPS_ASSERT(m);
+    memset(m->page_trap, 0, sizeof(m->page_trap));
+}
+
+void mem_mark_written(mem_t* m, uint16_t addr, uint32_t num_bytes) {
+    CHIPS_ASSERT(m);
+#ifdef MEM_PAGE_GENERATIONS
+    if (num_bytes > 0) {
+        const uint32_t first = addr >> MEM_PAGE_SHIFT;
+        const uint32_t last = (addr + num_bytes - 1) >> MEM_PAGE_SHIFT;
+        for (uint32_t page = first; page <= last; page++) {
+            m->page_gen[page & (MEM_NUM_PAGES - 1)]++;
+        }
+    }
+#endif
+#ifdef MEM_WRITE_WATCH
+    _mem_watch_range(m, addr, num_bytes);
+#endif
+#if !defined(MEM_PAGE_GENERATIONS) && !defined(MEM_WRITE_WATCH)
+    (void)addr;
+    (void)num_bytes;
+#endif
+}
+
+#ifdef MEM_WRITE_WATCH
+bool mem_written(mem_t* m, uint16_t addr, uint32_t num_bytes) {
+    CHIPS_ASSERT(m);
+    if (num_bytes > 0) {
+        const uint32_t first = addr >> MEM_WRITE_WATCH_SHIFT;
+        const uint32_t last = (addr + num_bytes - 1) >> MEM_WRITE_WATCH_SHIFT;
+        for (uint32_t chunk = first; chunk <= last; chunk++) {
+            const uint32_t index = chunk & (MEM_WRITE_WATCH_CHUNKS - 1);
+            if (m->write_watch[index >> 5] & (1U << (index & 31))) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int mem_next_written(mem_t* m, uint32_t chunk) {
+    CHIPS_ASSERT(m);
+    while (chunk < MEM_WRITE_WATCH_CHUNKS) {
+        // Skip whole words without written chunks
+        const uint32_t bits = m->write_watch[chunk >> 5] >> (chunk & 31);
+        if (bits) {
+            uint32_t bit = 0;
+            while (!(bits & (1U << bit))) {
+                bit++;
+            }
+            return (int)(chunk + bit);
+        }
+        chunk = (chunk | 31) + 1;
+    }
+    return -1;
+}
+
+void mem_clear_written(mem_t* m, uint16_t addr, uint32_t num_bytes) {
+    CHIPS_ASSERT(m);
+    if (num_bytes > 0) {
+        const uint32_t first = addr >> MEM_WRITE_WATCH_SHIFT;
+        const uint32_t last = (addr + num_bytes - 1) >> MEM_WRITE_WATCH_SHIFT;
+        for (uint32_t chunk = first; chunk <= last; chunk++) {
+            const uint32_t index = chunk & (MEM_WRITE_WATCH_CHUNKS - 1);
+            m->write_watch[index >> 5] &= ~(1U << (index & 31));
+        }
+    }
+}
+#endif  // MEM_WRITE_WATCH
+
+#ifdef MEM_WRITE_HOOK
+void mem_set_write_hook(mem_t* m, mem_write_hook_t hook, void* user_data) {
+    CHIPS_ASSERT(m);
+    m->write_hook = hook;
+    m->write_hook_user_data = user_data;
+    memset(m->write_armed, hook ? 0xFF : 0, sizeof(m->write_armed));
+}
+
+void mem_call_write_hook(mem_t* m, uint16_t addr) {
+    CHIPS_ASSERT(m);
+    const uint32_t chunk = addr >> MEM_WRITE_WATCH_SHIFT;
+    m->write_armed[chunk >> 5] &= ~(1U << (chunk & 31));
+    if (m->write_hook) {
+        const uint16_t chunk_addr = (uint16_t)(chunk << MEM_WRITE_WATCH_SHIFT);
+        uint8_t* host = &m->page_table[addr >> MEM_PAGE_SHIFT].write_ptr[chunk_addr & MEM_PAGE_MASK];
+        m->write_hook(host, m->write_hook_user_data);
+    }
+}
+#endif  // MEM_WRITE_HOOK
+
 uint8_t mem_layer_rd(mem_t* mem, size_t layer, uint16_t addr) {
     CHIPS_ASSERT(layer < MEM_NUM_LAYERS);
     if (mem->layers[layer][addr >> MEM_PAGE_SHIFT].read_ptr) {
@@ -348,25 +657,29 @@ uint8_t mem_layer_rd(mem_t* mem, size_t layer, uint16_t addr) {
 void mem_layer_wr(mem_t* mem, size_t layer, uint16_t addr, uint8_t data) {
     CHIPS_ASSERT(layer < MEM_NUM_LAYERS);
     if (mem->layers[layer][addr >> MEM_PAGE_SHIFT].write_ptr) {
+#ifdef MEM_WRITE_HOOK
+        // The hook sees the CPU-visible mapping, with one layer that is this one
+        if (mem->write_armed[addr >> (MEM_WRITE_WATCH_SHIFT + 5)] & (1U << ((addr >> MEM_WRITE_WATCH_SHIFT) & 31))) {
+            mem_call_write_hook(mem, addr);
+        }
+#endif
         mem->layers[layer][addr >> MEM_PAGE_SHIFT].write_ptr[addr & MEM_PAGE_MASK] = data;
+        mem_mark_written(mem, addr, 1);
     }
 }
 
-#define MEM_SPECIAL_OFFSET_NULLPTR       (-1)
-#define MEM_SPECIAL_OFFSET_UNMAPPED_PAGE (-2)
-#define MEM_SPECIAL_OFFSET_JUNK_PAGE     (-3)
+#define MEM_SPECIAL_OFFSET_NULLPTR (-1)
 
+// The unmapped and junk pages are part of mem_t, and with it of the base the offsets are relative to
 static void mem_ptr_to_offset(uint8_t** ptr_ptr, uint8_t* base) {
     uint8_t* ptr = *ptr_ptr;
     if (ptr == 0) {
         *ptr_ptr = (uint8_t*)(intptr_t)MEM_SPECIAL_OFFSET_NULLPTR;
-    } else if (ptr == _mem_unmapped_page) {
-        *ptr_ptr = (uint8_t*)(intptr_t)MEM_SPECIAL_OFFSET_UNMAPPED_PAGE;
-    } else if (ptr == _mem_junk_page) {
-        *ptr_ptr = (uint8_t*)(intptr_t)MEM_SPECIAL_OFFSET_JUNK_PAGE;
     } else {
-        CHIPS_ASSERT(base <= *ptr_ptr);
-        *ptr_ptr = (uint8_t*)(*ptr_ptr - base);
+        // ROM images are separate objects outside the system struct, so this is integer and not pointer
+        // arithmetic. Their offsets only come back as valid pointers for the same base, systems that load
+        // snapshots into another instance map their ROMs again
+        *ptr_ptr = (uint8_t*)((uintptr_t)ptr - (uintptr_t)base);
     }
 }
 
@@ -376,20 +689,18 @@ static void mem_offset_to_ptr(uint8_t** ptr_ptr, uint8_t* base) {
         case MEM_SPECIAL_OFFSET_NULLPTR:
             *ptr_ptr = 0;
             break;
-        case MEM_SPECIAL_OFFSET_UNMAPPED_PAGE:
-            *ptr_ptr = _mem_unmapped_page;
-            break;
-        case MEM_SPECIAL_OFFSET_JUNK_PAGE:
-            *ptr_ptr = _mem_junk_page;
-            break;
         default:
-            *ptr_ptr = (base + offset);
+            *ptr_ptr = (uint8_t*)((uintptr_t)base + (uintptr_t)offset);
             break;
     }
 }
 
 void mem_snapshot_onsave(mem_t* snapshot, void* base) {
     uint8_t* base8 = (uint8_t*)base;
+#ifdef MEM_WRITE_HOOK
+    // The hook belongs to the instance, not to its snapshots
+    mem_set_write_hook(snapshot, 0, 0);
+#endif
     for (size_t page = 0; page < MEM_NUM_PAGES; page++) {
         mem_ptr_to_offset(&snapshot->page_table[page].read_ptr, base8);
         mem_ptr_to_offset(&snapshot->page_table[page].write_ptr, base8);
@@ -0,0 +1,2693 @@
+#pragma once
+
+// mos6502cpu_exec.h
+//
+// Instruction-granular execution for mos6502cpu.h.
+//
+// Do this:
+// ~~~C
+// #define CHIPS_IMPL
+// ~~~
+// before you include this file in *one* C or C++ file to create the
+// implementation.
+//
+// Include the following headers before including mos6502cpu_exec.h:
+//
+// - chips/chips_common.h
+// - chips/mos6502cpu.h
+// - chips/mem.h
+//
+// ## Overview
+//
+// mos6502cpu_tick() runs one clock cycle per call and leaves the memory access
+// of that cycle to the system. mos6502cpu_exec() runs a whole instruction per
+// call and returns the number of clock cycles it took. Memory is read and
+// written directly through the mem.h page table, only accesses to registered
+// I/O ranges are handed to the system's I/O callback:
+//
+// ~~~C
+// mos6502cpu_bus_t bus;
+// mos6502cpu_bus_init(&bus, &(mos6502cpu_bus_desc_t){
+//     .mem = &sys->mem,
+//     .io_cb = my_io_callback,
+//     .user_data = sys,
+// });
+// mos6502cpu_bus_add_io_range(&bus, 0xC000, 0xCFFF);
+// while (ticks < num_ticks) {
+//     ticks += mos6502cpu_exec(&sys->cpu, &bus);
+// }
+// ~~~
+//
+// I/O ranges have a granularity of 256 bytes. Write traps are I/O ranges that
+// only catch write accesses, reads from them go to the page table (useful
+// for tracking writes to video memory).
+//
+// The number of cycles and the order of bus accesses are the same as with
+// mos6502cpu_tick(), including dummy reads and the dummy write of
+// read-modify-write instructions. Dummy accesses are skipped unless they hit
+// an I/O range. The system sees all accesses of an instruction at once, so
+// cycle-exact effects inside an instruction are not visible.
+//
+// The I/O callback gets the data byte for writes and returns the data byte
+// for reads:
+//
+// ~~~C
+// uint8_t my_io_callback(uint16_t addr, bool rw, uint8_t data, void* user_data)
+// ~~~
+//
+// mos6502cpu_exec() expects the CPU at an instruction boundary (the opcode
+// fetch of the previous instruction has happened and is in c->data), and
+// leaves it at the next one. When it is called in the middle of an
+// instruction, on JAM opcodes and while an interrupt, reset or RDY is pending,
+// it falls back to mos6502cpu_exec_tick(), which runs a single
+// mos6502cpu_tick() and performs its memory access on the bus. So both can be
+// mixed freely, interrupts are only delayed until the end of the current
+// instruction. The mos6510cpu I/O port is not supported.
+//
+// ## Block cache
+//
+// When MEM_PAGE_GENERATIONS is defined before including mem.h, mem_wr()
+// counts the writes to every page and mos6502cpu_exec_cached() becomes
+// available. It keeps predecoded runs of instructions (blocks) in a
+// caller-provided cache, keyed by the host address of the code (so each
+// memory bank has its own blocks) and the CPU address. A block is thrown away
+// as soon as its page has been written to, and a running block stops after
+// a write to its own page, so self-modifying code works:
+//
+// ~~~C
+// static mos6502cpu_block_cache_t cache;
+// mos6502cpu_block_cache_init(&cache);
+// while (ticks < num_ticks) {
+//     ticks += mos6502cpu_exec_cached(&sys->cpu, &bus, &cache, num_ticks - ticks);
+// }
+// ~~~
+//
+// The result is the same as calling mos6502cpu_exec() until num_cycles have
+// passed or an instruction accessed an I/O range (so the system gets a chance
+// to react to I/O). The system clock lags behind while a call runs, I/O
+// callbacks that need the current time find the number of cycles since the
+// start of the call in bus->cycles. Code in I/O ranges, in the zero and stack
+// pages and at pending interrupts goes through mos6502cpu_exec(). Memory that
+// is modified without mem_wr() (e.g. through mem_writeptr()) must be reported
+// with mem_mark_written(), and the same host memory must not be mapped to two
+// CPU addresses at once. Call mos6502cpu_block_cache_init() again after
+// restoring memory from a snapshot.
+//
+// ## zlib/libpng license
+//
+// Copyright (c) 2023 Veselin Sladkov
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//     1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software in a
+//     product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//     2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//     3. This notice may not be removed or altered from any source
+//     distribution.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MOS6502CPU_EXEC(c, bus) mos6502cpu_exec(c, bus)
+
+// Number of 32-bit words in an I/O page bitmap (one bit per 256 byte page)
+#define MOS6502CPU_BUS_IO_WORDS (8)
+
+// I/O callback, returns the data byte for reads
+typedef uint8_t (*mos6502cpu_io_t)(uint16_t addr, bool rw, uint8_t data, void* user_data);
+
+// The desc structure provided to mos6502cpu_bus_init()
+typedef struct {
+    mem_t* mem;               // Memory map used for all non-I/O accesses
+    mos6502cpu_io_t io_cb;    // I/O callback
+    void* user_data;          // Optional I/O callback user data
+} mos6502cpu_bus_desc_t;
+
+// Bus state for mos6502cpu_exec()
+typedef struct {
+    mem_t* mem;
+    mos6502cpu_io_t io_cb;
+    void* user_data;
+    uint32_t io_rd_pages[MOS6502CPU_BUS_IO_WORDS];  // Pages where reads go to the I/O callback
+    uint32_t io_wr_pages[MOS6502CPU_BUS_IO_WORDS];  // Pages where writes go to the I/O callback
+    uint32_t io_accesses;                           // Number of I/O callback invocations
+    uint32_t cycles;  // Cycles of the current mos6502cpu_exec_cached() call before the current instruction
+} mos6502cpu_bus_t;
+
+// Initialize a new bus instance without any I/O ranges
+void mos6502cpu_bus_init(mos6502cpu_bus_t* bus, const mos6502cpu_bus_desc_t* desc);
+// Route reads and writes in [first, last] to the I/O callback (256 byte granularity)
+void mos6502cpu_bus_add_io_range(mos6502cpu_bus_t* bus, uint16_t first, uint16_t last);
+// Route writes in [first, last] to the I/O callback (256 byte granularity)
+void mos6502cpu_bus_add_write_trap(mos6502cpu_bus_t* bus, uint16_t first, uint16_t last);
+// Execute one instruction, returns the number of clock cycles
+uint32_t mos6502cpu_exec(mos6502cpu_t* c, mos6502cpu_bus_t* bus);
+// Execute one clock cycle with mos6502cpu_tick() and perform its memory access on the bus, returns 1
+uint32_t mos6502cpu_exec_tick(mos6502cpu_t* c, mos6502cpu_bus_t* bus);
+
+// Instruction handler, called with PC past the instruction and its operand bytes, returns the number of clock cycles
+typedef uint32_t (*mos6502cpu_op_t)(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand);
+
+#ifdef MEM_PAGE_GENERATIONS
+#define MOS6502CPU_EXEC_CACHED(c, bus, cache, num_cycles) mos6502cpu_exec_cached(c, bus, cache, num_cycles)
+
+#ifndef MOS6502CPU_BLOCK_CACHE_SIZE
+// Number of cached blocks (must be a power of 2)
+#define MOS6502CPU_BLOCK_CACHE_SIZE (256)
+#endif  // MOS6502CPU_BLOCK_CACHE_SIZE
+
+// Maximum number of instructions in a block
+#define MOS6502CPU_BLOCK_MAX_INSTRS (16)
+
+// Predecoded instruction
+typedef struct {
+    mos6502cpu_op_t op;
+    uint16_t operand;
+    uint8_t opcode;
+    uint8_t length;
+} mos6502cpu_instr_t;
+
+// Straight run of instructions inside one mem.h page, ends with a jump or branch
+typedef struct {
+    const uint8_t* code;  // Host address of the first opcode, 0 when unused
+    uint32_t gen;         // Generation of the mem.h page when it was decoded
+    uint16_t pc;          // CPU address of the first opcode
+    uint8_t num_instrs;
+    mos6502cpu_instr_t instrs[MOS6502CPU_BLOCK_MAX_INSTRS];
+} mos6502cpu_block_t;
+
+// Direct-mapped cache of predecoded blocks
+typedef struct {
+    mos6502cpu_block_t blocks[MOS6502CPU_BLOCK_CACHE_SIZE];
+} mos6502cpu_block_cache_t;
+
+// Empty the block cache
+void mos6502cpu_block_cache_init(mos6502cpu_block_cache_t* cache);
+// Execute instructions until num_cycles have passed or an instruction accessed I/O, returns the number of clock cycles
+uint32_t mos6502cpu_exec_cached(mos6502cpu_t* c, mos6502cpu_bus_t* bus, mos6502cpu_block_cache_t* cache,
+                                uint32_t num_cycles);
+#endif  // MEM_PAGE_GENERATIONS
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+/*-- IMPLEMENTATION ----------------------------------------------------------*/
+#ifdef CHIPS_IMPL
+#include <string.h>
+#ifndef CHIPS_ASSERT
+#include <assert.h>
+#define CHIPS_ASSERT(c) assert(c)
+#endif
+
+// Read a byte
+#define _RD(a) _mos6502cpu_bus_rd(bus, a)
+// Write a byte
+#define _WR(a, d) _mos6502cpu_bus_wr(bus, a, d)
+// Dummy read, only visible to I/O
+#define _DUMMY_RD(a) _mos6502cpu_bus_dummy_rd(bus, a)
+// Dummy write, only visible to I/O
+#define _DUMMY_WR(a, d) _mos6502cpu_bus_dummy_wr(bus, a, d)
+// Set N and Z flags depending on value
+#define _NZ(v) (c->nf = (v & 0x80) != 0, c->zf = (v & 0xFF) == 0)
+
+static void _mos6502cpu_bus_set_pages(uint32_t* pages, uint16_t first, uint16_t last) {
+    CHIPS_ASSERT((first & 0xFF) == 0x00 && (last & 0xFF) == 0xFF && first <= last);
+    for (uint32_t page = first >> 8; page <= (uint32_t)(last >> 8); page++) {
+        pages[page >> 5] |= 1U << (page & 0x1F);
+    }
+}
+
+static inline bool _mos6502cpu_bus_is_io(const uint32_t* pages, uint16_t addr) {
+    return (pages[addr >> 13] >> ((addr >> 8) & 0x1F)) & 1;
+}
+
+static inline uint8_t _mos6502cpu_bus_rd(mos6502cpu_bus_t* bus, uint16_t addr) {
+    if (_mos6502cpu_bus_is_io(bus->io_rd_pages, addr)) {
+        bus->io_accesses++;
+        return bus->io_cb(addr, true, 0, bus->user_data);
+    }
+    return mem_rd(bus->mem, addr);
+}
+
+static inline void _mos6502cpu_bus_wr(mos6502cpu_bus_t* bus, uint16_t addr, uint8_t data) {
+    if (_mos6502cpu_bus_is_io(bus->io_wr_pages, addr)) {
+        bus->io_accesses++;
+        bus->io_cb(addr, false, data, bus->user_data);
+    } else {
+        mem_wr(bus->mem, addr, data);
+    }
+}
+
+static inline void _mos6502cpu_bus_dummy_rd(mos6502cpu_bus_t* bus, uint16_t addr) {
+    if (_mos6502cpu_bus_is_io(bus->io_rd_pages, addr)) {
+        bus->io_accesses++;
+        bus->io_cb(addr, true, 0, bus->user_data);
+    }
+}
+
+static inline void _mos6502cpu_bus_dummy_wr(mos6502cpu_bus_t* bus, uint16_t addr, uint8_t data) {
+    if (_mos6502cpu_bus_is_io(bus->io_wr_pages, addr)) {
+        bus->io_accesses++;
+        bus->io_cb(addr, false, data, bus->user_data);
+    }
+}
+
+// Addressing modes, each takes the operand bytes and returns the effective
+// address after performing the dummy reads of the mode
+
+// Fetch a 16-bit operand through the bus
+static inline uint16_t _mos6502cpu_fetch16(mos6502cpu_t* c, mos6502cpu_bus_t* bus) {
+    uint16_t lo = _RD(c->PC++);
+    return (_RD(c->PC++) << 8) | lo;
+}
+
+static inline uint16_t _mos6502cpu_ea_zpi(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint8_t zp, uint8_t index) {
+    _DUMMY_RD(zp);
+    return (uint8_t)(zp + index);
+}
+
+// abs,X and abs,Y for reads, crossing a page costs a dummy read and a cycle
+static inline uint16_t _mos6502cpu_ea_absi(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t base, uint8_t index,
+                                           uint32_t* cycles) {
+    uint16_t addr = base + index;
+    if ((base ^ addr) & 0xFF00) {
+        _DUMMY_RD((base & 0xFF00) | (addr & 0x00FF));
+        (*cycles)++;
+    }
+    return addr;
+}
+
+// abs,X and abs,Y for writes and read-modify-writes, always with dummy read
+static inline uint16_t _mos6502cpu_ea_absi_w(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t base, uint8_t index) {
+    uint16_t addr = base + index;
+    _DUMMY_RD((base & 0xFF00) | (addr & 0x00FF));
+    return addr;
+}
+
+static inline uint16_t _mos6502cpu_ea_izx(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint8_t zp) {
+    _DUMMY_RD(zp);
+    zp += c->X;
+    uint16_t lo = _RD(zp);
+    return (_RD((uint8_t)(zp + 1)) << 8) | lo;
+}
+
+// (zp),Y for reads, crossing a page costs a dummy read and a cycle
+static inline uint16_t _mos6502cpu_ea_izy(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint8_t zp, uint32_t* cycles) {
+    uint16_t lo = _RD(zp);
+    uint16_t base = (_RD((uint8_t)(zp + 1)) << 8) | lo;
+    uint16_t addr = base + c->Y;
+    if ((base ^ addr) & 0xFF00) {
+        _DUMMY_RD((base & 0xFF00) | (addr & 0x00FF));
+        (*cycles)++;
+    }
+    return addr;
+}
+
+// (zp),Y for writes and read-modify-writes, always with dummy read
+static inline uint16_t _mos6502cpu_ea_izy_w(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint8_t zp) {
+    uint16_t lo = _RD(zp);
+    uint16_t base = (_RD((uint8_t)(zp + 1)) << 8) | lo;
+    uint16_t addr = base + c->Y;
+    _DUMMY_RD((base & 0xFF00) | (addr & 0x00FF));
+    return addr;
+}
+
+// Conditional branch, returns the number of cycles (2, 3 when taken, 4 when crossing a page)
+static inline uint32_t _mos6502cpu_branch(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint8_t offset, bool taken) {
+    if (!taken) {
+        return 2;
+    }
+    _DUMMY_RD(c->PC);
+    uint16_t addr = c->PC + (int8_t)offset;
+    if ((addr ^ c->PC) & 0xFF00) {
+        _DUMMY_RD((c->PC & 0xFF00) | (addr & 0x00FF));
+        c->PC = addr;
+        return 4;
+    }
+    c->PC = addr;
+    return 3;
+}
+
+void mos6502cpu_bus_init(mos6502cpu_bus_t* bus, const mos6502cpu_bus_desc_t* desc) {
+    CHIPS_ASSERT(bus && desc);
+    CHIPS_ASSERT(desc->mem && desc->io_cb);
+    memset(bus, 0, sizeof(mos6502cpu_bus_t));
+    bus->mem = desc->mem;
+    bus->io_cb = desc->io_cb;
+    bus->user_data = desc->user_data;
+}
+
+void mos6502cpu_bus_add_io_range(mos6502cpu_bus_t* bus, uint16_t first, uint16_t last) {
+    CHIPS_ASSERT(bus);
+    _mos6502cpu_bus_set_pages(bus->io_rd_pages, first, last);
+    _mos6502cpu_bus_set_pages(bus->io_wr_pages, first, last);
+}
+
+void mos6502cpu_bus_add_write_trap(mos6502cpu_bus_t* bus, uint16_t first, uint16_t last) {
+    CHIPS_ASSERT(bus);
+    _mos6502cpu_bus_set_pages(bus->io_wr_pages, first, last);
+}
+
+uint32_t mos6502cpu_exec_tick(mos6502cpu_t* c, mos6502cpu_bus_t* bus) {
+    mos6502cpu_tick(c);
+    if (c->rw) {
+        c->data = _RD(c->addr);
+    } else {
+        _WR(c->addr, c->data);
+    }
+    return 1;
+}
+
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable : 4244)  // Conversion from 'uint16_t' to 'uint8_t', possible loss of data
+#endif
+
+// Pending interrupts, resets and RDY are handled by the cycle-stepped core
+static inline bool _mos6502cpu_exec_pending(mos6502cpu_t* c) {
+    return !c->sync || (c->irq && !c->iflag) || c->nmi_triggered || c->rdy || c->res || c->irq_pip || c->nmi_pip;
+}
+
+// Instruction handlers, called with the operand bytes already fetched, by
+// mos6502cpu_exec() through the bus and by predecoded blocks from the cache
+
+// BRK
+static uint32_t _mos6502cpu_op_00(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _WR(0x0100 | c->S--, c->PC >> 8);
+    _WR(0x0100 | c->S--, c->PC);
+    _WR(0x0100 | c->S--, _get_flags(c) | 0x20);
+    uint8_t v = _RD(0xFFFE);
+    c->iflag = true;
+    c->bf = true;
+    c->PC = (_RD(0xFFFF) << 8) | v;
+    return 7;
+}
+
+// ORA (zp,X)
+static uint32_t _mos6502cpu_op_01(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_izx(c, bus, (uint8_t)operand));
+    c->A |= v;
+    _NZ(c->A);
+    return 6;
+}
+
+// SLO (zp,X) (undoc)
+static uint32_t _mos6502cpu_op_03(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izx(c, bus, (uint8_t)operand);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_asl(c, v);
+    c->A |= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 8;
+}
+
+// NOP zp (undoc)
+static uint32_t _mos6502cpu_op_04(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD((uint8_t)operand);
+    return 3;
+}
+
+// ORA zp
+static uint32_t _mos6502cpu_op_05(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD((uint8_t)operand);
+    c->A |= v;
+    _NZ(c->A);
+    return 3;
+}
+
+// ASL zp
+static uint32_t _mos6502cpu_op_06(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_asl(c, v);
+    _WR(addr, v);
+    return 5;
+}
+
+// SLO zp (undoc)
+static uint32_t _mos6502cpu_op_07(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_asl(c, v);
+    c->A |= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 5;
+}
+
+// PHP
+static uint32_t _mos6502cpu_op_08(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    _WR(0x0100 | c->S--, _get_flags(c) | 0x20);
+    return 3;
+}
+
+// ORA #
+static uint32_t _mos6502cpu_op_09(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    c->A |= v;
+    _NZ(c->A);
+    return 2;
+}
+
+// ASL A
+static uint32_t _mos6502cpu_op_0A(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->A = _mos6502cpu_asl(c, c->A);
+    return 2;
+}
+
+// ANC # (undoc)
+static uint32_t _mos6502cpu_op_0B(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    c->A &= v;
+    _NZ(c->A);
+    c->cf = (c->A & 0x80) != 0;
+    return 2;
+}
+
+// NOP abs (undoc)
+static uint32_t _mos6502cpu_op_0C(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(operand);
+    return 4;
+}
+
+// ORA abs
+static uint32_t _mos6502cpu_op_0D(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(operand);
+    c->A |= v;
+    _NZ(c->A);
+    return 4;
+}
+
+// ASL abs
+static uint32_t _mos6502cpu_op_0E(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_asl(c, v);
+    _WR(addr, v);
+    return 6;
+}
+
+// SLO abs (undoc)
+static uint32_t _mos6502cpu_op_0F(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_asl(c, v);
+    c->A |= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 6;
+}
+
+// BPL
+static uint32_t _mos6502cpu_op_10(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    return _mos6502cpu_branch(c, bus, (uint8_t)operand, !c->nf);
+}
+
+// ORA (zp),Y
+static uint32_t _mos6502cpu_op_11(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 5;
+    uint8_t v = _RD(_mos6502cpu_ea_izy(c, bus, (uint8_t)operand, &cycles));
+    c->A |= v;
+    _NZ(c->A);
+    return cycles;
+}
+
+// SLO (zp),Y (undoc)
+static uint32_t _mos6502cpu_op_13(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izy_w(c, bus, (uint8_t)operand);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_asl(c, v);
+    c->A |= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 8;
+}
+
+// NOP zp,X (undoc)
+static uint32_t _mos6502cpu_op_14(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X));
+    return 4;
+}
+
+// ORA zp,X
+static uint32_t _mos6502cpu_op_15(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X));
+    c->A |= v;
+    _NZ(c->A);
+    return 4;
+}
+
+// ASL zp,X
+static uint32_t _mos6502cpu_op_16(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_asl(c, v);
+    _WR(addr, v);
+    return 6;
+}
+
+// SLO zp,X (undoc)
+static uint32_t _mos6502cpu_op_17(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_asl(c, v);
+    c->A |= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 6;
+}
+
+// CLC
+static uint32_t _mos6502cpu_op_18(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->cf = false;
+    return 2;
+}
+
+// ORA abs,Y
+static uint32_t _mos6502cpu_op_19(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->Y, &cycles));
+    c->A |= v;
+    _NZ(c->A);
+    return cycles;
+}
+
+// NOP (undoc)
+static uint32_t _mos6502cpu_op_1A(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    return 2;
+}
+
+// SLO abs,Y (undoc)
+static uint32_t _mos6502cpu_op_1B(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->Y);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_asl(c, v);
+    c->A |= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 7;
+}
+
+// NOP abs,X (undoc)
+static uint32_t _mos6502cpu_op_1C(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    _DUMMY_RD(_mos6502cpu_ea_absi(c, bus, operand, c->X, &cycles));
+    return cycles;
+}
+
+// ORA abs,X
+static uint32_t _mos6502cpu_op_1D(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->X, &cycles));
+    c->A |= v;
+    _NZ(c->A);
+    return cycles;
+}
+
+// ASL abs,X
+static uint32_t _mos6502cpu_op_1E(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_asl(c, v);
+    _WR(addr, v);
+    return 7;
+}
+
+// SLO abs,X (undoc)
+static uint32_t _mos6502cpu_op_1F(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_asl(c, v);
+    c->A |= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 7;
+}
+
+// JSR
+static uint32_t _mos6502cpu_op_20(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(0x0100 | c->S);
+    _WR(0x0100 | c->S--, (c->PC - 1) >> 8);
+    _WR(0x0100 | c->S--, c->PC - 1);
+    // The high byte is fetched last, a JSR on the stack page can overwrite it
+    c->PC = (_RD(c->PC - 1) << 8) | (uint8_t)operand;
+    return 6;
+}
+
+// AND (zp,X)
+static uint32_t _mos6502cpu_op_21(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_izx(c, bus, (uint8_t)operand));
+    c->A &= v;
+    _NZ(c->A);
+    return 6;
+}
+
+// RLA (zp,X) (undoc)
+static uint32_t _mos6502cpu_op_23(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izx(c, bus, (uint8_t)operand);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_rol(c, v);
+    c->A &= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 8;
+}
+
+// BIT zp
+static uint32_t _mos6502cpu_op_24(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD((uint8_t)operand);
+    _mos6502cpu_bit(c, v);
+    return 3;
+}
+
+// AND zp
+static uint32_t _mos6502cpu_op_25(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD((uint8_t)operand);
+    c->A &= v;
+    _NZ(c->A);
+    return 3;
+}
+
+// ROL zp
+static uint32_t _mos6502cpu_op_26(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_rol(c, v);
+    _WR(addr, v);
+    return 5;
+}
+
+// RLA zp (undoc)
+static uint32_t _mos6502cpu_op_27(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_rol(c, v);
+    c->A &= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 5;
+}
+
+// PLP
+static uint32_t _mos6502cpu_op_28(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    _DUMMY_RD(0x0100 | c->S++);
+    _set_flags(c, _RD(0x0100 | c->S));
+    return 4;
+}
+
+// AND #
+static uint32_t _mos6502cpu_op_29(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    c->A &= v;
+    _NZ(c->A);
+    return 2;
+}
+
+// ROL A
+static uint32_t _mos6502cpu_op_2A(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->A = _mos6502cpu_rol(c, c->A);
+    return 2;
+}
+
+// ANC # (undoc)
+static uint32_t _mos6502cpu_op_2B(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    c->A &= v;
+    _NZ(c->A);
+    c->cf = (c->A & 0x80) != 0;
+    return 2;
+}
+
+// BIT abs
+static uint32_t _mos6502cpu_op_2C(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(operand);
+    _mos6502cpu_bit(c, v);
+    return 4;
+}
+
+// AND abs
+static uint32_t _mos6502cpu_op_2D(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(operand);
+    c->A &= v;
+    _NZ(c->A);
+    return 4;
+}
+
+// ROL abs
+static uint32_t _mos6502cpu_op_2E(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_rol(c, v);
+    _WR(addr, v);
+    return 6;
+}
+
+// RLA abs (undoc)
+static uint32_t _mos6502cpu_op_2F(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_rol(c, v);
+    c->A &= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 6;
+}
+
+// BMI
+static uint32_t _mos6502cpu_op_30(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    return _mos6502cpu_branch(c, bus, (uint8_t)operand, c->nf);
+}
+
+// AND (zp),Y
+static uint32_t _mos6502cpu_op_31(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 5;
+    uint8_t v = _RD(_mos6502cpu_ea_izy(c, bus, (uint8_t)operand, &cycles));
+    c->A &= v;
+    _NZ(c->A);
+    return cycles;
+}
+
+// RLA (zp),Y (undoc)
+static uint32_t _mos6502cpu_op_33(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izy_w(c, bus, (uint8_t)operand);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_rol(c, v);
+    c->A &= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 8;
+}
+
+// NOP zp,X (undoc)
+static uint32_t _mos6502cpu_op_34(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X));
+    return 4;
+}
+
+// AND zp,X
+static uint32_t _mos6502cpu_op_35(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X));
+    c->A &= v;
+    _NZ(c->A);
+    return 4;
+}
+
+// ROL zp,X
+static uint32_t _mos6502cpu_op_36(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_rol(c, v);
+    _WR(addr, v);
+    return 6;
+}
+
+// RLA zp,X (undoc)
+static uint32_t _mos6502cpu_op_37(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_rol(c, v);
+    c->A &= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 6;
+}
+
+// SEC
+static uint32_t _mos6502cpu_op_38(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->cf = true;
+    return 2;
+}
+
+// AND abs,Y
+static uint32_t _mos6502cpu_op_39(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->Y, &cycles));
+    c->A &= v;
+    _NZ(c->A);
+    return cycles;
+}
+
+// NOP (undoc)
+static uint32_t _mos6502cpu_op_3A(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    return 2;
+}
+
+// RLA abs,Y (undoc)
+static uint32_t _mos6502cpu_op_3B(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->Y);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_rol(c, v);
+    c->A &= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 7;
+}
+
+// NOP abs,X (undoc)
+static uint32_t _mos6502cpu_op_3C(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    _DUMMY_RD(_mos6502cpu_ea_absi(c, bus, operand, c->X, &cycles));
+    return cycles;
+}
+
+// AND abs,X
+static uint32_t _mos6502cpu_op_3D(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->X, &cycles));
+    c->A &= v;
+    _NZ(c->A);
+    return cycles;
+}
+
+// ROL abs,X
+static uint32_t _mos6502cpu_op_3E(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_rol(c, v);
+    _WR(addr, v);
+    return 7;
+}
+
+// RLA abs,X (undoc)
+static uint32_t _mos6502cpu_op_3F(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_rol(c, v);
+    c->A &= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 7;
+}
+
+// RTI
+static uint32_t _mos6502cpu_op_40(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    _DUMMY_RD(0x0100 | c->S++);
+    _set_flags(c, _RD(0x0100 | c->S++));
+    uint8_t v = _RD(0x0100 | c->S++);
+    c->PC = (_RD(0x0100 | c->S) << 8) | v;
+    return 6;
+}
+
+// EOR (zp,X)
+static uint32_t _mos6502cpu_op_41(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_izx(c, bus, (uint8_t)operand));
+    c->A ^= v;
+    _NZ(c->A);
+    return 6;
+}
+
+// SRE (zp,X) (undoc)
+static uint32_t _mos6502cpu_op_43(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izx(c, bus, (uint8_t)operand);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_lsr(c, v);
+    c->A ^= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 8;
+}
+
+// NOP zp (undoc)
+static uint32_t _mos6502cpu_op_44(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD((uint8_t)operand);
+    return 3;
+}
+
+// EOR zp
+static uint32_t _mos6502cpu_op_45(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD((uint8_t)operand);
+    c->A ^= v;
+    _NZ(c->A);
+    return 3;
+}
+
+// LSR zp
+static uint32_t _mos6502cpu_op_46(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_lsr(c, v);
+    _WR(addr, v);
+    return 5;
+}
+
+// SRE zp (undoc)
+static uint32_t _mos6502cpu_op_47(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_lsr(c, v);
+    c->A ^= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 5;
+}
+
+// PHA
+static uint32_t _mos6502cpu_op_48(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    _WR(0x0100 | c->S--, c->A);
+    return 3;
+}
+
+// EOR #
+static uint32_t _mos6502cpu_op_49(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    c->A ^= v;
+    _NZ(c->A);
+    return 2;
+}
+
+// LSR A
+static uint32_t _mos6502cpu_op_4A(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->A = _mos6502cpu_lsr(c, c->A);
+    return 2;
+}
+
+// ASR # (undoc)
+static uint32_t _mos6502cpu_op_4B(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    c->A &= v;
+    c->A = _mos6502cpu_lsr(c, c->A);
+    return 2;
+}
+
+// JMP abs
+static uint32_t _mos6502cpu_op_4C(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    c->PC = operand;
+    return 3;
+}
+
+// EOR abs
+static uint32_t _mos6502cpu_op_4D(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(operand);
+    c->A ^= v;
+    _NZ(c->A);
+    return 4;
+}
+
+// LSR abs
+static uint32_t _mos6502cpu_op_4E(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_lsr(c, v);
+    _WR(addr, v);
+    return 6;
+}
+
+// SRE abs (undoc)
+static uint32_t _mos6502cpu_op_4F(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_lsr(c, v);
+    c->A ^= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 6;
+}
+
+// BVC
+static uint32_t _mos6502cpu_op_50(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    return _mos6502cpu_branch(c, bus, (uint8_t)operand, !c->vf);
+}
+
+// EOR (zp),Y
+static uint32_t _mos6502cpu_op_51(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 5;
+    uint8_t v = _RD(_mos6502cpu_ea_izy(c, bus, (uint8_t)operand, &cycles));
+    c->A ^= v;
+    _NZ(c->A);
+    return cycles;
+}
+
+// SRE (zp),Y (undoc)
+static uint32_t _mos6502cpu_op_53(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izy_w(c, bus, (uint8_t)operand);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_lsr(c, v);
+    c->A ^= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 8;
+}
+
+// NOP zp,X (undoc)
+static uint32_t _mos6502cpu_op_54(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X));
+    return 4;
+}
+
+// EOR zp,X
+static uint32_t _mos6502cpu_op_55(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X));
+    c->A ^= v;
+    _NZ(c->A);
+    return 4;
+}
+
+// LSR zp,X
+static uint32_t _mos6502cpu_op_56(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_lsr(c, v);
+    _WR(addr, v);
+    return 6;
+}
+
+// SRE zp,X (undoc)
+static uint32_t _mos6502cpu_op_57(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_lsr(c, v);
+    c->A ^= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 6;
+}
+
+// CLI
+static uint32_t _mos6502cpu_op_58(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->iflag = false;
+    return 2;
+}
+
+// EOR abs,Y
+static uint32_t _mos6502cpu_op_59(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->Y, &cycles));
+    c->A ^= v;
+    _NZ(c->A);
+    return cycles;
+}
+
+// NOP (undoc)
+static uint32_t _mos6502cpu_op_5A(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    return 2;
+}
+
+// SRE abs,Y (undoc)
+static uint32_t _mos6502cpu_op_5B(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->Y);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_lsr(c, v);
+    c->A ^= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 7;
+}
+
+// NOP abs,X (undoc)
+static uint32_t _mos6502cpu_op_5C(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    _DUMMY_RD(_mos6502cpu_ea_absi(c, bus, operand, c->X, &cycles));
+    return cycles;
+}
+
+// EOR abs,X
+static uint32_t _mos6502cpu_op_5D(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->X, &cycles));
+    c->A ^= v;
+    _NZ(c->A);
+    return cycles;
+}
+
+// LSR abs,X
+static uint32_t _mos6502cpu_op_5E(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_lsr(c, v);
+    _WR(addr, v);
+    return 7;
+}
+
+// SRE abs,X (undoc)
+static uint32_t _mos6502cpu_op_5F(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_lsr(c, v);
+    c->A ^= v;
+    _NZ(c->A);
+    _WR(addr, v);
+    return 7;
+}
+
+// RTS
+static uint32_t _mos6502cpu_op_60(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    _DUMMY_RD(0x0100 | c->S++);
+    uint8_t v = _RD(0x0100 | c->S++);
+    c->PC = (_RD(0x0100 | c->S) << 8) | v;
+    _DUMMY_RD(c->PC++);
+    return 6;
+}
+
+// ADC (zp,X)
+static uint32_t _mos6502cpu_op_61(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_izx(c, bus, (uint8_t)operand));
+    _mos6502cpu_adc(c, v);
+    return 6;
+}
+
+// RRA (zp,X) (undoc)
+static uint32_t _mos6502cpu_op_63(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izx(c, bus, (uint8_t)operand);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_ror(c, v);
+    _mos6502cpu_adc(c, v);
+    _WR(addr, v);
+    return 8;
+}
+
+// NOP zp (undoc)
+static uint32_t _mos6502cpu_op_64(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD((uint8_t)operand);
+    return 3;
+}
+
+// ADC zp
+static uint32_t _mos6502cpu_op_65(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD((uint8_t)operand);
+    _mos6502cpu_adc(c, v);
+    return 3;
+}
+
+// ROR zp
+static uint32_t _mos6502cpu_op_66(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_ror(c, v);
+    _WR(addr, v);
+    return 5;
+}
+
+// RRA zp (undoc)
+static uint32_t _mos6502cpu_op_67(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_ror(c, v);
+    _mos6502cpu_adc(c, v);
+    _WR(addr, v);
+    return 5;
+}
+
+// PLA
+static uint32_t _mos6502cpu_op_68(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    _DUMMY_RD(0x0100 | c->S++);
+    c->A = _RD(0x0100 | c->S);
+    _NZ(c->A);
+    return 4;
+}
+
+// ADC #
+static uint32_t _mos6502cpu_op_69(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    _mos6502cpu_adc(c, v);
+    return 2;
+}
+
+// ROR A
+static uint32_t _mos6502cpu_op_6A(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->A = _mos6502cpu_ror(c, c->A);
+    return 2;
+}
+
+// ARR # (undoc)
+static uint32_t _mos6502cpu_op_6B(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    c->A &= v;
+    _mos6502cpu_arr(c);
+    return 2;
+}
+
+// JMP (abs)
+static uint32_t _mos6502cpu_op_6C(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    uint8_t v = _RD(addr);
+    c->PC = (_RD((addr & 0xFF00) | ((addr + 1) & 0x00FF)) << 8) | v;
+    return 5;
+}
+
+// ADC abs
+static uint32_t _mos6502cpu_op_6D(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(operand);
+    _mos6502cpu_adc(c, v);
+    return 4;
+}
+
+// ROR abs
+static uint32_t _mos6502cpu_op_6E(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_ror(c, v);
+    _WR(addr, v);
+    return 6;
+}
+
+// RRA abs (undoc)
+static uint32_t _mos6502cpu_op_6F(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_ror(c, v);
+    _mos6502cpu_adc(c, v);
+    _WR(addr, v);
+    return 6;
+}
+
+// BVS
+static uint32_t _mos6502cpu_op_70(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    return _mos6502cpu_branch(c, bus, (uint8_t)operand, c->vf);
+}
+
+// ADC (zp),Y
+static uint32_t _mos6502cpu_op_71(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 5;
+    uint8_t v = _RD(_mos6502cpu_ea_izy(c, bus, (uint8_t)operand, &cycles));
+    _mos6502cpu_adc(c, v);
+    return cycles;
+}
+
+// RRA (zp),Y (undoc)
+static uint32_t _mos6502cpu_op_73(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izy_w(c, bus, (uint8_t)operand);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_ror(c, v);
+    _mos6502cpu_adc(c, v);
+    _WR(addr, v);
+    return 8;
+}
+
+// NOP zp,X (undoc)
+static uint32_t _mos6502cpu_op_74(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X));
+    return 4;
+}
+
+// ADC zp,X
+static uint32_t _mos6502cpu_op_75(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X));
+    _mos6502cpu_adc(c, v);
+    return 4;
+}
+
+// ROR zp,X
+static uint32_t _mos6502cpu_op_76(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_ror(c, v);
+    _WR(addr, v);
+    return 6;
+}
+
+// RRA zp,X (undoc)
+static uint32_t _mos6502cpu_op_77(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_ror(c, v);
+    _mos6502cpu_adc(c, v);
+    _WR(addr, v);
+    return 6;
+}
+
+// SEI
+static uint32_t _mos6502cpu_op_78(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->iflag = true;
+    return 2;
+}
+
+// ADC abs,Y
+static uint32_t _mos6502cpu_op_79(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->Y, &cycles));
+    _mos6502cpu_adc(c, v);
+    return cycles;
+}
+
+// NOP (undoc)
+static uint32_t _mos6502cpu_op_7A(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    return 2;
+}
+
+// RRA abs,Y (undoc)
+static uint32_t _mos6502cpu_op_7B(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->Y);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_ror(c, v);
+    _mos6502cpu_adc(c, v);
+    _WR(addr, v);
+    return 7;
+}
+
+// NOP abs,X (undoc)
+static uint32_t _mos6502cpu_op_7C(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    _DUMMY_RD(_mos6502cpu_ea_absi(c, bus, operand, c->X, &cycles));
+    return cycles;
+}
+
+// ADC abs,X
+static uint32_t _mos6502cpu_op_7D(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->X, &cycles));
+    _mos6502cpu_adc(c, v);
+    return cycles;
+}
+
+// ROR abs,X
+static uint32_t _mos6502cpu_op_7E(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_ror(c, v);
+    _WR(addr, v);
+    return 7;
+}
+
+// RRA abs,X (undoc)
+static uint32_t _mos6502cpu_op_7F(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v = _mos6502cpu_ror(c, v);
+    _mos6502cpu_adc(c, v);
+    _WR(addr, v);
+    return 7;
+}
+
+// NOP # (undoc)
+static uint32_t _mos6502cpu_op_80(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    return 2;
+}
+
+// STA (zp,X)
+static uint32_t _mos6502cpu_op_81(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izx(c, bus, (uint8_t)operand);
+    _WR(addr, c->A);
+    return 6;
+}
+
+// NOP # (undoc)
+static uint32_t _mos6502cpu_op_82(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    return 2;
+}
+
+// SAX (zp,X) (undoc)
+static uint32_t _mos6502cpu_op_83(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izx(c, bus, (uint8_t)operand);
+    _WR(addr, c->A & c->X);
+    return 6;
+}
+
+// STY zp
+static uint32_t _mos6502cpu_op_84(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    _WR(addr, c->Y);
+    return 3;
+}
+
+// STA zp
+static uint32_t _mos6502cpu_op_85(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    _WR(addr, c->A);
+    return 3;
+}
+
+// STX zp
+static uint32_t _mos6502cpu_op_86(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    _WR(addr, c->X);
+    return 3;
+}
+
+// SAX zp (undoc)
+static uint32_t _mos6502cpu_op_87(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    _WR(addr, c->A & c->X);
+    return 3;
+}
+
+// DEY
+static uint32_t _mos6502cpu_op_88(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->Y--;
+    _NZ(c->Y);
+    return 2;
+}
+
+// NOP # (undoc)
+static uint32_t _mos6502cpu_op_89(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    return 2;
+}
+
+// TXA
+static uint32_t _mos6502cpu_op_8A(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->A = c->X;
+    _NZ(c->A);
+    return 2;
+}
+
+// ANE # (undoc)
+static uint32_t _mos6502cpu_op_8B(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    c->A = (c->A | 0xEE) & c->X & v;
+    _NZ(c->A);
+    return 2;
+}
+
+// STY abs
+static uint32_t _mos6502cpu_op_8C(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    _WR(addr, c->Y);
+    return 4;
+}
+
+// STA abs
+static uint32_t _mos6502cpu_op_8D(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    _WR(addr, c->A);
+    return 4;
+}
+
+// STX abs
+static uint32_t _mos6502cpu_op_8E(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    _WR(addr, c->X);
+    return 4;
+}
+
+// SAX abs (undoc)
+static uint32_t _mos6502cpu_op_8F(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    _WR(addr, c->A & c->X);
+    return 4;
+}
+
+// BCC
+static uint32_t _mos6502cpu_op_90(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    return _mos6502cpu_branch(c, bus, (uint8_t)operand, !c->cf);
+}
+
+// STA (zp),Y
+static uint32_t _mos6502cpu_op_91(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izy_w(c, bus, (uint8_t)operand);
+    _WR(addr, c->A);
+    return 6;
+}
+
+// SHA (zp),Y (undoc)
+static uint32_t _mos6502cpu_op_93(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izy_w(c, bus, (uint8_t)operand);
+    _WR(addr, c->A & c->X & (uint8_t)((addr >> 8) + 1));
+    return 6;
+}
+
+// STY zp,X
+static uint32_t _mos6502cpu_op_94(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X);
+    _WR(addr, c->Y);
+    return 4;
+}
+
+// STA zp,X
+static uint32_t _mos6502cpu_op_95(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X);
+    _WR(addr, c->A);
+    return 4;
+}
+
+// STX zp,Y
+static uint32_t _mos6502cpu_op_96(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->Y);
+    _WR(addr, c->X);
+    return 4;
+}
+
+// SAX zp,Y (undoc)
+static uint32_t _mos6502cpu_op_97(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->Y);
+    _WR(addr, c->A & c->X);
+    return 4;
+}
+
+// TYA
+static uint32_t _mos6502cpu_op_98(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->A = c->Y;
+    _NZ(c->A);
+    return 2;
+}
+
+// STA abs,Y
+static uint32_t _mos6502cpu_op_99(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->Y);
+    _WR(addr, c->A);
+    return 5;
+}
+
+// TXS
+static uint32_t _mos6502cpu_op_9A(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->S = c->X;
+    return 2;
+}
+
+// SHS abs,Y (undoc)
+static uint32_t _mos6502cpu_op_9B(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->Y);
+    c->S = c->A & c->X;
+    _WR(addr, c->S & (uint8_t)((addr >> 8) + 1));
+    return 5;
+}
+
+// SHY abs,X (undoc)
+static uint32_t _mos6502cpu_op_9C(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->X);
+    _WR(addr, c->Y & (uint8_t)((addr >> 8) + 1));
+    return 5;
+}
+
+// STA abs,X
+static uint32_t _mos6502cpu_op_9D(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->X);
+    _WR(addr, c->A);
+    return 5;
+}
+
+// SHX abs,Y (undoc)
+static uint32_t _mos6502cpu_op_9E(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->Y);
+    _WR(addr, c->X & (uint8_t)((addr >> 8) + 1));
+    return 5;
+}
+
+// SHA abs,Y (undoc)
+static uint32_t _mos6502cpu_op_9F(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->Y);
+    _WR(addr, c->A & c->X & (uint8_t)((addr >> 8) + 1));
+    return 5;
+}
+
+// LDY #
+static uint32_t _mos6502cpu_op_A0(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    c->Y = v;
+    _NZ(c->Y);
+    return 2;
+}
+
+// LDA (zp,X)
+static uint32_t _mos6502cpu_op_A1(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_izx(c, bus, (uint8_t)operand));
+    c->A = v;
+    _NZ(c->A);
+    return 6;
+}
+
+// LDX #
+static uint32_t _mos6502cpu_op_A2(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    c->X = v;
+    _NZ(c->X);
+    return 2;
+}
+
+// LAX (zp,X) (undoc)
+static uint32_t _mos6502cpu_op_A3(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_izx(c, bus, (uint8_t)operand));
+    c->A = c->X = v;
+    _NZ(c->A);
+    return 6;
+}
+
+// LDY zp
+static uint32_t _mos6502cpu_op_A4(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD((uint8_t)operand);
+    c->Y = v;
+    _NZ(c->Y);
+    return 3;
+}
+
+// LDA zp
+static uint32_t _mos6502cpu_op_A5(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD((uint8_t)operand);
+    c->A = v;
+    _NZ(c->A);
+    return 3;
+}
+
+// LDX zp
+static uint32_t _mos6502cpu_op_A6(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD((uint8_t)operand);
+    c->X = v;
+    _NZ(c->X);
+    return 3;
+}
+
+// LAX zp (undoc)
+static uint32_t _mos6502cpu_op_A7(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD((uint8_t)operand);
+    c->A = c->X = v;
+    _NZ(c->A);
+    return 3;
+}
+
+// TAY
+static uint32_t _mos6502cpu_op_A8(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->Y = c->A;
+    _NZ(c->Y);
+    return 2;
+}
+
+// LDA #
+static uint32_t _mos6502cpu_op_A9(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    c->A = v;
+    _NZ(c->A);
+    return 2;
+}
+
+// TAX
+static uint32_t _mos6502cpu_op_AA(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->X = c->A;
+    _NZ(c->X);
+    return 2;
+}
+
+// LXA # (undoc)
+static uint32_t _mos6502cpu_op_AB(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    c->A = c->X = (c->A | 0xEE) & v;
+    _NZ(c->A);
+    return 2;
+}
+
+// LDY abs
+static uint32_t _mos6502cpu_op_AC(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(operand);
+    c->Y = v;
+    _NZ(c->Y);
+    return 4;
+}
+
+// LDA abs
+static uint32_t _mos6502cpu_op_AD(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(operand);
+    c->A = v;
+    _NZ(c->A);
+    return 4;
+}
+
+// LDX abs
+static uint32_t _mos6502cpu_op_AE(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(operand);
+    c->X = v;
+    _NZ(c->X);
+    return 4;
+}
+
+// LAX abs (undoc)
+static uint32_t _mos6502cpu_op_AF(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(operand);
+    c->A = c->X = v;
+    _NZ(c->A);
+    return 4;
+}
+
+// BCS
+static uint32_t _mos6502cpu_op_B0(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    return _mos6502cpu_branch(c, bus, (uint8_t)operand, c->cf);
+}
+
+// LDA (zp),Y
+static uint32_t _mos6502cpu_op_B1(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 5;
+    uint8_t v = _RD(_mos6502cpu_ea_izy(c, bus, (uint8_t)operand, &cycles));
+    c->A = v;
+    _NZ(c->A);
+    return cycles;
+}
+
+// LAX (zp),Y (undoc)
+static uint32_t _mos6502cpu_op_B3(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 5;
+    uint8_t v = _RD(_mos6502cpu_ea_izy(c, bus, (uint8_t)operand, &cycles));
+    c->A = c->X = v;
+    _NZ(c->A);
+    return cycles;
+}
+
+// LDY zp,X
+static uint32_t _mos6502cpu_op_B4(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X));
+    c->Y = v;
+    _NZ(c->Y);
+    return 4;
+}
+
+// LDA zp,X
+static uint32_t _mos6502cpu_op_B5(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X));
+    c->A = v;
+    _NZ(c->A);
+    return 4;
+}
+
+// LDX zp,Y
+static uint32_t _mos6502cpu_op_B6(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->Y));
+    c->X = v;
+    _NZ(c->X);
+    return 4;
+}
+
+// LAX zp,Y (undoc)
+static uint32_t _mos6502cpu_op_B7(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->Y));
+    c->A = c->X = v;
+    _NZ(c->A);
+    return 4;
+}
+
+// CLV
+static uint32_t _mos6502cpu_op_B8(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->vf = false;
+    return 2;
+}
+
+// LDA abs,Y
+static uint32_t _mos6502cpu_op_B9(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->Y, &cycles));
+    c->A = v;
+    _NZ(c->A);
+    return cycles;
+}
+
+// TSX
+static uint32_t _mos6502cpu_op_BA(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->X = c->S;
+    _NZ(c->X);
+    return 2;
+}
+
+// LAS abs,Y (undoc)
+static uint32_t _mos6502cpu_op_BB(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->Y, &cycles));
+    c->A = c->X = c->S = v & c->S;
+    _NZ(c->A);
+    return cycles;
+}
+
+// LDY abs,X
+static uint32_t _mos6502cpu_op_BC(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->X, &cycles));
+    c->Y = v;
+    _NZ(c->Y);
+    return cycles;
+}
+
+// LDA abs,X
+static uint32_t _mos6502cpu_op_BD(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->X, &cycles));
+    c->A = v;
+    _NZ(c->A);
+    return cycles;
+}
+
+// LDX abs,Y
+static uint32_t _mos6502cpu_op_BE(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->Y, &cycles));
+    c->X = v;
+    _NZ(c->X);
+    return cycles;
+}
+
+// LAX abs,Y (undoc)
+static uint32_t _mos6502cpu_op_BF(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->Y, &cycles));
+    c->A = c->X = v;
+    _NZ(c->A);
+    return cycles;
+}
+
+// CPY #
+static uint32_t _mos6502cpu_op_C0(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    _mos6502cpu_cmp(c, c->Y, v);
+    return 2;
+}
+
+// CMP (zp,X)
+static uint32_t _mos6502cpu_op_C1(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_izx(c, bus, (uint8_t)operand));
+    _mos6502cpu_cmp(c, c->A, v);
+    return 6;
+}
+
+// NOP # (undoc)
+static uint32_t _mos6502cpu_op_C2(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    return 2;
+}
+
+// DCP (zp,X) (undoc)
+static uint32_t _mos6502cpu_op_C3(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izx(c, bus, (uint8_t)operand);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v--;
+    _NZ(v);
+    _mos6502cpu_cmp(c, c->A, v);
+    _WR(addr, v);
+    return 8;
+}
+
+// CPY zp
+static uint32_t _mos6502cpu_op_C4(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD((uint8_t)operand);
+    _mos6502cpu_cmp(c, c->Y, v);
+    return 3;
+}
+
+// CMP zp
+static uint32_t _mos6502cpu_op_C5(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD((uint8_t)operand);
+    _mos6502cpu_cmp(c, c->A, v);
+    return 3;
+}
+
+// DEC zp
+static uint32_t _mos6502cpu_op_C6(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v--;
+    _NZ(v);
+    _WR(addr, v);
+    return 5;
+}
+
+// DCP zp (undoc)
+static uint32_t _mos6502cpu_op_C7(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v--;
+    _NZ(v);
+    _mos6502cpu_cmp(c, c->A, v);
+    _WR(addr, v);
+    return 5;
+}
+
+// INY
+static uint32_t _mos6502cpu_op_C8(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->Y++;
+    _NZ(c->Y);
+    return 2;
+}
+
+// CMP #
+static uint32_t _mos6502cpu_op_C9(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    _mos6502cpu_cmp(c, c->A, v);
+    return 2;
+}
+
+// DEX
+static uint32_t _mos6502cpu_op_CA(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->X--;
+    _NZ(c->X);
+    return 2;
+}
+
+// SBX # (undoc)
+static uint32_t _mos6502cpu_op_CB(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    _mos6502cpu_sbx(c, v);
+    return 2;
+}
+
+// CPY abs
+static uint32_t _mos6502cpu_op_CC(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(operand);
+    _mos6502cpu_cmp(c, c->Y, v);
+    return 4;
+}
+
+// CMP abs
+static uint32_t _mos6502cpu_op_CD(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(operand);
+    _mos6502cpu_cmp(c, c->A, v);
+    return 4;
+}
+
+// DEC abs
+static uint32_t _mos6502cpu_op_CE(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v--;
+    _NZ(v);
+    _WR(addr, v);
+    return 6;
+}
+
+// DCP abs (undoc)
+static uint32_t _mos6502cpu_op_CF(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v--;
+    _NZ(v);
+    _mos6502cpu_cmp(c, c->A, v);
+    _WR(addr, v);
+    return 6;
+}
+
+// BNE
+static uint32_t _mos6502cpu_op_D0(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    return _mos6502cpu_branch(c, bus, (uint8_t)operand, !c->zf);
+}
+
+// CMP (zp),Y
+static uint32_t _mos6502cpu_op_D1(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 5;
+    uint8_t v = _RD(_mos6502cpu_ea_izy(c, bus, (uint8_t)operand, &cycles));
+    _mos6502cpu_cmp(c, c->A, v);
+    return cycles;
+}
+
+// DCP (zp),Y (undoc)
+static uint32_t _mos6502cpu_op_D3(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izy_w(c, bus, (uint8_t)operand);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v--;
+    _NZ(v);
+    _mos6502cpu_cmp(c, c->A, v);
+    _WR(addr, v);
+    return 8;
+}
+
+// NOP zp,X (undoc)
+static uint32_t _mos6502cpu_op_D4(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X));
+    return 4;
+}
+
+// CMP zp,X
+static uint32_t _mos6502cpu_op_D5(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X));
+    _mos6502cpu_cmp(c, c->A, v);
+    return 4;
+}
+
+// DEC zp,X
+static uint32_t _mos6502cpu_op_D6(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v--;
+    _NZ(v);
+    _WR(addr, v);
+    return 6;
+}
+
+// DCP zp,X (undoc)
+static uint32_t _mos6502cpu_op_D7(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v--;
+    _NZ(v);
+    _mos6502cpu_cmp(c, c->A, v);
+    _WR(addr, v);
+    return 6;
+}
+
+// CLD
+static uint32_t _mos6502cpu_op_D8(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->df = false;
+    return 2;
+}
+
+// CMP abs,Y
+static uint32_t _mos6502cpu_op_D9(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->Y, &cycles));
+    _mos6502cpu_cmp(c, c->A, v);
+    return cycles;
+}
+
+// NOP (undoc)
+static uint32_t _mos6502cpu_op_DA(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    return 2;
+}
+
+// DCP abs,Y (undoc)
+static uint32_t _mos6502cpu_op_DB(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->Y);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v--;
+    _NZ(v);
+    _mos6502cpu_cmp(c, c->A, v);
+    _WR(addr, v);
+    return 7;
+}
+
+// NOP abs,X (undoc)
+static uint32_t _mos6502cpu_op_DC(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    _DUMMY_RD(_mos6502cpu_ea_absi(c, bus, operand, c->X, &cycles));
+    return cycles;
+}
+
+// CMP abs,X
+static uint32_t _mos6502cpu_op_DD(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->X, &cycles));
+    _mos6502cpu_cmp(c, c->A, v);
+    return cycles;
+}
+
+// DEC abs,X
+static uint32_t _mos6502cpu_op_DE(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v--;
+    _NZ(v);
+    _WR(addr, v);
+    return 7;
+}
+
+// DCP abs,X (undoc)
+static uint32_t _mos6502cpu_op_DF(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v--;
+    _NZ(v);
+    _mos6502cpu_cmp(c, c->A, v);
+    _WR(addr, v);
+    return 7;
+}
+
+// CPX #
+static uint32_t _mos6502cpu_op_E0(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    _mos6502cpu_cmp(c, c->X, v);
+    return 2;
+}
+
+// SBC (zp,X)
+static uint32_t _mos6502cpu_op_E1(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_izx(c, bus, (uint8_t)operand));
+    _mos6502cpu_sbc(c, v);
+    return 6;
+}
+
+// NOP # (undoc)
+static uint32_t _mos6502cpu_op_E2(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    return 2;
+}
+
+// ISB (zp,X) (undoc)
+static uint32_t _mos6502cpu_op_E3(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izx(c, bus, (uint8_t)operand);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v++;
+    _mos6502cpu_sbc(c, v);
+    _WR(addr, v);
+    return 8;
+}
+
+// CPX zp
+static uint32_t _mos6502cpu_op_E4(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD((uint8_t)operand);
+    _mos6502cpu_cmp(c, c->X, v);
+    return 3;
+}
+
+// SBC zp
+static uint32_t _mos6502cpu_op_E5(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD((uint8_t)operand);
+    _mos6502cpu_sbc(c, v);
+    return 3;
+}
+
+// INC zp
+static uint32_t _mos6502cpu_op_E6(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v++;
+    _NZ(v);
+    _WR(addr, v);
+    return 5;
+}
+
+// ISB zp (undoc)
+static uint32_t _mos6502cpu_op_E7(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = (uint8_t)operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v++;
+    _mos6502cpu_sbc(c, v);
+    _WR(addr, v);
+    return 5;
+}
+
+// INX
+static uint32_t _mos6502cpu_op_E8(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->X++;
+    _NZ(c->X);
+    return 2;
+}
+
+// SBC #
+static uint32_t _mos6502cpu_op_E9(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    _mos6502cpu_sbc(c, v);
+    return 2;
+}
+
+// NOP
+static uint32_t _mos6502cpu_op_EA(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    return 2;
+}
+
+// SBC # (undoc)
+static uint32_t _mos6502cpu_op_EB(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = (uint8_t)operand;
+    _mos6502cpu_sbc(c, v);
+    return 2;
+}
+
+// CPX abs
+static uint32_t _mos6502cpu_op_EC(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(operand);
+    _mos6502cpu_cmp(c, c->X, v);
+    return 4;
+}
+
+// SBC abs
+static uint32_t _mos6502cpu_op_ED(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(operand);
+    _mos6502cpu_sbc(c, v);
+    return 4;
+}
+
+// INC abs
+static uint32_t _mos6502cpu_op_EE(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v++;
+    _NZ(v);
+    _WR(addr, v);
+    return 6;
+}
+
+// ISB abs (undoc)
+static uint32_t _mos6502cpu_op_EF(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = operand;
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v++;
+    _mos6502cpu_sbc(c, v);
+    _WR(addr, v);
+    return 6;
+}
+
+// BEQ
+static uint32_t _mos6502cpu_op_F0(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    return _mos6502cpu_branch(c, bus, (uint8_t)operand, c->zf);
+}
+
+// SBC (zp),Y
+static uint32_t _mos6502cpu_op_F1(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 5;
+    uint8_t v = _RD(_mos6502cpu_ea_izy(c, bus, (uint8_t)operand, &cycles));
+    _mos6502cpu_sbc(c, v);
+    return cycles;
+}
+
+// ISB (zp),Y (undoc)
+static uint32_t _mos6502cpu_op_F3(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_izy_w(c, bus, (uint8_t)operand);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v++;
+    _mos6502cpu_sbc(c, v);
+    _WR(addr, v);
+    return 8;
+}
+
+// NOP zp,X (undoc)
+static uint32_t _mos6502cpu_op_F4(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X));
+    return 4;
+}
+
+// SBC zp,X
+static uint32_t _mos6502cpu_op_F5(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint8_t v = _RD(_mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X));
+    _mos6502cpu_sbc(c, v);
+    return 4;
+}
+
+// INC zp,X
+static uint32_t _mos6502cpu_op_F6(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v++;
+    _NZ(v);
+    _WR(addr, v);
+    return 6;
+}
+
+// ISB zp,X (undoc)
+static uint32_t _mos6502cpu_op_F7(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_zpi(c, bus, (uint8_t)operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v++;
+    _mos6502cpu_sbc(c, v);
+    _WR(addr, v);
+    return 6;
+}
+
+// SED
+static uint32_t _mos6502cpu_op_F8(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    c->df = true;
+    return 2;
+}
+
+// SBC abs,Y
+static uint32_t _mos6502cpu_op_F9(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->Y, &cycles));
+    _mos6502cpu_sbc(c, v);
+    return cycles;
+}
+
+// NOP (undoc)
+static uint32_t _mos6502cpu_op_FA(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    _DUMMY_RD(c->PC);
+    return 2;
+}
+
+// ISB abs,Y (undoc)
+static uint32_t _mos6502cpu_op_FB(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->Y);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v++;
+    _mos6502cpu_sbc(c, v);
+    _WR(addr, v);
+    return 7;
+}
+
+// NOP abs,X (undoc)
+static uint32_t _mos6502cpu_op_FC(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    _DUMMY_RD(_mos6502cpu_ea_absi(c, bus, operand, c->X, &cycles));
+    return cycles;
+}
+
+// SBC abs,X
+static uint32_t _mos6502cpu_op_FD(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint32_t cycles = 4;
+    uint8_t v = _RD(_mos6502cpu_ea_absi(c, bus, operand, c->X, &cycles));
+    _mos6502cpu_sbc(c, v);
+    return cycles;
+}
+
+// INC abs,X
+static uint32_t _mos6502cpu_op_FE(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v++;
+    _NZ(v);
+    _WR(addr, v);
+    return 7;
+}
+
+// ISB abs,X (undoc)
+static uint32_t _mos6502cpu_op_FF(mos6502cpu_t* c, mos6502cpu_bus_t* bus, uint16_t operand) {
+    uint16_t addr = _mos6502cpu_ea_absi_w(c, bus, operand, c->X);
+    uint8_t v = _RD(addr);
+    _DUMMY_WR(addr, v);
+    v++;
+    _mos6502cpu_sbc(c, v);
+    _WR(addr, v);
+    return 7;
+}
+
+// clang-format off
+static const mos6502cpu_op_t _mos6502cpu_ops[256] = {
+    _mos6502cpu_op_00, _mos6502cpu_op_01, NULL, _mos6502cpu_op_03,
+    _mos6502cpu_op_04, _mos6502cpu_op_05, _mos6502cpu_op_06, _mos6502cpu_op_07,
+    _mos6502cpu_op_08, _mos6502cpu_op_09, _mos6502cpu_op_0A, _mos6502cpu_op_0B,
+    _mos6502cpu_op_0C, _mos6502cpu_op_0D, _mos6502cpu_op_0E, _mos6502cpu_op_0F,
+    _mos6502cpu_op_10, _mos6502cpu_op_11, NULL, _mos6502cpu_op_13,
+    _mos6502cpu_op_14, _mos6502cpu_op_15, _mos6502cpu_op_16, _mos6502cpu_op_17,
+    _mos6502cpu_op_18, _mos6502cpu_op_19, _mos6502cpu_op_1A, _mos6502cpu_op_1B,
+    _mos6502cpu_op_1C, _mos6502cpu_op_1D, _mos6502cpu_op_1E, _mos6502cpu_op_1F,
+    _mos6502cpu_op_20, _mos6502cpu_op_21, NULL, _mos6502cpu_op_23,
+    _mos6502cpu_op_24, _mos6502cpu_op_25, _mos6502cpu_op_26, _mos6502cpu_op_27,
+    _mos6502cpu_op_28, _mos6502cpu_op_29, _mos6502cpu_op_2A, _mos6502cpu_op_2B,
+    _mos6502cpu_op_2C, _mos6502cpu_op_2D, _mos6502cpu_op_2E, _mos6502cpu_op_2F,
+    _mos6502cpu_op_30, _mos6502cpu_op_31, NULL, _mos6502cpu_op_33,
+    _mos6502cpu_op_34, _mos6502cpu_op_35, _mos6502cpu_op_36, _mos6502cpu_op_37,
+    _mos6502cpu_op_38, _mos6502cpu_op_39, _mos6502cpu_op_3A, _mos6502cpu_op_3B,
+    _mos6502cpu_op_3C, _mos6502cpu_op_3D, _mos6502cpu_op_3E, _mos6502cpu_op_3F,
+    _mos6502cpu_op_40, _mos6502cpu_op_41, NULL, _mos6502cpu_op_43,
+    _mos6502cpu_op_44, _mos6502cpu_op_45, _mos6502cpu_op_46, _mos6502cpu_op_47,
+    _mos6502cpu_op_48, _mos6502cpu_op_49, _mos6502cpu_op_4A, _mos6502cpu_op_4B,
+    _mos6502cpu_op_4C, _mos6502cpu_op_4D, _mos6502cpu_op_4E, _mos6502cpu_op_4F,
+    _mos6502cpu_op_50, _mos6502cpu_op_51, NULL, _mos6502cpu_op_53,
+    _mos6502cpu_op_54, _mos6502cpu_op_55, _mos6502cpu_op_56, _mos6502cpu_op_57,
+    _mos6502cpu_op_58, _mos6502cpu_op_59, _mos6502cpu_op_5A, _mos6502cpu_op_5B,
+    _mos6502cpu_op_5C, _mos6502cpu_op_5D, _mos6502cpu_op_5E, _mos6502cpu_op_5F,
+    _mos6502cpu_op_60, _mos6502cpu_op_61, NULL, _mos6502cpu_op_63,
+    _mos6502cpu_op_64, _mos6502cpu_op_65, _mos6502cpu_op_66, _mos6502cpu_op_67,
+    _mos6502cpu_op_68, _mos6502cpu_op_69, _mos6502cpu_op_6A, _mos6502cpu_op_6B,
+    _mos6502cpu_op_6C, _mos6502cpu_op_6D, _mos6502cpu_op_6E, _mos6502cpu_op_6F,
+    _mos6502cpu_op_70, _mos6502cpu_op_71, NULL, _mos6502cpu_op_73,
+    _mos6502cpu_op_74, _mos6502cpu_op_75, _mos6502cpu_op_76, _mos6502cpu_op_77,
+    _mos6502cpu_op_78, _mos6502cpu_op_79, _mos6502cpu_op_7A, _mos6502cpu_op_7B,
+    _mos6502cpu_op_7C, _mos6502cpu_op_7D, _mos6502cpu_op_7E, _mos6502cpu_op_7F,
+    _mos6502cpu_op_80, _mos6502cpu_op_81, _mos6502cpu_op_82, _mos6502cpu_op_83,
+    _mos6502cpu_op_84, _mos6502cpu_op_85, _mos6502cpu_op_86, _mos6502cpu_op_87,
+    _mos6502cpu_op_88, _mos6502cpu_op_89, _mos6502cpu_op_8A, _mos6502cpu_op_8B,
+    _mos6502cpu_op_8C, _mos6502cpu_op_8D, _mos6502cpu_op_8E, _mos6502cpu_op_8F,
+    _mos6502cpu_op_90, _mos6502cpu_op_91, NULL, _mos6502cpu_op_93,
+    _mos6502cpu_op_94, _mos6502cpu_op_95, _mos6502cpu_op_96, _mos6502cpu_op_97,
+    _mos6502cpu_op_98, _mos6502cpu_op_99, _mos6502cpu_op_9A, _mos6502cpu_op_9B,
+    _mos6502cpu_op_9C, _mos6502cpu_op_9D, _mos6502cpu_op_9E, _mos6502cpu_op_9F,
+    _mos6502cpu_op_A0, _mos6502cpu_op_A1, _mos6502cpu_op_A2, _mos6502cpu_op_A3,
+    _mos6502cpu_op_A4, _mos6502cpu_op_A5, _mos6502cpu_op_A6, _mos6502cpu_op_A7,
+    _mos6502cpu_op_A8, _mos6502cpu_op_A9, _mos6502cpu_op_AA, _mos6502cpu_op_AB,
+    _mos6502cpu_op_AC, _mos6502cpu_op_AD, _mos6502cpu_op_AE, _mos6502cpu_op_AF,
+    _mos6502cpu_op_B0, _mos6502cpu_op_B1, NULL, _mos6502cpu_op_B3,
+    _mos6502cpu_op_B4, _mos6502cpu_op_B5, _mos6502cpu_op_B6, _mos6502cpu_op_B7,
+    _mos6502cpu_op_B8, _mos6502cpu_op_B9, _mos6502cpu_op_BA, _mos6502cpu_op_BB,
+    _mos6502cpu_op_BC, _mos6502cpu_op_BD, _mos6502cpu_op_BE, _mos6502cpu_op_BF,
+    _mos6502cpu_op_C0, _mos6502cpu_op_C1, _mos6502cpu_op_C2, _mos6502cpu_op_C3,
+    _mos6502cpu_op_C4, _mos6502cpu_op_C5, _mos6502cpu_op_C6, _mos6502cpu_op_C7,
+    _mos6502cpu_op_C8, _mos6502cpu_op_C9, _mos6502cpu_op_CA, _mos6502cpu_op_CB,
+    _mos6502cpu_op_CC, _mos6502cpu_op_CD, _mos6502cpu_op_CE, _mos6502cpu_op_CF,
+    _mos6502cpu_op_D0, _mos6502cpu_op_D1, NULL, _mos6502cpu_op_D3,
+    _mos6502cpu_op_D4, _mos6502cpu_op_D5, _mos6502cpu_op_D6, _mos6502cpu_op_D7,
+    _mos6502cpu_op_D8, _mos6502cpu_op_D9, _mos6502cpu_op_DA, _mos6502cpu_op_DB,
+    _mos6502cpu_op_DC, _mos6502cpu_op_DD, _mos6502cpu_op_DE, _mos6502cpu_op_DF,
+    _mos6502cpu_op_E0, _mos6502cpu_op_E1, _mos6502cpu_op_E2, _mos6502cpu_op_E3,
+    _mos6502cpu_op_E4, _mos6502cpu_op_E5, _mos6502cpu_op_E6, _mos6502cpu_op_E7,
+    _mos6502cpu_op_E8, _mos6502cpu_op_E9, _mos6502cpu_op_EA, _mos6502cpu_op_EB,
+    _mos6502cpu_op_EC, _mos6502cpu_op_ED, _mos6502cpu_op_EE, _mos6502cpu_op_EF,
+    _mos6502cpu_op_F0, _mos6502cpu_op_F1, NULL, _mos6502cpu_op_F3,
+    _mos6502cpu_op_F4, _mos6502cpu_op_F5, _mos6502cpu_op_F6, _mos6502cpu_op_F7,
+    _mos6502cpu_op_F8, _mos6502cpu_op_F9, _mos6502cpu_op_FA, _mos6502cpu_op_FB,
+    _mos6502cpu_op_FC, _mos6502cpu_op_FD, _mos6502cpu_op_FE, _mos6502cpu_op_FF,
+};
+
+static const uint8_t _mos6502cpu_op_length[256] = {
+    2, 2, 1, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,
+    2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,
+    3, 2, 1, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,
+    2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,
+    1, 2, 1, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,
+    2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,
+    1, 2, 1, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,
+    2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,
+    2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,
+    2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,
+    2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,
+    2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,
+    2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,
+    2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,
+    2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3,
+    2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3,
+};
+// clang-format on
+
+uint32_t mos6502cpu_exec(mos6502cpu_t* c, mos6502cpu_bus_t* bus) {
+    if (_mos6502cpu_exec_pending(c)) {
+        return mos6502cpu_exec_tick(c, bus);
+    }
+    const uint8_t op = c->data;
+    const mos6502cpu_op_t handler = _mos6502cpu_ops[op];
+    if (0 == handler) {
+        // JAM
+        return mos6502cpu_exec_tick(c, bus);
+    }
+    // The operand bytes follow the opcode fetch, JSR fetches its high byte itself
+    const uint32_t length = _mos6502cpu_op_length[op];
+    uint16_t operand = 0;
+    if (length > 1) {
+        operand = _RD(c->PC + 1);
+    }
+    if ((length > 2) && (op != 0x20)) {
+        operand |= _RD(c->PC + 2) << 8;
+    }
+    c->PC += length;
+    const uint32_t cycles = handler(c, bus, operand);
+    // The last cycle of every instruction fetches the next opcode
+    c->addr = c->PC;
+    c->data = _RD(c->PC);
+    c->rw = true;
+    MOS6510CPU_SET_PORT(c, c->io_pins);
+    return cycles;
+}
+
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+#ifdef MEM_PAGE_GENERATIONS
+
+// Jumps and branches end a block, and so do CLI and PLP which can unmask a pending IRQ
+static inline bool _mos6502cpu_block_ends(uint8_t opcode) {
+    switch (opcode) {
+        case 0x00:  // BRK
+        case 0x20:  // JSR
+        case 0x28:  // PLP
+        case 0x40:  // RTI
+        case 0x4C:  // JMP abs
+        case 0x58:  // CLI
+        case 0x60:  // RTS
+        case 0x6C:  // JMP (abs)
+            return true;
+        default:
+            return (opcode & 0x1F) == 0x10;
+    }
+}
+
+static inline uint32_t _mos6502cpu_block_index(const uint8_t* code) {
+    uintptr_t h = (uintptr_t)code;
+    return (uint32_t)(h ^ (h >> 7) ^ (h >> 16)) & (MOS6502CPU_BLOCK_CACHE_SIZE - 1);
+}
+
+// Decode the instructions at pc into a block, returns false if there is nothing to cache
+static bool _mos6502cpu_block_decode(mos6502cpu_bus_t* bus, mos6502cpu_block_t* block, uint16_t pc,
+                                     const uint8_t* code) {
+    block->code = 0;
+    // A JSR on the stack page can overwrite its own operand
+    if (pc < 0x0200) {
+        return false;
+    }
+    const uint32_t page_end = ((pc >> MEM_PAGE_SHIFT) + 1) << MEM_PAGE_SHIFT;
+    uint32_t addr = pc;
+    uint32_t num_instrs = 0;
+    while (num_instrs < MOS6502CPU_BLOCK_MAX_INSTRS) {
+        const uint8_t* bytes = code + (addr - pc);
+        const uint8_t opcode = bytes[0];
+        const uint32_t length = _mos6502cpu_op_length[opcode];
+        // Stop at JAM, at the end of the page and at instructions that fetch from I/O
+        if ((0 == _mos6502cpu_ops[opcode]) || ((addr + length) > page_end) ||
+            _mos6502cpu_bus_is_io(bus->io_rd_pages, addr) ||
+            _mos6502cpu_bus_is_io(bus->io_rd_pages, addr + length - 1)) {
+            break;
+        }
+        mos6502cpu_instr_t* instr = &block->instrs[num_instrs++];
+        instr->op = _mos6502cpu_ops[opcode];
+        instr->opcode = opcode;
+        instr->operand = (length > 1) ? bytes[1] : 0;
+        if (length > 2) {
+            instr->operand |= bytes[2] << 8;
+        }
+        instr->length = length;
+        addr += length;
+        if (_mos6502cpu_block_ends(opcode)) {
+            break;
+        }
+    }
+    if (0 == num_instrs) {
+        return false;
+    }
+    block->code = code;
+    block->gen = bus->mem->page_gen[pc >> MEM_PAGE_SHIFT];
+    block->pc = pc;
+    block->num_instrs = num_instrs;
+    return true;
+}
+
+// Find or decode the block at PC, returns 0 if the next instruction must go through mos6502cpu_exec()
+static mos6502cpu_block_t* _mos6502cpu_block_lookup(mos6502cpu_t* c, mos6502cpu_bus_t* bus,
+                                                    mos6502cpu_block_cache_t* cache) {
+    if (_mos6502cpu_exec_pending(c)) {
+        return 0;
+    }
+    const uint16_t pc = c->PC;
+    const uint32_t page_index = pc >> MEM_PAGE_SHIFT;
+    const uint8_t* code = &bus->mem->page_table[page_index].read_ptr[pc & MEM_PAGE_MASK];
+    mos6502cpu_block_t* block = &cache->blocks[_mos6502cpu_block_index(code)];
+    if ((block->code == code) && (block->pc == pc) && (block->gen == bus->mem->page_gen[page_index])) {
+        return block;
+    }
+    return _mos6502cpu_block_decode(bus, block, pc, code) ? block : 0;
+}
+
+// Run a block until its end, num_cycles have passed, an instruction accessed
+// I/O or wrote to the block's page, returns the updated cycle count
+static uint32_t _mos6502cpu_block_run(mos6502cpu_t* c, mos6502cpu_bus_t* bus, const mos6502cpu_block_t* block,
+                                      uint32_t cycles, uint32_t num_cycles) {
+    const uint32_t* gen = &bus->mem->page_gen[block->pc >> MEM_PAGE_SHIFT];
+    const uint32_t io_accesses = bus->io_accesses;
+    const mos6502cpu_instr_t* instr = block->instrs;
+    const mos6502cpu_instr_t* end = instr + block->num_instrs;
+    do {
+        // I/O callbacks may look at the data bus, which holds the opcode after its fetch
+        c->data = instr->opcode;
+        c->PC += instr->length;
+        bus->cycles = cycles;
+        cycles += instr->op(c, bus, instr->operand);
+        instr++;
+    } while ((instr < end) && (cycles < num_cycles) && (bus->io_accesses == io_accesses) && (*gen == block->gen));
+    // The opcode fetches inside the block were from the cached page, only the last one can hit I/O
+    c->addr = c->PC;
+    c->data = _RD(c->PC);
+    c->rw = true;
+    MOS6510CPU_SET_PORT(c, c->io_pins);
+    return cycles;
+}
+
+void mos6502cpu_block_cache_init(mos6502cpu_block_cache_t* cache) {
+    CHIPS_ASSERT(cache);
+    memset(cache, 0, sizeof(mos6502cpu_block_cache_t));
+}
+
+uint32_t mos6502cpu_exec_cached(mos6502cpu_t* c, mos6502cpu_bus_t* bus, mos6502cpu_block_cache_t* cache,
+                                uint32_t num_cycles) {
+    CHIPS_ASSERT(c && bus && cache);
+    const uint32_t io_accesses = bus->io_accesses;
+    uint32_t cycles = 0;
+    do {
+        mos6502cpu_block_t* block = _mos6502cpu_block_lookup(c, bus, cache);
+        if (block) {
+            cycles = _mos6502cpu_block_run(c, bus, block, cycles, num_cycles);
+        } else {
+            bus->cycles = cycles;
+            cycles += mos6502cpu_exec(c, bus);
+        }
+    } while ((cycles < num_cycles) && (bus->io_accesses == io_accesses));
+    return cycles;
+}
+#endif  // MEM_PAGE_GENERATIONS
+
+#undef _RD
+#undef _WR
+#undef _DUMMY_RD
+#undef _DUMMY_WR
+#undef _NZ
+#endif  // CHIPS_IMPL
@@ -76,6 +76,9 @@ void disk2_fdc_reset(disk2_fdc_t* sys);
 // Tick the floppy disk controller
 void disk2_fdc_tick(disk2_fdc_t* sys);
 
+// Tick the floppy disk controller num_ticks times in one step
+void disk2_fdc_advance(disk2_fdc_t* sys, uint32_t num_ticks);
+
 uint8_t disk2_fdc_read_byte(disk2_fdc_t* sys, uint8_t addr);
 
 void disk2_fdc_write_byte(disk2_fdc_t* sys, uint8_t addr, uint8_t byte);
@@ -127,6 +130,12 @@ void disk2_fdc_tick(disk2_fdc_t* sys) {
     // disk2_fdd_tick(&sys->fdd[1]);
 }
 
+void disk2_fdc_advance(disk2_fdc_t* sys, uint32_t num_ticks) {
+    CHIPS_ASSERT(sys && sys->valid);
+    disk2_fdd_advance(&sys->fdd[0], num_ticks);
+    // disk2_fdd_advance(&sys->fdd[1], num_ticks);
+}
+
 uint8_t disk2_fdc_read_byte(disk2_fdc_t* sys, uint8_t addr) {
     _disk2_fdc_process_soft_switches(sys, addr);
     if (addr & 1) {
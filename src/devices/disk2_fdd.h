@@ -50,6 +50,9 @@ void disk2_fdd_reset(disk2_fdd_t* sys);
 
 void disk2_fdd_tick(disk2_fdd_t* sys);
 
+// Tick the floppy disk drive num_ticks times in one step
+void disk2_fdd_advance(disk2_fdd_t* sys, uint32_t num_ticks);
+
 // Insert a new disk file
 bool disk2_fdd_insert_disk(disk2_fdd_t* sys, uint8_t* nib_image);
 
@@ -114,6 +117,18 @@ void disk2_fdd_tick(disk2_fdd_t* sys) {
     }
 }
 
+void disk2_fdd_advance(disk2_fdd_t* sys, uint32_t num_ticks) {
+    CHIPS_ASSERT(sys && sys->valid);
+    if (sys->motor_timer_ticks > 0) {
+        if (sys->motor_timer_ticks > num_ticks) {
+            sys->motor_timer_ticks -= num_ticks;
+        } else {
+            sys->motor_timer_ticks = 0;
+            sys->motor_state = 0;
+        }
+    }
+}
+
 bool disk2_fdd_insert_disk(disk2_fdd_t* sys, uint8_t* nib_image) {
     CHIPS_ASSERT(sys && sys->valid);
     sys->nib_image_offset = 0;
@@ -50,7 +50,8 @@ void prodos_hdc_reset(prodos_hdc_t* sys);
 
 uint8_t prodos_hdc_read_byte(prodos_hdc_t* sys, uint8_t addr);
 
-void prodos_hdc_write_byte(prodos_hdc_t* sys, uint8_t addr, uint8_t byte, mem_t* mem);
+// Returns true if a READ command copied a block into memory at PRODOS_DRV_BUFFER
+bool prodos_hdc_write_byte(prodos_hdc_t* sys, uint8_t addr, uint8_t byte, mem_t* mem);
 
 // Prepare a new hard disk controller snapshot for saving
 void prodos_hdc_snapshot_onsave(prodos_hdc_t* snapshot);
@@ -95,16 +96,16 @@ uint8_t prodos_hdc_read_byte(prodos_hdc_t* sys, uint8_t addr) {
     return sys->return_code[addr];
 }
 
-void prodos_hdc_write_byte(prodos_hdc_t* sys, uint8_t addr, uint8_t byte, mem_t* mem) {
+bool prodos_hdc_write_byte(prodos_hdc_t* sys, uint8_t addr, uint8_t byte, mem_t* mem) {
     if (addr != PRODOS_HDC_PARA || byte != PRODOS_HDC_MAGIC) {
-        return;
+        return false;
     }
 
     prodos_hdd_t* hdd = &sys->hdd[0];
 
     if (mem_rd(mem, PRODOS_DRV_UNIT) != 0x70 || !prodos_hdd_is_disk_inserted(hdd)) {
         sys->return_code[PRODOS_HDC_RC_A] = PRODOS_HDD_ERR_NODEV;
-        return;
+        return false;
     }
 
     uint32_t blocks = prodos_hdd_get_blocks(hdd);
@@ -117,17 +118,17 @@ void prodos_hdc_write_byte(prodos_hdc_t* sys, uint8_t addr, uint8_t byte, mem_t*
             sys->return_code[PRODOS_HDC_RC_A] = PRODOS_HDD_ERR_OK;
             sys->return_code[PRODOS_HDC_RC_X] = blocks >> 0 & 0xFF;
             sys->return_code[PRODOS_HDC_RC_Y] = blocks >> 8 & 0xFF;
-            return;
+            return false;
         case PRODOS_CMD_READ:
             sys->return_code[PRODOS_HDC_RC_A] = prodos_hdd_read_block(hdd, buffer, block, mem);
-            return;
+            return sys->return_code[PRODOS_HDC_RC_A] == PRODOS_HDD_ERR_OK;
         case PRODOS_CMD_WRITE:
             sys->return_code[PRODOS_HDC_RC_A] = prodos_hdd_write_block(hdd, buffer, block, mem);
-            return;
+            return false;
     }
 
     sys->return_code[PRODOS_HDC_RC_A] = PRODOS_HDD_ERR_IO;
-    return;
+    return false;
 }
 
 void prodos_hdc_snapshot_onsave(prodos_hdc_t* snapshot) { CHIPS_ASSERT(snapshot); }
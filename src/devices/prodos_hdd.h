@@ -145,8 +145,8 @@ uint8_t prodos_hdd_read_block(prodos_hdd_t* sys, uint16_t buffer, uint32_t block
     }
 
     if (sys->image_type == PRODOS_HDD_IMAGE_TYPE_MSC) {
-        // USB flash drive
-        uint8_t* buf = mem_writeptr(mem, buffer);
+        // USB flash drive, the buffer may cross pages that map to different banks
+        uint8_t buf[PRODOS_HDD_BYTES_PER_BLOCK];
         if (fseek(sys->file, block * PRODOS_HDD_BYTES_PER_BLOCK, SEEK_SET) != 0) {
             printf("Error reading from file\r\n");
             return PRODOS_HDD_ERR_IO;
@@ -155,9 +155,10 @@ uint8_t prodos_hdd_read_block(prodos_hdd_t* sys, uint16_t buffer, uint32_t block
             printf("Error reading from file\r\n");
             return PRODOS_HDD_ERR_IO;
         }
+        mem_copy_in(mem, buffer, buf, PRODOS_HDD_BYTES_PER_BLOCK);
     } else {
         // Internal flash
-        mem_write_range(mem, buffer, sys->po_image + block * PRODOS_HDD_BYTES_PER_BLOCK, PRODOS_HDD_BYTES_PER_BLOCK);
+        mem_copy_in(mem, buffer, sys->po_image + block * PRODOS_HDD_BYTES_PER_BLOCK, PRODOS_HDD_BYTES_PER_BLOCK);
     }
 
     return PRODOS_HDD_ERR_OK;
@@ -175,11 +176,13 @@ uint8_t prodos_hdd_write_block(prodos_hdd_t* sys, uint16_t buffer, uint32_t bloc
 
     if (sys->image_type == PRODOS_HDD_IMAGE_TYPE_MSC) {
         // USB flash drive
+        uint8_t buf[PRODOS_HDD_BYTES_PER_BLOCK];
+        mem_copy_out(mem, buffer, buf, PRODOS_HDD_BYTES_PER_BLOCK);
         if (fseek(sys->file, block * PRODOS_HDD_BYTES_PER_BLOCK, SEEK_SET) != 0) {
             printf("Error writing to file\r\n");
             return PRODOS_HDD_ERR_IO;
         }
-        if (fwrite(mem_readptr(mem, buffer), 1, PRODOS_HDD_BYTES_PER_BLOCK, sys->file) != PRODOS_HDD_BYTES_PER_BLOCK) {
+        if (fwrite(buf, 1, PRODOS_HDD_BYTES_PER_BLOCK, sys->file) != PRODOS_HDD_BYTES_PER_BLOCK) {
             printf("Error writing to file\r\n");
             return PRODOS_HDD_ERR_IO;
         }
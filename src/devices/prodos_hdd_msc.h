@@ -141,8 +141,8 @@ uint8_t prodos_hdd_read_block(prodos_hdd_t* sys, uint16_t buffer, uint32_t block
     }
 
     if (sys->image_type == PRODOS_HDD_IMAGE_TYPE_MSC) {
-        // USB flash drive
-        uint8_t* buf = mem_writeptr(mem, buffer);
+        // USB flash drive, the buffer may cross pages that map to different banks
+        uint8_t buf[PRODOS_HDD_BYTES_PER_BLOCK];
         FRESULT res;
         res = f_lseek(&sys->fil, block * PRODOS_HDD_BYTES_PER_BLOCK);
         if (res != FR_OK) {
@@ -155,9 +155,10 @@ uint8_t prodos_hdd_read_block(prodos_hdd_t* sys, uint16_t buffer, uint32_t block
             printf("Error %u reading from file\r\n", res);
             return PRODOS_HDD_ERR_IO;
         }
+        mem_copy_in(mem, buffer, buf, PRODOS_HDD_BYTES_PER_BLOCK);
     } else {
         // Internal flash
-        mem_write_range(mem, buffer, sys->po_image + block * PRODOS_HDD_BYTES_PER_BLOCK, PRODOS_HDD_BYTES_PER_BLOCK);
+        mem_copy_in(mem, buffer, sys->po_image + block * PRODOS_HDD_BYTES_PER_BLOCK, PRODOS_HDD_BYTES_PER_BLOCK);
     }
 
     return PRODOS_HDD_ERR_OK;
@@ -175,6 +176,8 @@ uint8_t prodos_hdd_write_block(prodos_hdd_t* sys, uint16_t buffer, uint32_t bloc
 
     if (sys->image_type == PRODOS_HDD_IMAGE_TYPE_MSC) {
         // USB flash drive
+        uint8_t buf[PRODOS_HDD_BYTES_PER_BLOCK];
+        mem_copy_out(mem, buffer, buf, PRODOS_HDD_BYTES_PER_BLOCK);
         FRESULT res;
         res = f_lseek(&sys->fil, block * PRODOS_HDD_BYTES_PER_BLOCK);
         if (res != FR_OK) {
@@ -182,7 +185,7 @@ uint8_t prodos_hdd_write_block(prodos_hdd_t* sys, uint16_t buffer, uint32_t bloc
             return PRODOS_HDD_ERR_IO;
         }
         UINT nwritten;
-        res = f_write(&sys->fil, mem_readptr(mem, buffer), PRODOS_HDD_BYTES_PER_BLOCK, &nwritten);
+        res = f_write(&sys->fil, buf, PRODOS_HDD_BYTES_PER_BLOCK, &nwritten);
         if (res != FR_OK || nwritten != PRODOS_HDD_BYTES_PER_BLOCK) {
             printf("Error %u writing to file\r\n", res);
             return PRODOS_HDD_ERR_IO;
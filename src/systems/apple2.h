@@ -71,7 +71,7 @@ extern "C" {
 #endif
 
 // Bump snapshot version when apple2_t memory layout changes
-#define APPLE2_SNAPSHOT_VERSION (1)
+#define APPLE2_SNAPSHOT_VERSION (3)
 
 #define APPLE2_FREQUENCY (1021800)
 
@@ -177,7 +177,10 @@ typedef struct {
 
 // Apple2 interface
 
-// Initialize a new Apple2 instance
+// Fill the read-only render table shared by all instances, call once before the first apple2_init() and
+// before starting threads that run instances, after that instances on separate threads are independent
+void apple2_init_tables(void);
+// Initialize a new Apple2 instance, apple2_init_tables() must have been called
 void apple2_init(apple2_t *sys, const apple2_desc_t *desc);
 // Discard Apple2 instance
 void apple2_discard(apple2_t *sys);
@@ -190,7 +193,8 @@ void apple2_tick(apple2_t *sys);
 uint32_t apple2_exec(apple2_t *sys, uint32_t micro_seconds);
 // Take a snapshot, patches pointers to zero or offsets, returns snapshot version
 uint32_t apple2_save_snapshot(apple2_t *sys, apple2_t *dst);
-// Load a snapshot, returns false if snapshot version doesn't match
+// Load a snapshot into the instance it was taken of, its ROM pages point into that instance's ROM images and
+// language card, returns false if snapshot version doesn't match
 bool apple2_load_snapshot(apple2_t *sys, uint32_t version, apple2_t *src);
 
 void apple2_screen_update(apple2_t *sys);
@@ -252,14 +256,20 @@ static inline uint8_t _apple2_reverse_7_bits(uint8_t bits) {
     return result;
 }
 
+static bool _apple2_tables_ready;
+
+void apple2_init_tables(void) {
+    _apple2_init_double_7_bits_lut();
+    _apple2_tables_ready = true;
+}
+
 void apple2_init(apple2_t *sys, const apple2_desc_t *desc) {
     CHIPS_ASSERT(sys && desc);
+    CHIPS_ASSERT(_apple2_tables_ready);
     if (desc->debug.callback.func) {
         CHIPS_ASSERT(desc->debug.stopped);
     }
 
-    _apple2_init_double_7_bits_lut();
-
     memset(sys, 0, sizeof(apple2_t));
     sys->valid = true;
     sys->debug = desc->debug;
@@ -630,14 +640,16 @@ bool apple2_load_snapshot(apple2_t *sys, uint32_t version, apple2_t *src) {
     if (version != APPLE2_SNAPSHOT_VERSION) {
         return false;
     }
-    static apple2_t im;
-    im = *src;
-    chips_debug_snapshot_onload(&im.debug, &sys->debug);
-    chips_audio_callback_snapshot_onload(&im.audio_callback, &sys->audio_callback);
-    // m6502_snapshot_onload(&im.cpu, &sys->cpu);
-    disk2_fdc_snapshot_onload(&im.fdc, &sys->fdc);
-    mem_snapshot_onload(&im.mem, sys);
-    *sys = im;
+    // The snapshot is copied straight over sys, keep what the fixups take from the caller's instance
+    chips_debug_t debug = sys->debug;
+    chips_audio_callback_t audio_callback = sys->audio_callback;
+    disk2_fdc_t fdc = sys->fdc;
+    *sys = *src;
+    chips_debug_snapshot_onload(&sys->debug, &debug);
+    chips_audio_callback_snapshot_onload(&sys->audio_callback, &audio_callback);
+    // m6502_snapshot_onload(&sys->cpu, &cpu);
+    disk2_fdc_snapshot_onload(&sys->fdc, &fdc);
+    mem_snapshot_onload(&sys->mem, sys);
     return true;
 }
 
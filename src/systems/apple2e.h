@@ -22,6 +22,8 @@
 //
 // - chips/chips_common.h
 // - chips/wdc65C02cpu.h | chips/mos6502cpu.h
+// - chips/mos6502cpu_exec.h (optional, enables APPLE2E_EXEC_MODE_INSTRUCTION, and
+//   APPLE2E_EXEC_MODE_BLOCK_CACHE if MEM_PAGE_GENERATIONS is defined)
 // - chips/beeper.h
 // - chips/kbd.h
 // - chips/mem.h
@@ -71,14 +73,58 @@ extern "C" {
 #endif
 
 // Bump snapshot version when apple2e_t memory layout changes
-#define APPLE2E_SNAPSHOT_VERSION (1)
+#define APPLE2E_SNAPSHOT_VERSION (14)
 
 #define APPLE2E_FREQUENCY (1021800)
 
+// Video frame timing in CPU ticks
+#define APPLE2E_FRAME_TICKS     (17031)
+#define APPLE2E_VBL_START_TICKS (12480)
+#define APPLE2E_SCANLINE_TICKS  (65)  // 192 visible scanlines end where VBL starts
+
+// Scheduled events, see apple2e_tick()
+#define APPLE2E_EVENT_VBL      (0)  // Vertical blanking starts or ends
+#define APPLE2E_EVENT_FLASH    (1)  // Flashing text toggles
+#define APPLE2E_EVENT_FDC      (2)  // Disk II motor times out
+#define APPLE2E_EVENT_AUDIO    (3)  // Beeper sample is ready
+#define APPLE2E_EVENT_SCANLINE (4)  // Beam reaches a visible scanline, see apple2e_set_scanline_render()
+#define APPLE2E_NUM_EVENTS     (5)
+
+// Execution modes, see apple2e_set_exec_mode()
+#define APPLE2E_EXEC_MODE_CYCLE       (0)  // One apple2e_tick() per clock cycle
+#define APPLE2E_EXEC_MODE_INSTRUCTION (1)  // One mos6502cpu_exec() per instruction
+#define APPLE2E_EXEC_MODE_BLOCK_CACHE (2)  // Predecoded blocks, see apple2e_set_block_cache()
+
+// Input changes, see apple2e_input()
+#define APPLE2E_INPUT_KEY         (0)   // Key press, value is the ASCII code (0x00-0x7F)
+#define APPLE2E_INPUT_OPEN_APPLE  (1)   // Value 1 pressed, 0 released
+#define APPLE2E_INPUT_SOLID_APPLE (2)   // Value 1 pressed, 0 released
+#define APPLE2E_INPUT_BUTTON0     (3)   // Game controller buttons 0-2, value 1 pressed, 0 released
+#define APPLE2E_INPUT_BUTTON1     (4)
+#define APPLE2E_INPUT_BUTTON2     (5)
+#define APPLE2E_INPUT_PADDLE0     (6)   // Game controller paddles 0-3, value is the position (0x00-0xFF)
+#define APPLE2E_INPUT_PADDLE1     (7)
+#define APPLE2E_INPUT_PADDLE2     (8)
+#define APPLE2E_INPUT_PADDLE3     (9)
+#define APPLE2E_INPUT_RESET       (10)  // Reset key, value unused
+#define APPLE2E_NUM_INPUTS        (11)
+
+// Number of video frames the hard disk counts as busy after a controller access, see apple2e_is_loading()
+#define APPLE2E_HDC_BUSY_FRAMES (30)
+
 #define APPLE2E_SCREEN_WIDTH     560  // (280 * 2)
 #define APPLE2E_SCREEN_HEIGHT    192  // (192)
 #define APPLE2E_FRAMEBUFFER_SIZE ((APPLE2E_SCREEN_WIDTH / 2) * APPLE2E_SCREEN_HEIGHT)
 
+// Number of 32-bit words in a dirty scanline mask (one bit per scanline)
+#define APPLE2E_DIRTY_WORDS (APPLE2E_SCREEN_HEIGHT / 32)
+
+// Output surface pixel formats, see apple2e_set_surface()
+#define APPLE2E_SURFACE_4BPP     (0)  // Two apple2e_palette indices per byte, high nibble first (same as fb)
+#define APPLE2E_SURFACE_RGB232   (1)  // One byte per pixel
+#define APPLE2E_SURFACE_RGB565   (2)  // One uint16_t per pixel
+#define APPLE2E_SURFACE_RGBA8888 (3)  // One uint32_t per pixel, apple2e_palette values
+
 #define PALETTE_BITS 4
 #define PALETTE_SIZE (1 << PALETTE_BITS)
 
@@ -119,6 +165,42 @@ typedef struct {
     } roms;
 } apple2e_desc_t;
 
+// Output surface of APPLE2E_SCREEN_WIDTH x APPLE2E_SCREEN_HEIGHT pixels
+typedef struct {
+    void *ptr;        // Top left pixel
+    uint32_t stride;  // Bytes from one row to the next
+    uint8_t format;   // APPLE2E_SURFACE_*
+} apple2e_surface_t;
+
+// Pages of the bank switched regions for each state of the soft switches that select them,
+// built by _apple2e_init_page_sets(), a soft switch access maps the runs of the new state
+typedef struct {
+    mem_page_t zp[2][0x0200 >> MEM_PAGE_SHIFT];     // $0000-$01FF by ALTZP
+    mem_page_t p0200[4][0x0200 >> MEM_PAGE_SHIFT];  // $0200-$03FF by RAMRD | RAMWRT << 1
+    mem_page_t text[4][0x0400 >> MEM_PAGE_SHIFT];   // $0400-$07FF, as $0200 or 80STORE with PAGE2
+    mem_page_t p0800[4][0x1800 >> MEM_PAGE_SHIFT];  // $0800-$1FFF, as $0200
+    mem_page_t hires[4][0x2000 >> MEM_PAGE_SHIFT];  // $2000-$3FFF, as $0400 with 80STORE and HIRES
+    mem_page_t p4000[4][0x8000 >> MEM_PAGE_SHIFT];  // $4000-$BFFF, as $0200
+    mem_page_t lc[16][0x3000 >> MEM_PAGE_SHIFT];    // $D000-$FFFF, see _apple2e_lc_index()
+} apple2e_page_sets_t;
+
+#ifdef MEM_WRITE_WATCH
+#if MEM_WRITE_WATCH_SHIFT > 12
+#error "apple2e delta snapshots need MEM_WRITE_WATCH_SHIFT of 12 or less"
+#endif
+// Bytes of main and aux RAM a delta snapshot carries for each chunk it includes
+#define APPLE2E_DELTA_CHUNK_SIZE (1U << MEM_WRITE_WATCH_SHIFT)
+
+// Delta snapshot header, see apple2e_save_delta(), followed by the CPU and device state and then
+// main and aux RAM of each included chunk in ascending order
+typedef struct {
+    uint32_t version;                        // APPLE2E_SNAPSHOT_VERSION
+    uint32_t size;                           // Bytes including this header
+    const void *base;                        // apple2e_t the delta was taken from, its pointers are patched
+    uint32_t chunks[MEM_WRITE_WATCH_WORDS];  // RAM chunks included, one bit per APPLE2E_DELTA_CHUNK_SIZE
+} apple2e_delta_t;
+#endif  // MEM_WRITE_WATCH
+
 // Apple //e emulator state
 typedef struct {
     MOS6502CPU_T cpu;
@@ -126,9 +208,12 @@ typedef struct {
     kbd_t kbd;
     mem_t mem;
     bool valid;
+    uint8_t exec_mode;
+    void *block_cache;  // mos6502cpu_block_cache_t for APPLE2E_EXEC_MODE_BLOCK_CACHE
     chips_debug_t debug;
 
     chips_audio_callback_t audio_callback;
+    bool audio_muted;  // Beeper samples are not generated, see apple2e_set_audio_muted()
 
     uint8_t ram[0x10000];
     uint8_t aux_ram[0x10000];
@@ -155,21 +240,42 @@ typedef struct {
 
     bool lcram, lcbnk2, prewrite, write_enabled;
 
+    apple2e_page_sets_t page_sets;
+
     bool ioudis;
     bool vbl;
 
-    uint32_t flash_timer_ticks;
+    // Scanlines to redraw for text/lores and hires pages 1 and 2
+    uint32_t text_dirty[2][APPLE2E_DIRTY_WORDS];
+    uint32_t hires_dirty[2][APPLE2E_DIRTY_WORDS];
+    uint8_t screen_mode[2];  // Video mode each display page was last rendered in, changes force a full redraw
+    uint8_t surface_page[APPLE2E_SCREEN_HEIGHT];  // Display page shown on each surface row, 0xFF while stale
+    bool scanline_render;  // Rows are rendered as the beam reaches them, see apple2e_set_scanline_render()
+    uint8_t scanline;      // Next scanline the APPLE2E_EVENT_SCANLINE renders
+#ifndef APPLE2E_NO_FRAME_HASH
+    uint64_t row_hash[APPLE2E_SCREEN_HEIGHT];  // chips_hash64() of each 4bpp row put into the surface
+    uint64_t frame_hash;                       // chips_hash64() of row_hash at the last apple2e_screen_update()
+#endif
 
-    bool text_page1_dirty;
-    bool text_page2_dirty;
-    bool hires_page1_dirty;
-    bool hires_page2_dirty;
+#ifndef APPLE2E_NO_PAGE_CACHE
+    // Rendered 4bpp copies of display pages 1 and 2, a page flip only presents the other copy
+    uint8_t page_fb[2][APPLE2E_FRAMEBUFFER_SIZE];
+#endif
 
-    uint8_t fb[APPLE2E_FRAMEBUFFER_SIZE];
+#ifndef APPLE2E_NO_FRAMEBUFFER
+    uint8_t fb[APPLE2E_FRAMEBUFFER_SIZE];  // Default 4bpp surface
+#endif
+    apple2e_surface_t surface;  // Where apple2e_screen_update() renders to
+
+    // Glyph rows as shown on screen for each (altcharset, flash) combination,
+    // character code and row, built from character_rom by _apple2e_update_glyphs()
+    uint8_t glyphs[4][256][8];
+    const uint8_t *glyph_rom;  // character_rom the glyph rows were built from
 
     disk2_fdc_t fdc;  // Disk II floppy disk controller
 
-    prodos_hdc_t hdc;  // ProDOS hard disk controller
+    prodos_hdc_t hdc;         // ProDOS hard disk controller
+    uint8_t hdc_busy_frames;  // Video frames until the hard disk counts as idle
 
     uint8_t kbd_last_key;
     bool kbd_open_apple_pressed;
@@ -180,22 +286,29 @@ typedef struct {
     uint8_t paddl2;
     uint8_t paddl3;
 
-    uint16_t paddl0_ticks_left;
-    uint16_t paddl1_ticks_left;
-    uint16_t paddl2_ticks_left;
-    uint16_t paddl3_ticks_left;
+    // system_ticks at which the paddle timers run out
+    uint32_t paddl0_timeout_ticks;
+    uint32_t paddl1_timeout_ticks;
+    uint32_t paddl2_timeout_ticks;
+    uint32_t paddl3_timeout_ticks;
 
     bool butn0;
     bool butn1;
     bool butn2;
 
     uint32_t system_ticks;
-    uint16_t vbl_ticks;
+    uint32_t frame_start_ticks;                // system_ticks at the start of the current video frame
+    uint32_t next_event_ticks;                 // system_ticks of the earliest pending event
+    uint32_t event_ticks[APPLE2E_NUM_EVENTS];  // system_ticks at which each pending event is due
+    uint8_t event_pending;                     // Bitmask of pending events
 } apple2e_t;
 
 // Apple2e interface
 
-// Initialize a new Apple2e instance
+// Fill the read-only render tables shared by all instances, call once before the first apple2e_init() and
+// before starting threads that run instances, after that instances on separate threads are independent
+void apple2e_init_tables(void);
+// Initialize a new Apple2e instance, apple2e_init_tables() must have been called
 void apple2e_init(apple2e_t *sys, const apple2e_desc_t *desc);
 // Discard Apple2e instance
 void apple2e_discard(apple2e_t *sys);
@@ -206,12 +319,40 @@ void apple2e_tick(apple2e_t *sys);
 
 // Tick Apple2e instance for a given number of microseconds, return number of executed ticks
 uint32_t apple2e_exec(apple2e_t *sys, uint32_t micro_seconds);
+// Tick Apple2e instance for at least num_ticks without updating the screen, return number of executed ticks
+uint32_t apple2e_exec_ticks(apple2e_t *sys, uint32_t num_ticks);
+// Switch apple2e_exec() between APPLE2E_EXEC_MODE_CYCLE, _INSTRUCTION and _BLOCK_CACHE
+void apple2e_set_exec_mode(apple2e_t *sys, uint8_t mode);
+// Provide the mos6502cpu_block_cache_t used by APPLE2E_EXEC_MODE_BLOCK_CACHE (owned by the caller)
+void apple2e_set_block_cache(apple2e_t *sys, void *cache);
+// Stop or resume generating beeper samples for the audio callback, e.g. while running faster than realtime
+void apple2e_set_audio_muted(apple2e_t *sys, bool muted);
+// Return true while the Disk II motor is on or the ProDOS hard disk was accessed recently
+bool apple2e_is_loading(apple2e_t *sys);
+// Apply an APPLE2E_INPUT_* change at the current system_ticks, returns false if it changes nothing
+bool apple2e_input(apple2e_t *sys, uint8_t input, uint8_t value);
 // Take snapshot, patches pointers to zero or offsets, returns snapshot version
 uint32_t apple2e_save_snapshot(apple2e_t *sys, apple2e_t *dst);
-// Load snapshot, returns false if snapshot version doesn't match
+// Load snapshot into any instance, it keeps its own ROM images, returns false if snapshot version doesn't match
 bool apple2e_load_snapshot(apple2e_t *sys, uint32_t version, apple2e_t *src);
-
+#ifdef MEM_WRITE_WATCH
+// Take a delta snapshot of the RAM chunks written since the last snapshot or delta and the CPU and device state,
+// buf must be aligned for apple2e_delta_t, returns the bytes used (at most sizeof(apple2e_t)) or 0 if it doesn't fit
+uint32_t apple2e_save_delta(apple2e_t *sys, void *buf, uint32_t buf_size);
+// Apply a delta snapshot onto the snapshot it was taken after, returns false if it doesn't match this version
+bool apple2e_apply_delta(apple2e_t *snapshot, const void *buf, uint32_t size);
+#endif  // MEM_WRITE_WATCH
+
+// Render the dirty rows of the displayed page into the surface, with scanline rendering only complete the frame
 void apple2e_screen_update(apple2e_t *sys);
+// Render each visible scanline when the beam reaches it with the soft switches of that moment instead
+void apple2e_set_scanline_render(apple2e_t *sys, bool enabled);
+#ifndef APPLE2E_NO_FRAME_HASH
+// Return a 64-bit hash of the frame completed by the last apple2e_screen_update(), unchanged frames have the same hash
+uint64_t apple2e_frame_hash(apple2e_t *sys);
+#endif
+// Render into a caller-supplied surface (owned by the caller) from now on, NULL selects fb again, forces a full redraw
+void apple2e_set_surface(apple2e_t *sys, const apple2e_surface_t *surface);
 
 #ifdef __cplusplus
 }  // extern "C"
@@ -226,6 +367,9 @@ void apple2e_screen_update(apple2e_t *sys);
 #endif
 
 static void _apple2e_init_memorymap(apple2e_t *sys);
+static void _apple2e_schedule_event(apple2e_t *sys, int event, uint32_t ticks);
+static void _apple2e_scanline_event(apple2e_t *sys);
+static void _apple2e_schedule_audio(apple2e_t *sys);
 
 // clang-format off
 static uint8_t __not_in_flash() _apple2e_artifact_color_lut[1<<7] = {
@@ -264,14 +408,78 @@ static void _apple2e_init_double_7_bits_lut() {
 
 static inline uint16_t _apple2e_double_7_bits(uint8_t bits) { return _apple2e_double_7_bits_lut[bits]; }
 
+// Two packed output bytes (4 pixels) of the artifact color renderer for each
+// 10-bit window of the line and pixel phase, see _apple2e_render_line_color()
+static uint16_t __not_in_flash() _apple2e_color_pair_lut[4][1 << 10];
+
+// Packed output of a 7-bit glyph row, for 40 columns (pixels doubled) and the
+// aux and main halves of an 80-column cell (which share the middle byte)
+static uint8_t __not_in_flash() _apple2e_text40_lut[128][7];
+static uint8_t __not_in_flash() _apple2e_text80_lut[2][128][4];
+
+static void _apple2e_render_line_monochrome(uint8_t *out, uint16_t *in, int start_col, int stop_col);
+
+static void _apple2e_init_text_luts() {
+    for (uint16_t bits = 0; bits < 128; bits++) {
+        uint8_t out[7];
+        uint16_t words[2] = {_apple2e_double_7_bits(bits), 0};
+        _apple2e_render_line_monochrome(_apple2e_text40_lut[bits], words, 0, 1);
+        words[0] = bits;
+        _apple2e_render_line_monochrome(out, words, 0, 1);
+        memcpy(_apple2e_text80_lut[0][bits], &out[0], 4);
+        words[0] = bits << 7;
+        _apple2e_render_line_monochrome(out, words, 0, 1);
+        memcpy(_apple2e_text80_lut[1][bits], &out[3], 4);
+    }
+}
+
+// Two pixels of a 4bpp byte in each surface format
+static uint8_t __not_in_flash() _apple2e_rgb232_lut[256][2];
+static uint16_t __not_in_flash() _apple2e_rgb565_lut[256][2];
+static uint32_t __not_in_flash() _apple2e_rgba8888_lut[256][2];
+
+static void _apple2e_init_surface_luts() {
+    for (int i = 0; i < 256; i++) {
+        for (int p = 0; p < 2; p++) {
+            uint32_t c = apple2e_palette[p ? (i & 0xF) : (i >> 4)];
+            uint8_t r = (c >> 16) & 0xFF, g = (c >> 8) & 0xFF, b = c & 0xFF;
+            _apple2e_rgb232_lut[i][p] = ((r >> 6) << 6) | ((g >> 5) << 2) | (b >> 6);
+            _apple2e_rgb565_lut[i][p] = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+            _apple2e_rgba8888_lut[i][p] = c;
+        }
+    }
+}
+
+static void _apple2e_init_color_pair_lut() {
+    for (uint32_t phase = 0; phase < 4; phase++) {
+        for (uint32_t bits = 0; bits < (1 << 10); bits++) {
+            uint16_t pair = 0;
+            for (uint32_t b = 0; b < 4; b++) {
+                uint16_t c = _apple2e_rotl4b(_apple2e_artifact_color_lut[(bits >> b) & 0x7F], phase + b);
+                pair |= c << ((b & 2) * 4 + ((b & 1) ? 0 : 4));
+            }
+            _apple2e_color_pair_lut[phase][bits] = pair;
+        }
+    }
+}
+
+static bool _apple2e_tables_ready;
+
+void apple2e_init_tables(void) {
+    _apple2e_init_double_7_bits_lut();
+    _apple2e_init_color_pair_lut();
+    _apple2e_init_text_luts();
+    _apple2e_init_surface_luts();
+    _apple2e_tables_ready = true;
+}
+
 void apple2e_init(apple2e_t *sys, const apple2e_desc_t *desc) {
     CHIPS_ASSERT(sys && desc);
+    CHIPS_ASSERT(_apple2e_tables_ready);
     if (desc->debug.callback.func) {
         CHIPS_ASSERT(desc->debug.stopped);
     }
 
-    _apple2e_init_double_7_bits_lut();
-
     memset(sys, 0, sizeof(apple2e_t));
     sys->valid = true;
     sys->debug = desc->debug;
@@ -298,7 +506,12 @@ void apple2e_init(apple2e_t *sys, const apple2e_desc_t *desc) {
     // setup memory map and keyboard matrix
     _apple2e_init_memorymap(sys);
 
-    sys->flash_timer_ticks = APPLE2E_FREQUENCY / 2;
+    // Draw the whole screen on the first apple2e_screen_update()
+    apple2e_set_surface(sys, 0);
+
+    _apple2e_schedule_event(sys, APPLE2E_EVENT_VBL, APPLE2E_VBL_START_TICKS);
+    _apple2e_schedule_event(sys, APPLE2E_EVENT_FLASH, APPLE2E_FREQUENCY / 2);
+    _apple2e_schedule_audio(sys);
 
     sys->ioudis = true;
 
@@ -346,6 +559,7 @@ void apple2e_discard(apple2e_t *sys) {
 void apple2e_reset(apple2e_t *sys) {
     CHIPS_ASSERT(sys && sys->valid);
     beeper_reset(&sys->beeper);
+    _apple2e_schedule_audio(sys);
     if (sys->fdc.valid) {
         disk2_fdc_reset(&sys->fdc);
     }
@@ -355,78 +569,227 @@ void apple2e_reset(apple2e_t *sys) {
     MOS6502CPU_RESET(&sys->cpu);
 }
 
-typedef struct {
-    uint8_t *read_ptr;
-    uint8_t *write_ptr;
-} mem_bank_t;
+bool apple2e_input(apple2e_t *sys, uint8_t input, uint8_t value) {
+    CHIPS_ASSERT(sys && sys->valid);
+    CHIPS_ASSERT(input < APPLE2E_NUM_INPUTS);
+    bool *buttons[] = {&sys->kbd_open_apple_pressed, &sys->kbd_solid_apple_pressed, &sys->butn0, &sys->butn1,
+                       &sys->butn2};
+    uint8_t *paddles[] = {&sys->paddl0, &sys->paddl1, &sys->paddl2, &sys->paddl3};
+    switch (input) {
+        case APPLE2E_INPUT_KEY:
+            // Every key press sets the keyboard strobe again, even of the same key
+            sys->kbd_last_key = (value & 0x7F) | 0x80;
+            return true;
+        case APPLE2E_INPUT_RESET:
+            apple2e_reset(sys);
+            return true;
+        case APPLE2E_INPUT_PADDLE0:
+        case APPLE2E_INPUT_PADDLE1:
+        case APPLE2E_INPUT_PADDLE2:
+        case APPLE2E_INPUT_PADDLE3: {
+            uint8_t *paddle = paddles[input - APPLE2E_INPUT_PADDLE0];
+            bool changed = (*paddle != value);
+            *paddle = value;
+            return changed;
+        }
+        default: {
+            bool *button = buttons[input - APPLE2E_INPUT_OPEN_APPLE];
+            bool changed = (*button != (value != 0));
+            *button = (value != 0);
+            return changed;
+        }
+    }
+}
+
+// Event scheduler
+//
+// Events are processed at the end of apple2e_tick() as soon as system_ticks
+// reaches their due time, which leaves a single compare per tick when no
+// event is due. In instruction mode system_ticks advances by whole
+// instructions and events are processed a few ticks late, periodic events
+// are rescheduled relative to their due time so they don't drift.
+
+static void _apple2e_update_next_event(apple2e_t *sys) {
+    int32_t next_ticks = INT32_MAX;
+    for (int event = 0; event < APPLE2E_NUM_EVENTS; event++) {
+        if (sys->event_pending & (1 << event)) {
+            int32_t ticks = (int32_t)(sys->event_ticks[event] - sys->system_ticks);
+            if (ticks < next_ticks) {
+                next_ticks = ticks;
+            }
+        }
+    }
+    sys->next_event_ticks = sys->system_ticks + (uint32_t)next_ticks;
+}
+
+// Schedule event to happen at the given system_ticks
+static void _apple2e_schedule_event_at(apple2e_t *sys, int event, uint32_t ticks) {
+    sys->event_ticks[event] = ticks;
+    sys->event_pending |= 1 << event;
+    _apple2e_update_next_event(sys);
+}
+
+// Schedule event to happen the given number of ticks from now
+static void _apple2e_schedule_event(apple2e_t *sys, int event, uint32_t ticks) {
+    CHIPS_ASSERT(ticks > 0);
+    _apple2e_schedule_event_at(sys, event, sys->system_ticks + ticks);
+}
+
+static void _apple2e_cancel_event(apple2e_t *sys, int event) {
+    sys->event_pending &= ~(1 << event);
+    _apple2e_update_next_event(sys);
+}
+
+static void _apple2e_schedule_audio(apple2e_t *sys) {
+    // Beeper samples are only needed by the audio callback
+    if (sys->audio_callback.func && !sys->audio_muted) {
+        _apple2e_schedule_event(sys, APPLE2E_EVENT_AUDIO, beeper_sample_ticks(&sys->beeper));
+    }
+}
+
+static void _apple2e_schedule_fdc(apple2e_t *sys) {
+    if (!sys->fdc.valid || (sys->fdc.fdd[0].motor_timer_ticks == 0)) {
+        _apple2e_cancel_event(sys, APPLE2E_EVENT_FDC);
+        return;
+    }
+    // The FDC ticks after the CPU on every 128th system tick, the motor goes
+    // off on the FDC tick which runs the motor timer down to zero
+    uint32_t fdc_ticks = (sys->system_ticks + 127) & ~127U;
+    fdc_ticks += (sys->fdc.fdd[0].motor_timer_ticks - 1) * 128;
+    _apple2e_schedule_event(sys, APPLE2E_EVENT_FDC, fdc_ticks + 1 - sys->system_ticks);
+}
+
+static inline bool _apple2e_paddl_active(apple2e_t *sys, uint32_t timeout_ticks) {
+    return (int32_t)(timeout_ticks - sys->system_ticks) > 0;
+}
+
+static void _apple2e_vbl_event(apple2e_t *sys) {
+    if (!sys->vbl) {
+        sys->vbl = true;
+        uint32_t vbl_end_ticks = sys->event_ticks[APPLE2E_EVENT_VBL] + APPLE2E_FRAME_TICKS - 1 - APPLE2E_VBL_START_TICKS;
+        _apple2e_schedule_event_at(sys, APPLE2E_EVENT_VBL, vbl_end_ticks);
+        return;
+    }
+    sys->vbl = false;
+    sys->frame_start_ticks = sys->event_ticks[APPLE2E_EVENT_VBL] + 1;
+    _apple2e_schedule_event_at(sys, APPLE2E_EVENT_VBL, sys->frame_start_ticks + APPLE2E_VBL_START_TICKS);
+    if (sys->hdc_busy_frames > 0) {
+        sys->hdc_busy_frames--;
+    }
+    // Keep expired paddle timers from coming back to life when system_ticks wraps around
+    if (!_apple2e_paddl_active(sys, sys->paddl0_timeout_ticks)) {
+        sys->paddl0_timeout_ticks = sys->system_ticks;
+    }
+    if (!_apple2e_paddl_active(sys, sys->paddl1_timeout_ticks)) {
+        sys->paddl1_timeout_ticks = sys->system_ticks;
+    }
+    if (!_apple2e_paddl_active(sys, sys->paddl2_timeout_ticks)) {
+        sys->paddl2_timeout_ticks = sys->system_ticks;
+    }
+    if (!_apple2e_paddl_active(sys, sys->paddl3_timeout_ticks)) {
+        sys->paddl3_timeout_ticks = sys->system_ticks;
+    }
+}
+
+static void _apple2e_flash_event(apple2e_t *sys) {
+    sys->flash = !sys->flash;
+    memset(sys->text_dirty, 0xFF, sizeof(sys->text_dirty));
+    _apple2e_schedule_event_at(sys, APPLE2E_EVENT_FLASH, sys->event_ticks[APPLE2E_EVENT_FLASH] + APPLE2E_FREQUENCY / 2);
+}
+
+static void _apple2e_fdc_event(apple2e_t *sys) {
+    // Run the motor timer down in one step
+    disk2_fdc_advance(&sys->fdc, sys->fdc.fdd[0].motor_timer_ticks);
+}
+
+static void _apple2e_audio_event(apple2e_t *sys) {
+    if (beeper_advance(&sys->beeper, beeper_sample_ticks(&sys->beeper))) {
+        // New sample is ready
+        sys->audio_callback.func((uint8_t)(sys->beeper.sample * 255.0f), sys->audio_callback.user_data);
+    }
+    _apple2e_schedule_event_at(sys, APPLE2E_EVENT_AUDIO,
+                               sys->event_ticks[APPLE2E_EVENT_AUDIO] + beeper_sample_ticks(&sys->beeper));
+}
+
+static void _apple2e_process_due_events(apple2e_t *sys) {
+    for (int event = 0; event < APPLE2E_NUM_EVENTS; event++) {
+        if ((sys->event_pending & (1 << event)) && ((int32_t)(sys->event_ticks[event] - sys->system_ticks) <= 0)) {
+            sys->event_pending &= ~(1 << event);
+            switch (event) {
+                case APPLE2E_EVENT_VBL:
+                    _apple2e_vbl_event(sys);
+                    break;
+                case APPLE2E_EVENT_FLASH:
+                    _apple2e_flash_event(sys);
+                    break;
+                case APPLE2E_EVENT_FDC:
+                    _apple2e_fdc_event(sys);
+                    break;
+                case APPLE2E_EVENT_AUDIO:
+                    _apple2e_audio_event(sys);
+                    break;
+                case APPLE2E_EVENT_SCANLINE:
+                    _apple2e_scanline_event(sys);
+                    break;
+            }
+        }
+    }
+    _apple2e_update_next_event(sys);
+}
+
+static void _apple2e_process_events(apple2e_t *sys) {
+    // Rescheduled events can already be due again when processed late in instruction mode
+    do {
+        _apple2e_process_due_events(sys);
+    } while ((int32_t)(sys->next_event_ticks - sys->system_ticks) <= 0);
+}
 
-static mem_bank_t mem_bank_0000[2];
-static mem_bank_t mem_bank_0200[4];
-static mem_bank_t mem_bank_0400[4];
-static mem_bank_t mem_bank_0800[4];
-static mem_bank_t mem_bank_2000[4];
-static mem_bank_t mem_bank_4000[4];
+static inline int _apple2e_ramwr_index(apple2e_t *sys) { return (sys->ramrd ? 1 : 0) | (sys->ramwrt ? 2 : 0); }
+
+static inline int _apple2e_lc_index(apple2e_t *sys) {
+    return (sys->altzp ? 1 : 0) | (sys->lcbnk2 ? 2 : 0) | (sys->lcram ? 4 : 0) | (sys->write_enabled ? 8 : 0);
+}
 
 static void _apple2e_text_bank_update(apple2e_t *sys) {
-    int ramwr = (sys->ramrd ? 1 : 0) | (sys->ramwrt ? 2 : 0);
-    int bank = ramwr;
+    int bank = _apple2e_ramwr_index(sys);
     if (sys->_80store) {
         bank = sys->page2 ? 3 : 0;
     }
-    mem_map_rw(&sys->mem, 0, 0x0400, 0x400, mem_bank_0400[bank].read_ptr, mem_bank_0400[bank].write_ptr);
+    mem_map_pages(&sys->mem, 0, 0x0400, 0x400, sys->page_sets.text[bank]);
 }
 
 static void _apple2e_hires_bank_update(apple2e_t *sys) {
-    int ramwr = (sys->ramrd ? 1 : 0) | (sys->ramwrt ? 2 : 0);
-    int bank = ramwr;
+    int bank = _apple2e_ramwr_index(sys);
     if ((sys->_80store) && (sys->hires)) {
         bank = sys->page2 ? 3 : 0;
     }
-    mem_map_rw(&sys->mem, 0, 0x2000, 0x2000, mem_bank_2000[bank].read_ptr, mem_bank_2000[bank].write_ptr);
+    mem_map_pages(&sys->mem, 0, 0x2000, 0x2000, sys->page_sets.hires[bank]);
 }
 
 static void _apple2e_aux_bank_update(apple2e_t *sys) {
-    int ramwr = (sys->ramrd ? 1 : 0) | (sys->ramwrt ? 2 : 0);
+    int ramwr = _apple2e_ramwr_index(sys);
 
-    mem_map_rw(&sys->mem, 0, 0x0200, 0x200, mem_bank_0200[ramwr].read_ptr, mem_bank_0200[ramwr].write_ptr);
+    mem_map_pages(&sys->mem, 0, 0x0200, 0x200, sys->page_sets.p0200[ramwr]);
 
     if (!sys->_80store) {
         _apple2e_text_bank_update(sys);
     }
 
-    mem_map_rw(&sys->mem, 0, 0x0800, 0x1800, mem_bank_0800[ramwr].read_ptr, mem_bank_0800[ramwr].write_ptr);
+    mem_map_pages(&sys->mem, 0, 0x0800, 0x1800, sys->page_sets.p0800[ramwr]);
 
     if (!((sys->_80store) && (sys->hires))) {
         _apple2e_hires_bank_update(sys);
     }
 
-    mem_map_rw(&sys->mem, 0, 0x4000, 0x8000, mem_bank_4000[ramwr].read_ptr, mem_bank_4000[ramwr].write_ptr);
+    mem_map_pages(&sys->mem, 0, 0x4000, 0x8000, sys->page_sets.p4000[ramwr]);
 }
 
 static void _apple2e_lc_bank_update(apple2e_t *sys) {
-    uint8_t *ram_ptr = sys->altzp ? sys->aux_ram : sys->ram;
-    uint16_t bank_offset = 0xC000 + (sys->lcbnk2 ? 0x1000 : 0x0000);
-
-    if (sys->lcram) {
-        if (sys->write_enabled) {
-            mem_map_ram(&sys->mem, 0, 0xD000, 0x1000, ram_ptr + bank_offset);
-            mem_map_ram(&sys->mem, 0, 0xE000, 0x2000, ram_ptr + 0xE000);
-        } else {
-            mem_map_rom(&sys->mem, 0, 0xD000, 0x1000, ram_ptr + bank_offset);
-            mem_map_rom(&sys->mem, 0, 0xE000, 0x2000, ram_ptr + 0xE000);
-        }
-    } else {
-        if (sys->write_enabled) {
-            mem_map_rw(&sys->mem, 0, 0xD000, 0x1000, sys->rom + 0x1000, ram_ptr + bank_offset);
-            mem_map_rw(&sys->mem, 0, 0xE000, 0x2000, sys->rom + 0x2000, ram_ptr + 0xE000);
-        } else {
-            mem_map_rom(&sys->mem, 0, 0xD000, 0x3000, sys->rom + 0x1000);
-        }
-    }
+    mem_map_pages(&sys->mem, 0, 0xD000, 0x3000, sys->page_sets.lc[_apple2e_lc_index(sys)]);
 }
 
 static void _apple2e_altzp_update(apple2e_t *sys) {
-    mem_map_rw(&sys->mem, 0, 0x0000, 0x200, mem_bank_0000[sys->altzp].read_ptr, mem_bank_0000[sys->altzp].write_ptr);
+    mem_map_pages(&sys->mem, 0, 0x0000, 0x200, sys->page_sets.zp[sys->altzp]);
     _apple2e_lc_bank_update(sys);
 }
 
@@ -631,6 +994,42 @@ static void _apple2e_mem_c010_c01f_r(apple2e_t *sys, uint16_t addr) {
     MOS6502CPU_SET_DATA(&sys->cpu, data);
 }
 
+// Mark the scanlines showing a video memory address for redraw, rows are
+// interleaved in thirds of 40 bytes per 128 byte block (the last 8 bytes of
+// each block are screen holes)
+static void _apple2e_mark_dirty(apple2e_t *sys, uint16_t addr) {
+    if ((addr >= 0x0400) && (addr <= 0x0BFF)) {
+        uint16_t offset = addr & 0x3FF;
+        uint16_t third = (offset & 0x7F) / 40;
+        if (third < 3) {
+            // A text row covers 8 scanlines, which are byte aligned in the mask
+            uint16_t row = ((third << 3) | (offset >> 7)) * 8;
+            sys->text_dirty[addr >> 11][row >> 5] |= 0xFFU << (row & 31);
+        }
+    } else if ((addr >= 0x2000) && (addr <= 0x5FFF)) {
+        uint16_t offset = addr & 0x1FFF;
+        uint16_t third = (offset & 0x7F) / 40;
+        if (third < 3) {
+            uint16_t row = (third << 6) | (((offset >> 7) & 7) << 3) | (offset >> 10);
+            sys->hires_dirty[(addr >> 14) & 1][row >> 5] |= 1U << (row & 31);
+        }
+    }
+}
+
+// Mark the scanlines showing any of num_bytes from addr for redraw, only visits the video memory part (the
+// part of a range that wraps around at $FFFF is below $0400)
+static void _apple2e_mark_dirty_range(apple2e_t *sys, uint16_t addr, uint32_t num_bytes) {
+    static const uint32_t video_ranges[2][2] = {{0x0400, 0x0C00}, {0x2000, 0x6000}};
+    const uint32_t end = (uint32_t)addr + num_bytes;
+    for (int i = 0; i < 2; i++) {
+        const uint32_t first = video_ranges[i][0] > addr ? video_ranges[i][0] : addr;
+        const uint32_t last = video_ranges[i][1] < end ? video_ranges[i][1] : end;
+        for (uint32_t a = first; a < last; a++) {
+            _apple2e_mark_dirty(sys, (uint16_t)a);
+        }
+    }
+}
+
 static void _apple2e_mem_c000_c0ff_rw(apple2e_t *sys, uint16_t addr, bool rw) {
     switch (addr & 0xFF) {
         case 0x10:
@@ -731,28 +1130,28 @@ static void _apple2e_mem_c000_c0ff_rw(apple2e_t *sys, uint16_t addr, bool rw) {
         case 0x64:  // Joystick 1 X axis
         case 0x6C:
             if (rw) {
-                MOS6502CPU_SET_DATA(&sys->cpu, sys->paddl0_ticks_left > 0 ? 0x80 : 00);
+                MOS6502CPU_SET_DATA(&sys->cpu, _apple2e_paddl_active(sys, sys->paddl0_timeout_ticks) ? 0x80 : 00);
             }
             break;
 
         case 0x65:  // Joystick 1 Y axis
         case 0x6D:
             if (rw) {
-                MOS6502CPU_SET_DATA(&sys->cpu, sys->paddl1_ticks_left > 0 ? 0x80 : 00);
+                MOS6502CPU_SET_DATA(&sys->cpu, _apple2e_paddl_active(sys, sys->paddl1_timeout_ticks) ? 0x80 : 00);
             }
             break;
 
         case 0x66:  // Joystick 2 X axis
         case 0x6E:
             if (rw) {
-                MOS6502CPU_SET_DATA(&sys->cpu, sys->paddl2_ticks_left > 0 ? 0x80 : 00);
+                MOS6502CPU_SET_DATA(&sys->cpu, _apple2e_paddl_active(sys, sys->paddl2_timeout_ticks) ? 0x80 : 00);
             }
             break;
 
         case 0x67:  // Joystick 2 Y axis
         case 0x6F:
             if (rw) {
-                MOS6502CPU_SET_DATA(&sys->cpu, sys->paddl3_ticks_left > 0 ? 0x80 : 00);
+                MOS6502CPU_SET_DATA(&sys->cpu, _apple2e_paddl_active(sys, sys->paddl3_timeout_ticks) ? 0x80 : 00);
             }
             break;
 
@@ -793,17 +1192,17 @@ static void _apple2e_mem_c000_c0ff_rw(apple2e_t *sys, uint16_t addr, bool rw) {
                 beeper_toggle(&sys->beeper);
             } else if ((addr >= 0xC070) && (addr <= 0xC07F)) {
                 // Joystick
-                if (sys->paddl0_ticks_left == 0) {
-                    sys->paddl0_ticks_left = sys->paddl0 * 11;
+                if (!_apple2e_paddl_active(sys, sys->paddl0_timeout_ticks)) {
+                    sys->paddl0_timeout_ticks = sys->system_ticks + sys->paddl0 * 11;
                 }
-                if (sys->paddl1_ticks_left == 0) {
-                    sys->paddl1_ticks_left = sys->paddl1 * 11;
+                if (!_apple2e_paddl_active(sys, sys->paddl1_timeout_ticks)) {
+                    sys->paddl1_timeout_ticks = sys->system_ticks + sys->paddl1 * 11;
                 }
-                if (sys->paddl2_ticks_left == 0) {
-                    sys->paddl2_ticks_left = sys->paddl2 * 11;
+                if (!_apple2e_paddl_active(sys, sys->paddl2_timeout_ticks)) {
+                    sys->paddl2_timeout_ticks = sys->system_ticks + sys->paddl2 * 11;
                 }
-                if (sys->paddl3_ticks_left == 0) {
-                    sys->paddl3_ticks_left = sys->paddl3 * 11;
+                if (!_apple2e_paddl_active(sys, sys->paddl3_timeout_ticks)) {
+                    sys->paddl3_timeout_ticks = sys->system_ticks + sys->paddl3 * 11;
                 }
             } else if ((addr >= 0xC080) && (addr <= 0xC08F)) {
                 // 16K Language Card
@@ -820,6 +1219,10 @@ static void _apple2e_mem_c000_c0ff_rw(apple2e_t *sys, uint16_t addr, bool rw) {
                     // Memory write
                     disk2_fdc_write_byte(&sys->fdc, addr & 0xF, MOS6502CPU_GET_DATA(&sys->cpu));
                 }
+                if ((addr & 0xE) == DISK2_FDC_MOTOR_OFF) {
+                    // Motor on/off, reschedule motor timeout
+                    _apple2e_schedule_fdc(sys);
+                }
             } else if ((addr >= 0xC0F0) && (addr <= 0xC0FF)) {
                 // ProDOS HDC
                 if (rw) {
@@ -827,14 +1230,22 @@ static void _apple2e_mem_c000_c0ff_rw(apple2e_t *sys, uint16_t addr, bool rw) {
                     MOS6502CPU_SET_DATA(&sys->cpu, sys->hdc.valid ? prodos_hdc_read_byte(&sys->hdc, addr & 0xF) : 0x00);
                 } else {
                     // Memory write
-                    prodos_hdc_write_byte(&sys->hdc, addr & 0xF, MOS6502CPU_GET_DATA(&sys->cpu), &sys->mem);
+                    const uint16_t buffer = mem_rd16(&sys->mem, PRODOS_DRV_BUFFER);
+                    if (prodos_hdc_write_byte(&sys->hdc, addr & 0xF, MOS6502CPU_GET_DATA(&sys->cpu), &sys->mem)) {
+                        // The block went straight to memory, redraw anything it loaded into video memory
+                        _apple2e_mark_dirty_range(sys, buffer, PRODOS_HDD_BYTES_PER_BLOCK);
+                    }
+                }
+                if (sys->hdc.valid) {
+                    sys->hdc_busy_frames = APPLE2E_HDC_BUSY_FRAMES;
                 }
             }
             break;
     }
 }
 
-static void _apple2e_mem_rw(apple2e_t *sys, uint16_t addr, bool rw) {
+// Accesses to pages trapped in _apple2e_init_memorymap()
+static void _apple2e_mem_trap_rw(apple2e_t *sys, uint16_t addr, bool rw) {
     if ((addr >= 0xC000) && (addr <= 0xCFFF)) {
         if ((addr >= 0xC000) && (addr <= 0xC0FF)) {
             // Apple //e I/O Page
@@ -862,108 +1273,243 @@ static void _apple2e_mem_rw(apple2e_t *sys, uint16_t addr, bool rw) {
                 MOS6502CPU_SET_DATA(&sys->cpu, mem_rd(&sys->mem, addr));
             }
         }
+    } else if (rw) {
+        // Memory read
+        MOS6502CPU_SET_DATA(&sys->cpu, mem_rd(&sys->mem, addr));
     } else {
-        // Regular memory access
-        if (rw) {
-            // Memory read
-            MOS6502CPU_SET_DATA(&sys->cpu, mem_rd(&sys->mem, addr));
-        } else {
-            // Memory write
-            mem_wr(&sys->mem, addr, MOS6502CPU_GET_DATA(&sys->cpu));
-            if (addr >= 0x400 && addr <= 0x7FF) {
-                sys->text_page1_dirty = true;
-            } else if (addr >= 0x800 && addr <= 0xBFF) {
-                sys->text_page2_dirty = true;
-            } else if (addr >= 0x2000 && addr <= 0x3FFF) {
-                sys->hires_page1_dirty = true;
-            } else if (addr >= 0x4000 && addr <= 0x5FFF) {
-                sys->hires_page2_dirty = true;
-            }
-        }
+        // Memory write to video memory
+        mem_wr(&sys->mem, addr, MOS6502CPU_GET_DATA(&sys->cpu));
+        _apple2e_mark_dirty(sys, addr);
     }
 }
 
-void apple2e_tick(apple2e_t *sys) {
-    if (sys->vbl_ticks == 12480) {
-        sys->vbl = true;
-    }
-
-    if (sys->vbl_ticks < 17030) {
-        sys->vbl_ticks++;
+static inline void _apple2e_mem_rw(apple2e_t *sys, uint16_t addr, bool rw) {
+    if (mem_is_trapped(&sys->mem, addr, rw)) {
+        _apple2e_mem_trap_rw(sys, addr, rw);
+    } else if (rw) {
+        // Regular memory read
+        MOS6502CPU_SET_DATA(&sys->cpu, mem_rd(&sys->mem, addr));
     } else {
-        sys->vbl_ticks = 0;
-        sys->vbl = false;
+        // Regular memory write
+        mem_wr(&sys->mem, addr, MOS6502CPU_GET_DATA(&sys->cpu));
     }
+}
 
-    if (sys->paddl0_ticks_left > 0) {
-        sys->paddl0_ticks_left--;
-    }
-    if (sys->paddl1_ticks_left > 0) {
-        sys->paddl1_ticks_left--;
-    }
-    if (sys->paddl2_ticks_left > 0) {
-        sys->paddl2_ticks_left--;
+void apple2e_tick(apple2e_t *sys) {
+    MOS6502CPU_TICK(&sys->cpu);
+
+    _apple2e_mem_rw(sys, sys->cpu.addr, sys->cpu.rw);
+
+    sys->system_ticks++;
+
+    // Everything besides the CPU and memory happens in scheduled events
+    if (sys->system_ticks == sys->next_event_ticks) {
+        _apple2e_process_events(sys);
     }
-    if (sys->paddl3_ticks_left > 0) {
-        sys->paddl3_ticks_left--;
+}
+
+#ifdef MOS6502CPU_EXEC
+static uint8_t _apple2e_exec_io(uint16_t addr, bool rw, uint8_t data, void *user_data) {
+    apple2e_t *sys = (apple2e_t *)user_data;
+    if (!rw) {
+        MOS6502CPU_SET_DATA(&sys->cpu, data);
     }
+    _apple2e_mem_rw(sys, addr, rw);
+    return MOS6502CPU_GET_DATA(&sys->cpu);
+}
 
-    MOS6502CPU_TICK(&sys->cpu);
+static void _apple2e_init_bus(apple2e_t *sys, mos6502cpu_bus_t *bus) {
+    // The I/O page, the slot ROMs and writes to video memory (for the dirty
+    // flags) go through _apple2e_mem_rw(), everything else is a direct page
+    // table access
+    mos6502cpu_bus_init(bus, &(mos6502cpu_bus_desc_t){
+                                 .mem = &sys->mem,
+                                 .io_cb = _apple2e_exec_io,
+                                 .user_data = sys,
+                             });
+    mos6502cpu_bus_add_io_range(bus, 0xC000, 0xCFFF);
+    mos6502cpu_bus_add_write_trap(bus, 0x0400, 0x0BFF);
+    mos6502cpu_bus_add_write_trap(bus, 0x2000, 0x5FFF);
+}
 
-    _apple2e_mem_rw(sys, sys->cpu.addr, sys->cpu.rw);
+static uint32_t _apple2e_exec_instructions(apple2e_t *sys, uint32_t num_ticks) {
+    mos6502cpu_bus_t bus;
+    _apple2e_init_bus(sys, &bus);
+
+    uint32_t ticks = 0;
+    while (ticks < num_ticks) {
+        uint32_t cycles = MOS6502CPU_EXEC(&sys->cpu, &bus);
+        ticks += cycles;
+        sys->system_ticks += cycles;
+        if ((int32_t)(sys->system_ticks - sys->next_event_ticks) >= 0) {
+            _apple2e_process_events(sys);
+        }
+    }
+    return ticks;
+}
+#endif
 
-    // Update beeper
-    if (beeper_tick(&sys->beeper)) {
-        if (sys->audio_callback.func) {
-            // New sample is ready
-            sys->audio_callback.func((uint8_t)(sys->beeper.sample * 255.0f), sys->audio_callback.user_data);
+#ifdef MOS6502CPU_EXEC_CACHED
+typedef struct {
+    mos6502cpu_bus_t bus;
+    apple2e_t *sys;
+} _apple2e_block_bus_t;
+
+// I/O from inside mos6502cpu_exec_cached() happens bus.cycles after system_ticks
+static uint8_t _apple2e_exec_block_io(uint16_t addr, bool rw, uint8_t data, void *user_data) {
+    _apple2e_block_bus_t *block_bus = (_apple2e_block_bus_t *)user_data;
+    apple2e_t *sys = block_bus->sys;
+    sys->system_ticks += block_bus->bus.cycles;
+    data = _apple2e_exec_io(addr, rw, data, sys);
+    sys->system_ticks -= block_bus->bus.cycles;
+    return data;
+}
+
+// Same as _apple2e_exec_instructions(), but runs up to the next event at once
+static uint32_t _apple2e_exec_blocks(apple2e_t *sys, uint32_t num_ticks) {
+    _apple2e_block_bus_t block_bus = {.sys = sys};
+    mos6502cpu_bus_t *bus = &block_bus.bus;
+    _apple2e_init_bus(sys, bus);
+    bus->io_cb = _apple2e_exec_block_io;
+    bus->user_data = &block_bus;
+
+    uint32_t ticks = 0;
+    while (ticks < num_ticks) {
+        uint32_t max_ticks = num_ticks - ticks;
+        int32_t event_ticks = (int32_t)(sys->next_event_ticks - sys->system_ticks);
+        if (event_ticks < (int32_t)max_ticks) {
+            max_ticks = (event_ticks > 0) ? (uint32_t)event_ticks : 1;
+        }
+        uint32_t cycles = MOS6502CPU_EXEC_CACHED(&sys->cpu, bus, sys->block_cache, max_ticks);
+        ticks += cycles;
+        sys->system_ticks += cycles;
+        if ((int32_t)(sys->system_ticks - sys->next_event_ticks) >= 0) {
+            _apple2e_process_events(sys);
         }
     }
+    return ticks;
+}
+#endif
+
+void apple2e_set_exec_mode(apple2e_t *sys, uint8_t mode) {
+    CHIPS_ASSERT(sys && sys->valid);
+    CHIPS_ASSERT(mode <= APPLE2E_EXEC_MODE_BLOCK_CACHE);
+    // Modes that need mos6502cpu_exec.h (and a block cache) fall back to the next simpler one
+#ifdef MOS6502CPU_EXEC_CACHED
+    if ((mode == APPLE2E_EXEC_MODE_BLOCK_CACHE) && !sys->block_cache) {
+        mode = APPLE2E_EXEC_MODE_INSTRUCTION;
+    }
+#else
+    if (mode == APPLE2E_EXEC_MODE_BLOCK_CACHE) {
+        mode = APPLE2E_EXEC_MODE_INSTRUCTION;
+    }
+#endif
+#ifdef MOS6502CPU_EXEC
+    sys->exec_mode = mode;
+#else
+    sys->exec_mode = APPLE2E_EXEC_MODE_CYCLE;
+#endif
+}
 
-    // Tick FDC
-    if (sys->fdc.valid && (sys->system_ticks & 127) == 0) {
-        disk2_fdc_tick(&sys->fdc);
+void apple2e_set_block_cache(apple2e_t *sys, void *cache) {
+    CHIPS_ASSERT(sys && sys->valid);
+#ifdef MOS6502CPU_EXEC_CACHED
+    if (cache) {
+        mos6502cpu_block_cache_init((mos6502cpu_block_cache_t *)cache);
     }
+#endif
+    sys->block_cache = cache;
+    if (!cache && (sys->exec_mode == APPLE2E_EXEC_MODE_BLOCK_CACHE)) {
+        sys->exec_mode = APPLE2E_EXEC_MODE_INSTRUCTION;
+    }
+}
 
-    if (sys->flash_timer_ticks > 0) {
-        sys->flash_timer_ticks--;
-        if (sys->flash_timer_ticks == 0) {
-            sys->flash = !sys->flash;
-            sys->flash_timer_ticks = APPLE2E_FREQUENCY / 2;
-            if (!sys->page2) {
-                sys->text_page1_dirty = true;
-            } else {
-                sys->text_page2_dirty = true;
-            }
-        }
+void apple2e_set_audio_muted(apple2e_t *sys, bool muted) {
+    CHIPS_ASSERT(sys && sys->valid);
+    if (muted == sys->audio_muted) {
+        return;
+    }
+    sys->audio_muted = muted;
+    if (muted) {
+        _apple2e_cancel_event(sys, APPLE2E_EVENT_AUDIO);
+    } else {
+        _apple2e_schedule_audio(sys);
     }
+}
 
-    sys->system_ticks++;
+bool apple2e_is_loading(apple2e_t *sys) {
+    CHIPS_ASSERT(sys && sys->valid);
+    if (sys->fdc.valid && disk2_fdd_is_motor_on(&sys->fdc.fdd[0])) {
+        return true;
+    }
+    return sys->hdc_busy_frames > 0;
 }
 
-uint32_t apple2e_exec(apple2e_t *sys, uint32_t micro_seconds) {
+uint32_t apple2e_exec_ticks(apple2e_t *sys, uint32_t num_ticks) {
     CHIPS_ASSERT(sys && sys->valid);
-    uint32_t num_ticks = clk_us_to_ticks(APPLE2E_FREQUENCY, micro_seconds);
-    // uint32_t num_ticks = 50;
+    uint32_t ticks = 0;
     if (0 == sys->debug.callback.func) {
+#ifdef MOS6502CPU_EXEC_CACHED
+        if (sys->exec_mode == APPLE2E_EXEC_MODE_BLOCK_CACHE) {
+            return _apple2e_exec_blocks(sys, num_ticks);
+        }
+#endif
+#ifdef MOS6502CPU_EXEC
+        if (sys->exec_mode == APPLE2E_EXEC_MODE_INSTRUCTION) {
+            return _apple2e_exec_instructions(sys, num_ticks);
+        }
+#endif
         // run without debug callback
-        for (uint32_t ticks = 0; ticks < num_ticks; ticks++) {
+        for (; ticks < num_ticks; ticks++) {
             apple2e_tick(sys);
         }
     } else {
-        // run with debug callback
-        for (uint32_t ticks = 0; (ticks < num_ticks) && !(*sys->debug.stopped); ticks++) {
+        // run with debug callback, always cycle-stepped
+        for (; (ticks < num_ticks) && !(*sys->debug.stopped); ticks++) {
             apple2e_tick(sys);
             sys->debug.callback.func(sys->debug.callback.user_data, 0);
         }
     }
+    return ticks;
+}
+
+uint32_t apple2e_exec(apple2e_t *sys, uint32_t micro_seconds) {
+    CHIPS_ASSERT(sys && sys->valid);
+    uint32_t num_ticks = apple2e_exec_ticks(sys, clk_us_to_ticks(APPLE2E_FREQUENCY, micro_seconds));
     // kbd_update(&sys->kbd, micro_seconds);
     apple2e_screen_update(sys);
-
-    // printf("executed %d ticks\n", num_ticks);
     return num_ticks;
 }
 
+// Build the page runs of the bank switched regions, they point into ram, aux_ram and rom
+static void _apple2e_init_page_sets(apple2e_t *sys) {
+    apple2e_page_sets_t *sets = &sys->page_sets;
+    for (int altzp = 0; altzp < 2; altzp++) {
+        uint8_t *ptr = altzp ? sys->aux_ram : sys->ram;
+        mem_init_pages(&sys->mem, sets->zp[altzp], 0x0200, ptr, ptr);
+    }
+    for (int ramwr = 0; ramwr < 4; ramwr++) {
+        uint8_t *rd = (ramwr & 1) ? sys->aux_ram : sys->ram;
+        uint8_t *wr = (ramwr & 2) ? sys->aux_ram : sys->ram;
+        mem_init_pages(&sys->mem, sets->p0200[ramwr], 0x0200, rd + 0x0200, wr + 0x0200);
+        mem_init_pages(&sys->mem, sets->text[ramwr], 0x0400, rd + 0x0400, wr + 0x0400);
+        mem_init_pages(&sys->mem, sets->p0800[ramwr], 0x1800, rd + 0x0800, wr + 0x0800);
+        mem_init_pages(&sys->mem, sets->hires[ramwr], 0x2000, rd + 0x2000, wr + 0x2000);
+        mem_init_pages(&sys->mem, sets->p4000[ramwr], 0x8000, rd + 0x4000, wr + 0x4000);
+    }
+    for (int lc = 0; lc < 16; lc++) {
+        uint8_t *ram_ptr = (lc & 1) ? sys->aux_ram : sys->ram;
+        uint8_t *bank_ptr = ram_ptr + ((lc & 2) ? 0xD000 : 0xC000);
+        bool lcram = lc & 4;
+        bool write_enabled = lc & 8;
+        mem_page_t *pages = sets->lc[lc];
+        // Bank 1 or 2 at $D000, RAM or ROM reads, RAM or junk page writes
+        mem_init_pages(&sys->mem, pages, 0x1000, lcram ? bank_ptr : sys->rom + 0x1000, write_enabled ? bank_ptr : 0);
+        mem_init_pages(&sys->mem, &pages[0x1000 >> MEM_PAGE_SHIFT], 0x2000,
+                       lcram ? ram_ptr + 0xE000 : sys->rom + 0x2000, write_enabled ? ram_ptr + 0xE000 : 0);
+    }
+}
+
 static void _apple2e_init_memorymap(apple2e_t *sys) {
     mem_init(&sys->mem);
     for (int addr = 0; addr < 0x10000; addr += 2) {
@@ -973,93 +1519,216 @@ static void _apple2e_init_memorymap(apple2e_t *sys) {
         sys->aux_ram[addr + 1] = 0xFF;
     }
 
-    memcpy(mem_bank_0000,
-           (mem_bank_t[]){
-               {sys->ram, sys->ram},
-               {sys->aux_ram, sys->aux_ram},
-           },
-           sizeof(mem_bank_0000));
-
-    memcpy(mem_bank_0200,
-           (mem_bank_t[]){
-               {sys->ram + 0x200, sys->ram + 0x200},
-               {sys->aux_ram + 0x200, sys->ram + 0x200},
-               {sys->ram + 0x200, sys->aux_ram + 0x200},
-               {sys->aux_ram + 0x200, sys->aux_ram + 0x200},
-           },
-           sizeof(mem_bank_0200));
-
-    memcpy(mem_bank_0400,
-           (mem_bank_t[]){
-               {sys->ram + 0x400, sys->ram + 0x400},
-               {sys->aux_ram + 0x400, sys->ram + 0x400},
-               {sys->ram + 0x400, sys->aux_ram + 0x400},
-               {sys->aux_ram + 0x400, sys->aux_ram + 0x400},
-           },
-           sizeof(mem_bank_0400));
-
-    memcpy(mem_bank_0800,
-           (mem_bank_t[]){
-               {sys->ram + 0x800, sys->ram + 0x800},
-               {sys->aux_ram + 0x800, sys->ram + 0x800},
-               {sys->ram + 0x800, sys->aux_ram + 0x800},
-               {sys->aux_ram + 0x800, sys->aux_ram + 0x800},
-           },
-           sizeof(mem_bank_0800));
-
-    memcpy(mem_bank_2000,
-           (mem_bank_t[]){
-               {sys->ram + 0x2000, sys->ram + 0x2000},
-               {sys->aux_ram + 0x2000, sys->ram + 0x2000},
-               {sys->ram + 0x2000, sys->aux_ram + 0x2000},
-               {sys->aux_ram + 0x2000, sys->aux_ram + 0x2000},
-           },
-           sizeof(mem_bank_2000));
-
-    memcpy(mem_bank_4000,
-           (mem_bank_t[]){
-               {sys->ram + 0x4000, sys->ram + 0x4000},
-               {sys->aux_ram + 0x4000, sys->ram + 0x4000},
-               {sys->ram + 0x4000, sys->aux_ram + 0x4000},
-               {sys->aux_ram + 0x4000, sys->aux_ram + 0x4000},
-           },
-           sizeof(mem_bank_4000));
+    _apple2e_init_page_sets(sys);
 
     mem_map_ram(&sys->mem, 0, 0x0000, 0xC000, sys->ram);
     mem_map_rom(&sys->mem, 0, 0xC000, 0x1000, sys->rom);
     mem_map_rw(&sys->mem, 0, 0xD000, 0x1000, sys->rom + 0x1000, sys->ram + 0xD000);
     mem_map_rw(&sys->mem, 0, 0xE000, 0x2000, sys->rom + 0x2000, sys->ram + 0xE000);
 
+    // Only the I/O page, the slot ROMs with special handling and writes to
+    // video memory (for the dirty flags) take the slow path in _apple2e_mem_rw(),
+    // all other $C100-$CFFF accesses are plain ROM reads and junk page writes
+    mem_add_trap(&sys->mem, 0xC000, 0x100, MEM_TRAP_READ | MEM_TRAP_WRITE);
+    mem_add_trap(&sys->mem, 0xC300, 0x100, MEM_TRAP_READ);
+    mem_add_trap(&sys->mem, 0xC600, 0x200, MEM_TRAP_READ);
+    mem_add_trap(&sys->mem, 0x0400, 0x800, MEM_TRAP_WRITE);
+    mem_add_trap(&sys->mem, 0x2000, 0x4000, MEM_TRAP_WRITE);
+
     sys->lcbnk2 = true;
     sys->lcram = false;
     sys->prewrite = false;
     sys->write_enabled = true;
 }
 
-uint32_t apple2e_save_snapshot(apple2e_t *sys, apple2e_t *dst) {
-    CHIPS_ASSERT(sys && dst);
-    *dst = *sys;
+#define _APPLE2E_FIELD_END(field) (offsetof(apple2e_t, field) + sizeof(((apple2e_t *)0)->field))
+#if !defined(APPLE2E_NO_PAGE_CACHE)
+#define _APPLE2E_DELTA_RENDER_BEGIN offsetof(apple2e_t, page_fb)
+#elif !defined(APPLE2E_NO_FRAMEBUFFER)
+#define _APPLE2E_DELTA_RENDER_BEGIN offsetof(apple2e_t, fb)
+#else
+#define _APPLE2E_DELTA_RENDER_BEGIN offsetof(apple2e_t, surface)
+#endif
+
+// Byte ranges of apple2e_t in delta snapshots and rewind captures: everything but RAM, which they
+// handle separately, and what is rebuilt after loading (bank page sets, rendered pages and glyph rows)
+static const struct {
+    uint32_t begin, end;
+} _apple2e_delta_state[] = {
+    {0, offsetof(apple2e_t, ram)},
+    {_APPLE2E_FIELD_END(aux_ram), offsetof(apple2e_t, page_sets)},
+    {_APPLE2E_FIELD_END(page_sets), _APPLE2E_DELTA_RENDER_BEGIN},
+    {offsetof(apple2e_t, surface), offsetof(apple2e_t, glyphs)},
+    {_APPLE2E_FIELD_END(glyphs), sizeof(apple2e_t)},
+};
+#define _APPLE2E_DELTA_NUM_STATE (sizeof(_apple2e_delta_state) / sizeof(_apple2e_delta_state[0]))
+
+// Forget what was derived from the memory before a snapshot was restored: the rendered screen and decoded blocks
+static void _apple2e_snapshot_onrestore(apple2e_t *sys) {
+    memset(sys->screen_mode, 0xFF, sizeof(sys->screen_mode));
+    memset(sys->surface_page, 0xFF, sizeof(sys->surface_page));
+#ifdef MOS6502CPU_EXEC_CACHED
+    if (sys->block_cache) {
+        mos6502cpu_block_cache_init((mos6502cpu_block_cache_t *)sys->block_cache);
+    }
+#endif
+}
+
+// Patch the pointers of a copy of base to zero or offsets
+static void _apple2e_snapshot_onsave(apple2e_t *dst, const apple2e_t *base) {
     chips_debug_snapshot_onsave(&dst->debug);
     chips_audio_callback_snapshot_onsave(&dst->audio_callback);
     // m6502_snapshot_onsave(&dst->cpu);
     disk2_fdc_snapshot_onsave(&dst->fdc);
-    mem_snapshot_onsave(&dst->mem, sys);
+    mem_snapshot_onsave(&dst->mem, (void *)base);
+    memset(&dst->page_sets, 0, sizeof(dst->page_sets));
+    dst->block_cache = 0;
+    dst->glyph_rom = 0;
+    dst->surface.ptr = 0;
+}
+
+uint32_t apple2e_save_snapshot(apple2e_t *sys, apple2e_t *dst) {
+    CHIPS_ASSERT(sys && dst);
+#ifdef MEM_WRITE_WATCH
+    // The next delta snapshot starts from here
+    mem_clear_written(&sys->mem, 0, MEM_ADDR_RANGE);
+#endif
+    *dst = *sys;
+    _apple2e_snapshot_onsave(dst, sys);
     return APPLE2E_SNAPSHOT_VERSION;
 }
 
+#ifdef MEM_WRITE_WATCH
+uint32_t apple2e_save_delta(apple2e_t *sys, void *buf, uint32_t buf_size) {
+    CHIPS_ASSERT(sys && sys->valid && buf);
+    apple2e_delta_t *delta = (apple2e_delta_t *)buf;
+    if (buf_size < sizeof(apple2e_delta_t)) {
+        return 0;
+    }
+    // A write to a CPU chunk lands in main or aux RAM, in $D000-$DFFF also in language card bank 1 at $C000
+    memset(delta->chunks, 0, sizeof(delta->chunks));
+    uint32_t size = sizeof(apple2e_delta_t);
+    for (uint32_t i = 0; i < _APPLE2E_DELTA_NUM_STATE; i++) {
+        size += _apple2e_delta_state[i].end - _apple2e_delta_state[i].begin;
+    }
+    for (int chunk = mem_next_written(&sys->mem, 0); chunk >= 0; chunk = mem_next_written(&sys->mem, chunk + 1)) {
+        delta->chunks[chunk >> 5] |= 1U << (chunk & 31);
+        if ((chunk >= (0xD000 >> MEM_WRITE_WATCH_SHIFT)) && (chunk < (0xE000 >> MEM_WRITE_WATCH_SHIFT))) {
+            const int bank1 = chunk - (0x1000 >> MEM_WRITE_WATCH_SHIFT);
+            delta->chunks[bank1 >> 5] |= 1U << (bank1 & 31);
+        }
+    }
+    for (uint32_t i = 0; i < MEM_WRITE_WATCH_WORDS; i++) {
+        for (uint32_t bits = delta->chunks[i]; bits; bits &= bits - 1) {
+            size += 2 * APPLE2E_DELTA_CHUNK_SIZE;
+        }
+    }
+    if (size > buf_size) {
+        return 0;
+    }
+
+    // Cleared before the state is copied, applying the delta leaves the snapshot with a clean bitmap
+    mem_clear_written(&sys->mem, 0, MEM_ADDR_RANGE);
+    delta->version = APPLE2E_SNAPSHOT_VERSION;
+    delta->size = size;
+    delta->base = sys;
+    uint8_t *ptr = (uint8_t *)buf + sizeof(apple2e_delta_t);
+    for (uint32_t i = 0; i < _APPLE2E_DELTA_NUM_STATE; i++) {
+        const uint32_t begin = _apple2e_delta_state[i].begin;
+        const uint32_t end = _apple2e_delta_state[i].end;
+        memcpy(ptr, (uint8_t *)sys + begin, end - begin);
+        ptr += end - begin;
+    }
+    for (uint32_t chunk = 0; chunk < MEM_WRITE_WATCH_CHUNKS; chunk++) {
+        if (delta->chunks[chunk >> 5] & (1U << (chunk & 31))) {
+            const uint32_t addr = chunk << MEM_WRITE_WATCH_SHIFT;
+            memcpy(ptr, &sys->ram[addr], APPLE2E_DELTA_CHUNK_SIZE);
+            memcpy(ptr + APPLE2E_DELTA_CHUNK_SIZE, &sys->aux_ram[addr], APPLE2E_DELTA_CHUNK_SIZE);
+            ptr += 2 * APPLE2E_DELTA_CHUNK_SIZE;
+        }
+    }
+    CHIPS_ASSERT(ptr == (uint8_t *)buf + size);
+    return size;
+}
+
+bool apple2e_apply_delta(apple2e_t *snapshot, const void *buf, uint32_t size) {
+    CHIPS_ASSERT(snapshot && buf);
+    const apple2e_delta_t *delta = (const apple2e_delta_t *)buf;
+    if ((size < sizeof(apple2e_delta_t)) || (delta->version != APPLE2E_SNAPSHOT_VERSION) || (delta->size != size)) {
+        return false;
+    }
+    const uint8_t *ptr = (const uint8_t *)buf + sizeof(apple2e_delta_t);
+    for (uint32_t i = 0; i < _APPLE2E_DELTA_NUM_STATE; i++) {
+        const uint32_t begin = _apple2e_delta_state[i].begin;
+        const uint32_t end = _apple2e_delta_state[i].end;
+        memcpy((uint8_t *)snapshot + begin, ptr, end - begin);
+        ptr += end - begin;
+    }
+    _apple2e_snapshot_onsave(snapshot, (const apple2e_t *)delta->base);
+    for (uint32_t chunk = 0; chunk < MEM_WRITE_WATCH_CHUNKS; chunk++) {
+        if (delta->chunks[chunk >> 5] & (1U << (chunk & 31))) {
+            const uint32_t addr = chunk << MEM_WRITE_WATCH_SHIFT;
+            memcpy(&snapshot->ram[addr], ptr, APPLE2E_DELTA_CHUNK_SIZE);
+            memcpy(&snapshot->aux_ram[addr], ptr + APPLE2E_DELTA_CHUNK_SIZE, APPLE2E_DELTA_CHUNK_SIZE);
+            ptr += 2 * APPLE2E_DELTA_CHUNK_SIZE;
+        }
+    }
+    return ptr == (const uint8_t *)buf + size;
+}
+#endif  // MEM_WRITE_WATCH
+
 bool apple2e_load_snapshot(apple2e_t *sys, uint32_t version, apple2e_t *src) {
     CHIPS_ASSERT(sys && src);
     if (version != APPLE2E_SNAPSHOT_VERSION) {
         return false;
     }
-    static apple2e_t im;
-    im = *src;
-    chips_debug_snapshot_onload(&im.debug, &sys->debug);
-    chips_audio_callback_snapshot_onload(&im.audio_callback, &sys->audio_callback);
-    // m6502_snapshot_onload(&im.cpu, &sys->cpu);
-    disk2_fdc_snapshot_onload(&im.fdc, &sys->fdc);
-    mem_snapshot_onload(&im.mem, sys);
-    *sys = im;
+    // The snapshot is copied straight over sys, keep what the fixups take from the caller's instance
+    chips_debug_t debug = sys->debug;
+    chips_audio_callback_t audio_callback = sys->audio_callback;
+    disk2_fdc_t fdc = sys->fdc;
+    void *block_cache = sys->block_cache;
+    const apple2e_surface_t surface = sys->surface;
+    uint8_t *rom = sys->rom, *character_rom = sys->character_rom, *keyboard_rom = sys->keyboard_rom;
+    uint8_t *fdc_rom = sys->fdc_rom, *hdc_rom = sys->hdc_rom;
+#ifdef MEM_WRITE_HOOK
+    // Keep the write hook and show it the RAM chunks the snapshot changes
+    const mem_write_hook_t write_hook = sys->mem.write_hook;
+    void *write_hook_user_data = sys->mem.write_hook_user_data;
+    if (write_hook) {
+        for (uint32_t offset = 0; offset < sizeof(sys->ram); offset += 1U << MEM_WRITE_WATCH_SHIFT) {
+            if (memcmp(&sys->ram[offset], &src->ram[offset], 1U << MEM_WRITE_WATCH_SHIFT)) {
+                write_hook(&sys->ram[offset], write_hook_user_data);
+            }
+            if (memcmp(&sys->aux_ram[offset], &src->aux_ram[offset], 1U << MEM_WRITE_WATCH_SHIFT)) {
+                write_hook(&sys->aux_ram[offset], write_hook_user_data);
+            }
+        }
+    }
+#endif
+    *sys = *src;
+    chips_debug_snapshot_onload(&sys->debug, &debug);
+    chips_audio_callback_snapshot_onload(&sys->audio_callback, &audio_callback);
+    // m6502_snapshot_onload(&sys->cpu, &cpu);
+    disk2_fdc_snapshot_onload(&sys->fdc, &fdc);
+    mem_snapshot_onload(&sys->mem, sys);
+    // Keep the caller's block cache, its blocks were decoded from the old memory
+    sys->block_cache = block_cache;
+    // Keep the caller's surface and draw the loaded screen into it
+    sys->surface = surface;
+    // Keep the caller's ROM images, the snapshot's ROM pages only point into them for the instance it was
+    // taken of: rebuild the page sets from them and map $C000-$FFFF again
+    sys->rom = rom;
+    sys->character_rom = character_rom;
+    sys->keyboard_rom = keyboard_rom;
+    sys->fdc_rom = fdc_rom;
+    sys->hdc_rom = hdc_rom;
+    _apple2e_init_page_sets(sys);
+    mem_map_rom(&sys->mem, 0, 0xC000, 0x1000, sys->rom);
+    _apple2e_lc_bank_update(sys);
+    _apple2e_snapshot_onrestore(sys);
+#ifdef MEM_WRITE_HOOK
+    mem_set_write_hook(&sys->mem, write_hook, write_hook_user_data);
+#endif
     return true;
 }
 
@@ -1081,6 +1750,10 @@ static void _apple2e_render_line_monochrome(uint8_t *out, uint16_t *in, int star
     }
 }
 
+// Each pixel's color comes from a 7-bit window (3 bits either side) and its
+// phase in the 4-pixel color cycle. Output byte pairs start at a multiple of
+// 4 pixels within a column, so a column of 14 pixels is 4 lookups with the
+// column's start phase into _apple2e_color_pair_lut (the last one is half used)
 static void _apple2e_render_line_color(uint8_t *out, uint16_t *in, int start_col, int stop_col, bool is_80col) {
     uint32_t w = in[start_col] << 3;
 
@@ -1089,24 +1762,31 @@ static void _apple2e_render_line_color(uint8_t *out, uint16_t *in, int start_col
             w += in[col + 1] << 17;
         }
 
-        for (int b = 0; b < 7; b++) {
-            uint8_t c1 = _apple2e_rotl4b(_apple2e_artifact_color_lut[w & 0x7F], col * 14 + b * 2 + is_80col);
-            w >>= 1;
-            uint8_t c2 = _apple2e_rotl4b(_apple2e_artifact_color_lut[w & 0x7F], col * 14 + b * 2 + 1 + is_80col);
-            w >>= 1;
-            out[col * 7 + b] = (c1 << 4) | (c2 & 0x0F);
-        }
+        const uint16_t *lut = _apple2e_color_pair_lut[(col * 14 + is_80col) & 3];
+        uint8_t *p = &out[col * 7];
+        uint16_t pair = lut[w & 0x3FF];
+        p[0] = pair;
+        p[1] = pair >> 8;
+        pair = lut[(w >> 4) & 0x3FF];
+        p[2] = pair;
+        p[3] = pair >> 8;
+        pair = lut[(w >> 8) & 0x3FF];
+        p[4] = pair;
+        p[5] = pair >> 8;
+        p[6] = lut[(w >> 12) & 0x3FF];
+        w >>= 14;
     }
 }
 
-static uint8_t _apple2e_get_text_character(apple2e_t *sys, uint8_t code, uint16_t row) {
+static uint8_t _apple2e_get_text_character(const uint8_t *character_rom, uint8_t code, uint16_t row, bool altcharset,
+                                           bool flash) {
     uint8_t invert_mask = 0x7F;
 
-    if (!sys->altcharset) {
+    if (!altcharset) {
         if ((code >= 0x40) && (code <= 0x7f)) {
             code &= 0x3f;
 
-            if (sys->flash) {
+            if (flash) {
                 invert_mask ^= 0x7F;
             }
         }
@@ -1118,35 +1798,116 @@ static uint8_t _apple2e_get_text_character(apple2e_t *sys, uint8_t code, uint16_
     }
 
     /* look up the character data */
-    uint8_t bits = sys->character_rom[code * 8 + row];
+    uint8_t bits = character_rom[code * 8 + row];
     bits = bits & 0x7F;
     bits ^= invert_mask;
     return bits;
 }
 
-static uint8_t *_apple2e_get_fb_addr(apple2e_t *sys, uint16_t row) {
+// Rebuild the glyph rows after the character ROM changed
+static void _apple2e_update_glyphs(apple2e_t *sys) {
+    for (int mode = 0; mode < 4; mode++) {
+        for (int code = 0; code < 256; code++) {
+            for (int row = 0; row < 8; row++) {
+                sys->glyphs[mode][code][row] =
+                    _apple2e_get_text_character(sys->character_rom, code, row, mode & 2, mode & 1);
+            }
+        }
+    }
+    sys->glyph_rom = sys->character_rom;
+}
+
+#ifndef APPLE2E_NO_FRAMEBUFFER
+static inline uint8_t *_apple2e_get_fb_addr(apple2e_t *sys, uint16_t row) {
     return &sys->fb[row * (APPLE2E_SCREEN_WIDTH / 2)];
 }
+#endif
 
-static void _apple2e_lores_update(apple2e_t *sys, uint16_t begin_row, uint16_t end_row) {
-    if ((!sys->page2 && !sys->text_page1_dirty) || (sys->page2 && !sys->text_page2_dirty)) {
-        return;
+static inline uint8_t *_apple2e_get_surface_addr(apple2e_t *sys, uint16_t row) {
+    return (uint8_t *)sys->surface.ptr + row * sys->surface.stride;
+}
+
+// Displayed page, 80STORE makes PAGE2 select auxiliary memory instead
+static inline int _apple2e_display_page(apple2e_t *sys) { return (sys->page2 && !sys->_80store) ? 1 : 0; }
+
+#ifndef APPLE2E_NO_PAGE_CACHE
+// Where to render a 4bpp row: into the cached copy of the displayed page
+static inline uint8_t *_apple2e_get_line_addr(apple2e_t *sys, uint16_t row, uint8_t *line) {
+    (void)line;
+    return &sys->page_fb[_apple2e_display_page(sys)][row * (APPLE2E_SCREEN_WIDTH / 2)];
+}
+#else
+// Where to render a 4bpp row: straight into a 4bpp surface, or into the
+// caller's line buffer for _apple2e_line_done() to convert
+static inline uint8_t *_apple2e_get_line_addr(apple2e_t *sys, uint16_t row, uint8_t *line) {
+    return (sys->surface.format == APPLE2E_SURFACE_4BPP) ? _apple2e_get_surface_addr(sys, row) : line;
+}
+#endif
+
+// Put a rendered 4bpp row of the displayed page into the surface
+static void _apple2e_line_done(apple2e_t *sys, uint16_t row, const uint8_t *line) {
+    sys->surface_page[row] = _apple2e_display_page(sys);
+#ifndef APPLE2E_NO_FRAME_HASH
+    sys->row_hash[row] = chips_hash64(line, APPLE2E_SCREEN_WIDTH / 2, 0);
+#endif
+    uint8_t *dst = _apple2e_get_surface_addr(sys, row);
+    switch (sys->surface.format) {
+        case APPLE2E_SURFACE_4BPP:
+            if (dst != line) {
+                memcpy(dst, line, APPLE2E_SCREEN_WIDTH / 2);
+            }
+            break;
+        case APPLE2E_SURFACE_RGB232:
+            for (int i = 0; i < APPLE2E_SCREEN_WIDTH / 2; i++) {
+                memcpy(&dst[i * 2], _apple2e_rgb232_lut[line[i]], 2);
+            }
+            break;
+        case APPLE2E_SURFACE_RGB565:
+            for (int i = 0; i < APPLE2E_SCREEN_WIDTH / 2; i++) {
+                memcpy(&dst[i * 4], _apple2e_rgb565_lut[line[i]], 4);
+            }
+            break;
+        case APPLE2E_SURFACE_RGBA8888:
+            for (int i = 0; i < APPLE2E_SCREEN_WIDTH / 2; i++) {
+                memcpy(&dst[i * 8], _apple2e_rgba8888_lut[line[i]], 8);
+            }
+            break;
     }
+}
 
-    bool _double = sys->dhires && sys->_80col;
+static inline bool _apple2e_row_dirty(const uint32_t *dirty, int row) { return dirty[row >> 5] & (1U << (row & 31)); }
 
-    uint16_t start_address = sys->page2 && !sys->_80store ? 0x0800 : 0x0400;
+// Clear the dirty bits of rows begin_row to end_row (inclusive)
+static void _apple2e_clear_dirty(uint32_t *dirty, int begin_row, int end_row) {
+    for (int row = begin_row; row <= end_row; row++) {
+        dirty[row >> 5] &= ~(1U << (row & 31));
+    }
+}
+
+static uint8_t _apple2e_screen_mode(apple2e_t *sys) {
+    return (sys->text ? 0x01 : 0) | (sys->mixed ? 0x02 : 0) | (sys->hires ? 0x04 : 0) | (sys->dhires ? 0x08 : 0) |
+           (sys->_80col ? 0x10 : 0) | (sys->altcharset ? 0x20 : 0);
+}
+
+static void _apple2e_lores_update(apple2e_t *sys, uint16_t begin_row, uint16_t end_row) {
+    bool _double = sys->dhires && sys->_80col;
 
-    uint16_t start_row = (begin_row / 8) * 8;
-    uint16_t stop_row = ((end_row / 8) + 1) * 8;
+    int page = _apple2e_display_page(sys);
+    uint16_t start_address = page ? 0x0800 : 0x0400;
+    uint32_t *dirty = sys->text_dirty[page];
 
-    for (int row = start_row; row < stop_row; row += 4) {
+    for (int row = begin_row; row <= end_row; row++) {
+        if (!_apple2e_row_dirty(dirty, row)) {
+            continue;
+        }
         uint16_t address = start_address + ((((row / 8) & 0x07) << 7) | (((row / 8) & 0x18) * 5));
         uint8_t *vram_row = &sys->ram[address];
         uint8_t *vaux_row = &sys->aux_ram[address];
 
 #define NIBBLE(byte) (((byte) >> (row & 4)) & 0x0F)
-        uint8_t *p = _apple2e_get_fb_addr(sys, row);
+        uint8_t line[APPLE2E_SCREEN_WIDTH / 2];
+        uint8_t *line_addr = _apple2e_get_line_addr(sys, row, line);
+        uint8_t *p = line_addr;
 
         for (int col = 0; col < 40; col++) {
             uint8_t c;
@@ -1173,62 +1934,77 @@ static void _apple2e_lores_update(apple2e_t *sys, uint16_t begin_row, uint16_t e
         }
 #undef NIBBLE
 
-        for (int y = 1; y < 4; y++) {
-            memcpy(_apple2e_get_fb_addr(sys, row + y), _apple2e_get_fb_addr(sys, row), 40 * 7);
+        _apple2e_line_done(sys, row, line_addr);
+        // A lores block is 4 scanlines high, the rest of it in range shows the same pixels
+        while (((row + 1) & 3) && (row < end_row)) {
+            row++;
+            uint8_t *dst = _apple2e_get_line_addr(sys, row, line);
+            if (dst != line_addr) {
+                memcpy(dst, line_addr, APPLE2E_SCREEN_WIDTH / 2);
+            }
+            _apple2e_line_done(sys, row, dst);
         }
     }
 
-    if (!sys->page2) {
-        sys->text_page1_dirty = false;
-    } else {
-        sys->text_page2_dirty = false;
-    }
+    _apple2e_clear_dirty(dirty, begin_row, end_row);
 }
 
 static void _apple2e_text_update(apple2e_t *sys, uint16_t begin_row, uint16_t end_row) {
-    if ((!sys->page2 && !sys->text_page1_dirty) || (sys->page2 && !sys->text_page2_dirty)) {
-        return;
+    if (sys->glyph_rom != sys->character_rom) {
+        _apple2e_update_glyphs(sys);
     }
+    const uint8_t(*glyphs)[8] = sys->glyphs[(sys->altcharset ? 2 : 0) | (sys->flash ? 1 : 0)];
 
-    uint16_t start_address = sys->page2 && !sys->_80store ? 0x0800 : 0x0400;
-
-    uint16_t start_row = (begin_row / 8) * 8;
-    uint16_t stop_row = ((end_row / 8) + 1) * 8;
+    int page = _apple2e_display_page(sys);
+    uint16_t start_address = page ? 0x0800 : 0x0400;
+    uint32_t *dirty = sys->text_dirty[page];
 
-    for (int row = start_row; row < stop_row; row++) {
+    for (int row = begin_row; row <= end_row; row++) {
+        if (!_apple2e_row_dirty(dirty, row)) {
+            continue;
+        }
         uint16_t address = start_address + ((((row / 8) & 0x07) << 7) | (((row / 8) & 0x18) * 5));
         uint8_t *vram_row = &sys->ram[address];
         uint8_t *vaux_row = &sys->aux_ram[address];
 
-        uint16_t words[40];
-
-        for (int col = 0; col < 40; col++) {
-            if (sys->_80col) {
-                words[col] = _apple2e_get_text_character(sys, vaux_row[col], row & 7) +
-                             (_apple2e_get_text_character(sys, vram_row[col], row & 7) << 7);
-            } else {
-                words[col] = _apple2e_double_7_bits(_apple2e_get_text_character(sys, vram_row[col], row & 7));
+        uint8_t line[APPLE2E_SCREEN_WIDTH / 2];
+        uint8_t *line_addr = _apple2e_get_line_addr(sys, row, line);
+        uint8_t *p = line_addr;
+
+        if (sys->_80col) {
+            for (int col = 0; col < 40; col++) {
+                const uint8_t *aux_out = _apple2e_text80_lut[0][glyphs[vaux_row[col]][row & 7]];
+                const uint8_t *main_out = _apple2e_text80_lut[1][glyphs[vram_row[col]][row & 7]];
+                p[0] = aux_out[0];
+                p[1] = aux_out[1];
+                p[2] = aux_out[2];
+                p[3] = aux_out[3] | main_out[0];
+                p[4] = main_out[1];
+                p[5] = main_out[2];
+                p[6] = main_out[3];
+                p += 7;
+            }
+        } else {
+            for (int col = 0; col < 40; col++) {
+                memcpy(p, _apple2e_text40_lut[glyphs[vram_row[col]][row & 7]], 7);
+                p += 7;
             }
         }
-
-        _apple2e_render_line_monochrome(_apple2e_get_fb_addr(sys, row), words, 0, 40);
+        _apple2e_line_done(sys, row, line_addr);
     }
 
-    if (!sys->page2) {
-        sys->text_page1_dirty = false;
-    } else {
-        sys->text_page2_dirty = false;
-    }
+    _apple2e_clear_dirty(dirty, begin_row, end_row);
 }
 
 static void _apple2e_dhgr_update(apple2e_t *sys, uint16_t begin_row, uint16_t end_row) {
-    if ((!sys->page2 && !sys->hires_page1_dirty) || (sys->page2 && !sys->hires_page2_dirty)) {
-        return;
-    }
-
-    uint16_t start_address = sys->page2 && !sys->_80store ? 0x4000 : 0x2000;
+    int page = _apple2e_display_page(sys);
+    uint16_t start_address = page ? 0x4000 : 0x2000;
+    uint32_t *dirty = sys->hires_dirty[page];
 
     for (int row = begin_row; row <= end_row; row++) {
+        if (!_apple2e_row_dirty(dirty, row)) {
+            continue;
+        }
         uint32_t address = start_address + (((row / 8) & 0x07) << 7) + (((row / 8) & 0x18) * 5) + ((row & 7) << 10);
         uint8_t *vram_row = &sys->ram[address];
         uint8_t *vaux_row = &sys->aux_ram[address];
@@ -1239,24 +2015,24 @@ static void _apple2e_dhgr_update(apple2e_t *sys, uint16_t begin_row, uint16_t en
             words[col] = ((vaux_row[col] & 0x7F) | ((vram_row[col] & 0x7F) << 7)) & 0x3FFF;
         }
 
-        _apple2e_render_line_color(_apple2e_get_fb_addr(sys, row), words, 0, 40, true);
+        uint8_t line[APPLE2E_SCREEN_WIDTH / 2];
+        uint8_t *line_addr = _apple2e_get_line_addr(sys, row, line);
+        _apple2e_render_line_color(line_addr, words, 0, 40, true);
+        _apple2e_line_done(sys, row, line_addr);
     }
 
-    if (!sys->page2) {
-        sys->hires_page1_dirty = false;
-    } else {
-        sys->hires_page2_dirty = false;
-    }
+    _apple2e_clear_dirty(dirty, begin_row, end_row);
 }
 
 static void _apple2e_hgr_update(apple2e_t *sys, uint16_t begin_row, uint16_t end_row) {
-    if ((!sys->page2 && !sys->hires_page1_dirty) || (sys->page2 && !sys->hires_page2_dirty)) {
-        return;
-    }
-
-    uint16_t start_address = sys->page2 && !sys->_80store ? 0x4000 : 0x2000;
+    int page = _apple2e_display_page(sys);
+    uint16_t start_address = page ? 0x4000 : 0x2000;
+    uint32_t *dirty = sys->hires_dirty[page];
 
     for (int row = begin_row; row <= end_row; row++) {
+        if (!_apple2e_row_dirty(dirty, row)) {
+            continue;
+        }
         uint32_t address = start_address + (((row / 8) & 0x07) << 7) + (((row / 8) & 0x18) * 5) + ((row & 7) << 10);
         uint8_t *vram_row = &sys->ram[address];
 
@@ -1273,36 +2049,147 @@ static void _apple2e_hgr_update(apple2e_t *sys, uint16_t begin_row, uint16_t end
             last_output_bit = w >> 13;
         }
 
-        _apple2e_render_line_color(_apple2e_get_fb_addr(sys, row), words, 0, 40, false);
+        uint8_t line[APPLE2E_SCREEN_WIDTH / 2];
+        uint8_t *line_addr = _apple2e_get_line_addr(sys, row, line);
+        _apple2e_render_line_color(line_addr, words, 0, 40, false);
+        _apple2e_line_done(sys, row, line_addr);
     }
 
-    if (!sys->page2) {
-        sys->hires_page1_dirty = false;
-    } else {
-        sys->hires_page2_dirty = false;
-    }
+    _apple2e_clear_dirty(dirty, begin_row, end_row);
 }
 
-void apple2e_screen_update(apple2e_t *sys) {
-    uint16_t text_start_row = 0;
+// Render rows begin_row to end_row of the displayed page in the current video mode
+static void _apple2e_update_rows(apple2e_t *sys, uint16_t begin_row, uint16_t end_row) {
+    uint8_t screen_mode = _apple2e_screen_mode(sys);
+    int page = _apple2e_display_page(sys);
+#ifndef APPLE2E_NO_PAGE_CACHE
+    // Mode switches redraw the displayed page, otherwise only its dirty scanlines, the
+    // other page keeps collecting dirty scanlines until it is displayed again
+    if (screen_mode != sys->screen_mode[page]) {
+        sys->screen_mode[page] = screen_mode;
+        memset(sys->text_dirty[page], 0xFF, sizeof(sys->text_dirty[page]));
+        memset(sys->hires_dirty[page], 0xFF, sizeof(sys->hires_dirty[page]));
+    }
+#else
+    // Mode switches redraw everything, page switches the rows that show the other page
+    if (screen_mode != sys->screen_mode[0]) {
+        sys->screen_mode[0] = screen_mode;
+        memset(sys->text_dirty, 0xFF, sizeof(sys->text_dirty));
+        memset(sys->hires_dirty, 0xFF, sizeof(sys->hires_dirty));
+    }
+    for (int row = begin_row; row <= end_row; row++) {
+        if (sys->surface_page[row] != page) {
+            sys->text_dirty[page][row >> 5] |= 1U << (row & 31);
+            sys->hires_dirty[page][row >> 5] |= 1U << (row & 31);
+        }
+    }
+#endif
 
-    if (!sys->text) {
-        text_start_row = 192 - (sys->mixed ? 32 : 0);
+    uint16_t text_start_row = sys->text ? 0 : (sys->mixed ? 160 : 192);
 
+    if (begin_row < text_start_row) {
+        uint16_t graphics_end_row = (end_row < text_start_row) ? end_row : text_start_row - 1;
         if (sys->hires) {
             if (sys->dhires && sys->_80col) {
-                _apple2e_dhgr_update(sys, 0, text_start_row - 1);
+                _apple2e_dhgr_update(sys, begin_row, graphics_end_row);
             } else {
-                _apple2e_hgr_update(sys, 0, text_start_row - 1);
+                _apple2e_hgr_update(sys, begin_row, graphics_end_row);
             }
         } else {
-            _apple2e_lores_update(sys, 0, text_start_row - 1);
+            _apple2e_lores_update(sys, begin_row, graphics_end_row);
         }
     }
 
-    if (text_start_row < 192) {
-        _apple2e_text_update(sys, text_start_row, 191);
+    if (end_row >= text_start_row) {
+        _apple2e_text_update(sys, (begin_row > text_start_row) ? begin_row : text_start_row, end_row);
+    }
+
+#ifndef APPLE2E_NO_PAGE_CACHE
+    // Rows that still show the other page after a page flip present the cached copy
+    for (int row = begin_row; row <= end_row; row++) {
+        if (sys->surface_page[row] != page) {
+            _apple2e_line_done(sys, row, &sys->page_fb[page][row * (APPLE2E_SCREEN_WIDTH / 2)]);
+        }
+    }
+#endif
+}
+
+void apple2e_screen_update(apple2e_t *sys) {
+    if (!sys->surface.ptr) {
+        // No framebuffer and no surface yet
+        return;
+    }
+    // With scanline rendering the rows were rendered as the beam reached them
+    if (!sys->scanline_render) {
+        _apple2e_update_rows(sys, 0, APPLE2E_SCREEN_HEIGHT - 1);
+    }
+#ifndef APPLE2E_NO_FRAME_HASH
+    // Only rows that were put into the surface are hashed again, the frame hash combines all of them
+    sys->frame_hash = chips_hash64(sys->row_hash, sizeof(sys->row_hash), 0);
+#endif
+}
+
+#ifndef APPLE2E_NO_FRAME_HASH
+uint64_t apple2e_frame_hash(apple2e_t *sys) {
+    CHIPS_ASSERT(sys && sys->valid);
+    return sys->frame_hash;
+}
+#endif
+
+// Render the scanline the beam just reached with the soft switches as they are now
+static void _apple2e_scanline_event(apple2e_t *sys) {
+    if (sys->surface.ptr) {
+        _apple2e_update_rows(sys, sys->scanline, sys->scanline);
+    }
+    if (++sys->scanline < APPLE2E_SCREEN_HEIGHT) {
+        _apple2e_schedule_event_at(sys, APPLE2E_EVENT_SCANLINE,
+                                   sys->event_ticks[APPLE2E_EVENT_SCANLINE] + APPLE2E_SCANLINE_TICKS);
+    } else {
+        sys->scanline = 0;
+        _apple2e_schedule_event_at(sys, APPLE2E_EVENT_SCANLINE, sys->frame_start_ticks + APPLE2E_FRAME_TICKS);
+    }
+}
+
+void apple2e_set_scanline_render(apple2e_t *sys, bool enabled) {
+    CHIPS_ASSERT(sys && sys->valid);
+    if (enabled == sys->scanline_render) {
+        return;
+    }
+    sys->scanline_render = enabled;
+    if (!enabled) {
+        _apple2e_cancel_event(sys, APPLE2E_EVENT_SCANLINE);
+        return;
+    }
+    // Start with the next scanline the beam reaches, or the first one of the next frame
+    uint32_t line = (sys->system_ticks - sys->frame_start_ticks) / APPLE2E_SCANLINE_TICKS + 1;
+    if (line < APPLE2E_SCREEN_HEIGHT) {
+        sys->scanline = (uint8_t)line;
+        _apple2e_schedule_event_at(sys, APPLE2E_EVENT_SCANLINE,
+                                   sys->frame_start_ticks + line * APPLE2E_SCANLINE_TICKS);
+    } else {
+        sys->scanline = 0;
+        _apple2e_schedule_event_at(sys, APPLE2E_EVENT_SCANLINE, sys->frame_start_ticks + APPLE2E_FRAME_TICKS);
+    }
+}
+
+void apple2e_set_surface(apple2e_t *sys, const apple2e_surface_t *surface) {
+    CHIPS_ASSERT(sys && sys->valid);
+    if (surface && surface->ptr) {
+        CHIPS_ASSERT(surface->format <= APPLE2E_SURFACE_RGBA8888);
+        sys->surface = *surface;
+    } else {
+#ifndef APPLE2E_NO_FRAMEBUFFER
+        sys->surface = (apple2e_surface_t){
+            .ptr = sys->fb,
+            .stride = APPLE2E_SCREEN_WIDTH / 2,
+            .format = APPLE2E_SURFACE_4BPP,
+        };
+#else
+        sys->surface = (apple2e_surface_t){0};
+#endif
     }
+    memset(sys->screen_mode, 0xFF, sizeof(sys->screen_mode));
+    memset(sys->surface_page, 0xFF, sizeof(sys->surface_page));
 }
 
 #endif  // CHIPS_IMPL
@@ -0,0 +1,275 @@
+#pragma once
+
+// apple2e_input.h
+//
+// Input recording and replay for the Apple //e emulator in apple2e.h.
+//
+// Do this:
+// ~~~C
+// #define CHIPS_IMPL
+// ~~~
+// before you include this file in *one* C or C++ file to create the
+// implementation, the same one that has the apple2e.h implementation.
+//
+// Include systems/apple2e.h and its dependencies before including
+// apple2e_input.h.
+//
+// The recorder passes each input change to apple2e_input() and logs the ones
+// that changed something with the system_ticks they happened at into a
+// caller-supplied buffer. The stream is a 12 byte header (magic, version,
+// execution granularity and the system_ticks the recording started at)
+// followed by one event per change: a varint of the ticks since the previous
+// event shifted left by 4 with the APPLE2E_INPUT_* in the low bits, and the
+// value byte. A key press costs 2-4 bytes.
+//
+// The player runs the system like apple2e_exec_ticks() and stops it at the
+// system_ticks of each event to apply it, so the inputs arrive at exactly the
+// same cycle as when they were recorded and the run is the same bit for bit.
+// Replay has to start from the state the recording started from (the same
+// ROMs and disk images after apple2e_init(), or a snapshot taken then), and
+// with the same granularity: a recording made cycle-stepped (apple2e_tick()
+// or APPLE2E_EXEC_MODE_CYCLE) can have events between the ticks of an
+// instruction, which APPLE2E_EXEC_MODE_INSTRUCTION and _BLOCK_CACHE can't
+// stop at; those two stop at the same instruction boundaries and can replay
+// each other's recordings.
+//
+// ## zlib/libpng license
+//
+// Copyright (c) 2023 Veselin Sladkov
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//     1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software in a
+//     product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//     2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//     3. This notice may not be removed or altered from any source
+//     distribution.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bump the stream version when the event encoding changes
+#define APPLE2E_INPUT_STREAM_VERSION (1)
+#define APPLE2E_INPUT_HEADER_SIZE    (12)
+
+// Config parameters for apple2e_input_record_init() and apple2e_input_play_init()
+typedef struct {
+    chips_range_t stream;  // Buffer to record into, or the recorded bytes to replay (owned by the caller)
+} apple2e_input_desc_t;
+
+// Apple //e input recorder
+typedef struct {
+    apple2e_t *sys;
+    uint8_t *stream;
+    uint32_t size;
+    uint32_t pos;         // Bytes recorded, header included
+    uint32_t last_ticks;  // system_ticks of the previous event
+    uint32_t num_events;
+    bool overflow;  // An event didn't fit, the recording ends before it
+} apple2e_input_recorder_t;
+
+// Apple //e input player
+typedef struct {
+    apple2e_t *sys;
+    const uint8_t *stream;
+    uint32_t size;
+    uint32_t pos;  // Where the event after the pending one starts
+    // Next event to apply
+    bool pending;
+    uint32_t next_ticks;
+    uint8_t next_input;
+    uint8_t next_value;
+    uint32_t num_events;  // Events applied
+    uint32_t num_late;    // Events applied after their system_ticks, the run differs from the recording
+    bool error;           // The stream ends inside an event or has an unknown input
+} apple2e_input_player_t;
+
+// Apple //e input interface
+
+// Start recording the inputs of sys at its current system_ticks, returns false if the buffer is too small
+bool apple2e_input_record_init(apple2e_input_recorder_t *rec, apple2e_t *sys, const apple2e_input_desc_t *desc);
+// Apply an input change with apple2e_input() and log it if it changed something, returns false once the
+// buffer is full (the change is still applied)
+bool apple2e_input_record(apple2e_input_recorder_t *rec, uint8_t input, uint8_t value);
+// Start replaying a recording onto sys, returns false if it isn't one, starts at other system_ticks or has
+// another granularity than the current execution mode
+bool apple2e_input_play_init(apple2e_input_player_t *play, apple2e_t *sys, const apple2e_input_desc_t *desc);
+// Tick sys for at least num_ticks like apple2e_exec_ticks() and apply the recorded inputs that come due at
+// their system_ticks, return number of executed ticks
+uint32_t apple2e_input_play_exec_ticks(apple2e_input_player_t *play, uint32_t num_ticks);
+// Return true when all recorded inputs have been applied
+bool apple2e_input_play_done(apple2e_input_player_t *play);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+/*-- IMPLEMENTATION ----------------------------------------------------------*/
+#ifdef CHIPS_IMPL
+#include <string.h>
+#ifndef CHIPS_ASSERT
+#include <assert.h>
+#define CHIPS_ASSERT(c) assert(c)
+#endif
+
+static const uint8_t _apple2e_input_magic[4] = {'A', '2', 'E', 'I'};
+
+// 0 if the system stops after any tick, 1 if only at instruction boundaries
+static uint8_t _apple2e_input_granularity(apple2e_t *sys) {
+    return (sys->exec_mode == APPLE2E_EXEC_MODE_CYCLE) || sys->debug.callback.func ? 0 : 1;
+}
+
+static void _apple2e_input_put32(uint8_t *dst, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        dst[i] = (uint8_t)(value >> (i * 8));
+    }
+}
+
+static uint32_t _apple2e_input_get32(const uint8_t *src) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= (uint32_t)src[i] << (i * 8);
+    }
+    return value;
+}
+
+bool apple2e_input_record_init(apple2e_input_recorder_t *rec, apple2e_t *sys, const apple2e_input_desc_t *desc) {
+    CHIPS_ASSERT(rec && sys && sys->valid && desc && desc->stream.ptr);
+    memset(rec, 0, sizeof(apple2e_input_recorder_t));
+    if (desc->stream.size < APPLE2E_INPUT_HEADER_SIZE) {
+        return false;
+    }
+    rec->sys = sys;
+    rec->stream = (uint8_t *)desc->stream.ptr;
+    rec->size = (uint32_t)desc->stream.size;
+    rec->last_ticks = sys->system_ticks;
+    memcpy(rec->stream, _apple2e_input_magic, sizeof(_apple2e_input_magic));
+    rec->stream[4] = APPLE2E_INPUT_STREAM_VERSION;
+    rec->stream[5] = _apple2e_input_granularity(sys);
+    rec->stream[6] = 0;
+    rec->stream[7] = 0;
+    _apple2e_input_put32(&rec->stream[8], sys->system_ticks);
+    rec->pos = APPLE2E_INPUT_HEADER_SIZE;
+    return true;
+}
+
+bool apple2e_input_record(apple2e_input_recorder_t *rec, uint8_t input, uint8_t value) {
+    CHIPS_ASSERT(rec && rec->sys);
+    apple2e_t *sys = rec->sys;
+    if (!apple2e_input(sys, input, value) || rec->overflow) {
+        return !rec->overflow;
+    }
+    // Varint of the ticks since the previous event and the input, then the value
+    uint8_t event[12];
+    uint32_t size = 0;
+    uint64_t word = ((uint64_t)(sys->system_ticks - rec->last_ticks) << 4) | input;
+    while (word >= 0x80) {
+        event[size++] = (uint8_t)(word | 0x80);
+        word >>= 7;
+    }
+    event[size++] = (uint8_t)word;
+    event[size++] = value;
+    if (rec->pos + size > rec->size) {
+        rec->overflow = true;
+        return false;
+    }
+    memcpy(&rec->stream[rec->pos], event, size);
+    rec->pos += size;
+    rec->last_ticks = sys->system_ticks;
+    rec->num_events++;
+    return true;
+}
+
+// Decode the event at play->pos into the pending one
+static void _apple2e_input_next(apple2e_input_player_t *play) {
+    play->pending = false;
+    if (play->pos == play->size) {
+        return;
+    }
+    uint64_t word = 0;
+    for (int shift = 0;; shift += 7) {
+        if ((play->pos == play->size) || (shift > 35)) {
+            play->error = true;
+            return;
+        }
+        const uint8_t byte = play->stream[play->pos++];
+        word |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    if ((play->pos == play->size) || ((word & 0xF) >= APPLE2E_NUM_INPUTS)) {
+        play->error = true;
+        return;
+    }
+    play->next_ticks += (uint32_t)(word >> 4);
+    play->next_input = (uint8_t)(word & 0xF);
+    play->next_value = play->stream[play->pos++];
+    play->pending = true;
+}
+
+bool apple2e_input_play_init(apple2e_input_player_t *play, apple2e_t *sys, const apple2e_input_desc_t *desc) {
+    CHIPS_ASSERT(play && sys && sys->valid && desc && desc->stream.ptr);
+    memset(play, 0, sizeof(apple2e_input_player_t));
+    const uint8_t *stream = (const uint8_t *)desc->stream.ptr;
+    if ((desc->stream.size < APPLE2E_INPUT_HEADER_SIZE) ||
+        memcmp(stream, _apple2e_input_magic, sizeof(_apple2e_input_magic)) ||
+        (stream[4] != APPLE2E_INPUT_STREAM_VERSION) || (stream[5] != _apple2e_input_granularity(sys)) ||
+        (_apple2e_input_get32(&stream[8]) != sys->system_ticks)) {
+        return false;
+    }
+    play->sys = sys;
+    play->stream = stream;
+    play->size = (uint32_t)desc->stream.size;
+    play->pos = APPLE2E_INPUT_HEADER_SIZE;
+    play->next_ticks = sys->system_ticks;
+    _apple2e_input_next(play);
+    return true;
+}
+
+uint32_t apple2e_input_play_exec_ticks(apple2e_input_player_t *play, uint32_t num_ticks) {
+    CHIPS_ASSERT(play && play->sys);
+    apple2e_t *sys = play->sys;
+    uint32_t ticks = 0;
+    while (true) {
+        while (play->pending && ((int32_t)(play->next_ticks - sys->system_ticks) <= 0)) {
+            if (play->next_ticks != sys->system_ticks) {
+                play->num_late++;
+            }
+            apple2e_input(sys, play->next_input, play->next_value);
+            play->num_events++;
+            _apple2e_input_next(play);
+        }
+        if (ticks >= num_ticks) {
+            return ticks;
+        }
+        // Run up to the next event at most
+        uint32_t slice = num_ticks - ticks;
+        if (play->pending && (play->next_ticks - sys->system_ticks < slice)) {
+            slice = play->next_ticks - sys->system_ticks;
+        }
+        const uint32_t executed = apple2e_exec_ticks(sys, slice);
+        if (executed == 0) {
+            // Stopped by the debugger
+            return ticks;
+        }
+        ticks += executed;
+    }
+}
+
+bool apple2e_input_play_done(apple2e_input_player_t *play) {
+    CHIPS_ASSERT(play && play->sys);
+    return !play->pending;
+}
+
+#endif  // CHIPS_IMPL
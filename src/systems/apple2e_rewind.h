@@ -0,0 +1,539 @@
+#pragma once
+
+// apple2e_rewind.h
+//
+// Rewind history for the Apple //e emulator in apple2e.h.
+//
+// Do this:
+// ~~~C
+// #define CHIPS_IMPL
+// ~~~
+// before you include this file in *one* C or C++ file to create the
+// implementation, the same one that has the apple2e.h implementation.
+//
+// Include systems/apple2e.h and its dependencies before including
+// apple2e_rewind.h.
+//
+// The system is captured every few video frames into a caller-supplied
+// buffer, which is the whole memory budget. The buffer starts with the CPU
+// and device state of the newest capture (the apple2e_t state without RAM).
+// Its RAM is the live RAM with the writes since then undone: a write hook in
+// mem.h keeps what each main and aux RAM chunk (1 << MEM_WRITE_WATCH_SHIFT
+// bytes) held before the first write to it after a capture. The rest of the
+// buffer is a ring of entries that each take back one capture. At the next
+// capture the kept chunks are replaced by their XOR with the RAM they were
+// taken from, run-length encoded, and the XOR of the state is added. Unchanged
+// bytes XOR to zero runs, so an entry costs about as many bytes as changed
+// between two captures. Until then the ring holds the chunks as they were
+// kept; if the chunks written between two captures don't fit, the history
+// starts over at the next one. Going back undoes the entry being written and
+// then the newest entries one by one. The oldest entries are dropped when the
+// ring is full.
+//
+// Define MEM_WRITE_HOOK before including chips/mem.h. RAM written without
+// mem_wr(), mem_copy_in() or apple2e_load_snapshot() is not part of the
+// history, and neither are the Disk II and hard disk images.
+//
+// ## zlib/libpng license
+//
+// Copyright (c) 2023 Veselin Sladkov
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//     1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software in a
+//     product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//     2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//     3. This notice may not be removed or altered from any source
+//     distribution.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MEM_WRITE_HOOK
+#error "apple2e_rewind.h needs MEM_WRITE_HOOK defined before including chips/mem.h"
+#endif
+
+#define APPLE2E_REWIND_DEFAULT_INTERVAL (10)  // Frames between captures, 6 per second
+#define APPLE2E_REWIND_CHUNK_SIZE       (1U << MEM_WRITE_WATCH_SHIFT)
+#define APPLE2E_REWIND_NUM_CHUNKS       (0x20000 >> MEM_WRITE_WATCH_SHIFT)  // Main RAM chunks, then aux RAM
+
+// Config parameters for apple2e_rewind_init()
+typedef struct {
+    chips_range_t buffer;  // Memory for the newest capture's state and the ring (owned by the caller)
+    uint32_t interval;     // Frames between captures (default APPLE2E_REWIND_DEFAULT_INTERVAL)
+} apple2e_rewind_desc_t;
+
+// Apple //e rewind history
+typedef struct {
+    apple2e_t *sys;
+    uint32_t interval;
+    uint32_t frame;  // Frames counted by apple2e_rewind_frame(), the one restored after going back
+
+    uint8_t *state;           // CPU and device state of the newest capture
+    uint32_t snapshot_frame;  // Frame of the newest capture
+
+    // Ring of entries, each header {size, frame, ram}, ram bytes of RAM chunk records, the encoded XOR of the
+    // state up to size bytes and the header again as trailer
+    uint8_t *ring;
+    uint32_t ring_size;
+    uint32_t head;  // Where the next entry goes
+    uint32_t tail;  // Oldest entry
+    uint32_t used;  // Bytes in entries
+    uint32_t num_entries;
+
+    uint32_t pending;  // Bytes of the entry being written, the chunks written since the newest capture
+    bool overflow;     // The entry being written doesn't fit into the ring
+
+    uint32_t kept[APPLE2E_REWIND_NUM_CHUNKS / 32];  // RAM chunks in the entry being written
+    uint8_t chunk[2][APPLE2E_REWIND_CHUNK_SIZE];    // A kept chunk and its encoding while the entry is completed
+} apple2e_rewind_t;
+
+// Apple //e rewind interface
+
+// Return the smallest buffer apple2e_rewind_init() takes, the history also needs room for the chunks written
+// between two captures
+uint32_t apple2e_rewind_min_size(void);
+// Initialize a rewind history, capture the system as frame 0 and set its write hook, returns false if the buffer
+// is too small, mem_set_write_hook(&sys->mem, 0, 0) ends the history before the buffer is freed
+bool apple2e_rewind_init(apple2e_rewind_t *rw, apple2e_t *sys, const apple2e_rewind_desc_t *desc);
+// Count a finished video frame, captures the system every interval frames, returns true if it did
+bool apple2e_rewind_frame(apple2e_rewind_t *rw);
+// Restore the newest capture before the current frame, returns false if there is none
+bool apple2e_rewind_step_back(apple2e_rewind_t *rw);
+// Restore the newest capture at or before frame and drop the later ones, rw->frame is then the frame of the
+// capture to run on from, returns false if frame is later than the current one or older than the history
+bool apple2e_rewind_seek(apple2e_rewind_t *rw, uint32_t frame);
+// Return the oldest frame apple2e_rewind_seek() can go back to, the current one if the chunks written since the
+// newest capture didn't fit and there is none
+uint32_t apple2e_rewind_oldest_frame(apple2e_rewind_t *rw);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+/*-- IMPLEMENTATION ----------------------------------------------------------*/
+#ifdef CHIPS_IMPL
+#include <string.h>
+#ifndef CHIPS_ASSERT
+#include <assert.h>
+#define CHIPS_ASSERT(c) assert(c)
+#endif
+
+// Bytes of the entry header and of the trailer
+#define _APPLE2E_REWIND_HEADER_SIZE (12)
+
+// RAM chunk records are the chunk index (2 bytes), one of these and what it needs
+#define _APPLE2E_REWIND_SAME (0)  // The chunk is the same again
+#define _APPLE2E_REWIND_XOR  (1)  // The XOR with the chunk, encoded, the entry being written has none
+#define _APPLE2E_REWIND_RAW  (2)  // APPLE2E_REWIND_CHUNK_SIZE bytes of what the chunk held
+
+static uint32_t _apple2e_rewind_state_size(void) {
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < _APPLE2E_DELTA_NUM_STATE; i++) {
+        size += _apple2e_delta_state[i].end - _apple2e_delta_state[i].begin;
+    }
+    return size;
+}
+
+uint32_t apple2e_rewind_min_size(void) {
+    return _apple2e_rewind_state_size() + 2 * _APPLE2E_REWIND_HEADER_SIZE + 3 + APPLE2E_REWIND_CHUNK_SIZE;
+}
+
+static inline uint8_t _apple2e_rewind_get(apple2e_rewind_t *rw, uint32_t pos) {
+    return rw->ring[pos % rw->ring_size];
+}
+
+static inline void _apple2e_rewind_poke(apple2e_rewind_t *rw, uint32_t pos, uint8_t byte) {
+    rw->ring[pos % rw->ring_size] = byte;
+}
+
+static uint32_t _apple2e_rewind_get32(apple2e_rewind_t *rw, uint32_t pos) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= (uint32_t)_apple2e_rewind_get(rw, pos + i) << (i * 8);
+    }
+    return value;
+}
+
+static void _apple2e_rewind_poke32(apple2e_rewind_t *rw, uint32_t pos, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        _apple2e_rewind_poke(rw, pos + i, (uint8_t)(value >> (i * 8)));
+    }
+}
+
+// Drop the oldest entry
+static void _apple2e_rewind_evict(apple2e_rewind_t *rw) {
+    const uint32_t total = _apple2e_rewind_get32(rw, rw->tail) + 2 * _APPLE2E_REWIND_HEADER_SIZE;
+    rw->tail = (rw->tail + total) % rw->ring_size;
+    rw->used -= total;
+    rw->num_entries--;
+}
+
+// Append a byte to the entry being written, evicting the oldest entries to make room
+static inline void _apple2e_rewind_put(apple2e_rewind_t *rw, uint8_t byte) {
+    if (rw->overflow) {
+        return;
+    }
+    if (rw->used + rw->pending == rw->ring_size) {
+        if (rw->num_entries == 0) {
+            rw->overflow = true;
+            return;
+        }
+        _apple2e_rewind_evict(rw);
+    }
+    rw->ring[(rw->head + rw->pending) % rw->ring_size] = byte;
+    rw->pending++;
+}
+
+static void _apple2e_rewind_put32(apple2e_rewind_t *rw, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        _apple2e_rewind_put(rw, (uint8_t)(value >> (i * 8)));
+    }
+}
+
+static void _apple2e_rewind_put_varint(apple2e_rewind_t *rw, uint32_t value) {
+    while (value >= 0x80) {
+        _apple2e_rewind_put(rw, (uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    _apple2e_rewind_put(rw, (uint8_t)value);
+}
+
+static uint32_t _apple2e_rewind_get_varint(apple2e_rewind_t *rw, uint32_t *pos) {
+    uint32_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        const uint8_t byte = _apple2e_rewind_get(rw, (*pos)++);
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+}
+
+// Encode ref XOR src as pairs of (unchanged bytes, changed bytes) counts followed by the XOR of the changed
+// bytes, single unchanged bytes between changed ones are included with them, then copy src into ref.
+// Unchanged bytes carry over to the next call in *zeros.
+static void _apple2e_rewind_encode(apple2e_rewind_t *rw, uint8_t *ref, const uint8_t *src, uint32_t size,
+                                   uint32_t *zeros) {
+    uint32_t i = 0;
+    while (i < size) {
+        const uint32_t same = i;
+        while (((i + 8) <= size) && !memcmp(&ref[i], &src[i], 8)) {
+            i += 8;
+        }
+        while ((i < size) && (ref[i] == src[i])) {
+            i++;
+        }
+        *zeros += i - same;
+        if (i == size) {
+            break;
+        }
+        const uint32_t begin = i;
+        while ((i < size) && ((ref[i] != src[i]) || (((i + 1) < size) && (ref[i + 1] != src[i + 1])))) {
+            i++;
+        }
+        _apple2e_rewind_put_varint(rw, *zeros);
+        _apple2e_rewind_put_varint(rw, i - begin);
+        for (uint32_t j = begin; j < i; j++) {
+            _apple2e_rewind_put(rw, ref[j] ^ src[j]);
+        }
+        memcpy(&ref[begin], &src[begin], i - begin);
+        *zeros = 0;
+    }
+}
+
+static uint32_t _apple2e_rewind_varint(uint8_t *out, uint32_t value) {
+    uint32_t size = 0;
+    while (value >= 0x80) {
+        out[size++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[size++] = (uint8_t)value;
+    return size;
+}
+
+// Encode a XOR b of a chunk the same way into out, the last pair counts the unchanged bytes up to the end of the
+// chunk, returns the bytes or APPLE2E_REWIND_CHUNK_SIZE if it doesn't get smaller than the chunk
+static uint32_t _apple2e_rewind_encode_chunk(uint8_t *out, const uint8_t *a, const uint8_t *b) {
+    const uint32_t size = APPLE2E_REWIND_CHUNK_SIZE;
+    uint32_t len = 0;
+    uint32_t i = 0;
+    while (i < size) {
+        const uint32_t same = i;
+        while ((i < size) && (a[i] == b[i])) {
+            i++;
+        }
+        const uint32_t begin = i;
+        while ((i < size) && ((a[i] != b[i]) || (((i + 1) < size) && (a[i + 1] != b[i + 1])))) {
+            i++;
+        }
+        // Both counts are below the chunk size and take 2 bytes at most
+        if (len + 4 + (i - begin) >= size) {
+            return size;
+        }
+        len += _apple2e_rewind_varint(&out[len], begin - same);
+        len += _apple2e_rewind_varint(&out[len], i - begin);
+        for (uint32_t j = begin; j < i; j++) {
+            out[len++] = a[j] ^ b[j];
+        }
+    }
+    return len;
+}
+
+// Main RAM chunks come first, then aux RAM
+static uint8_t *_apple2e_rewind_chunk_ptr(apple2e_t *sys, uint32_t index) {
+    const uint32_t offset = index * APPLE2E_REWIND_CHUNK_SIZE;
+    return (offset < sizeof(sys->ram)) ? &sys->ram[offset] : &sys->aux_ram[offset - sizeof(sys->ram)];
+}
+
+// Keep what a RAM chunk held at the newest capture before the first write to it since then
+static void _apple2e_rewind_write_hook(uint8_t *chunk, void *user_data) {
+    apple2e_rewind_t *rw = (apple2e_rewind_t *)user_data;
+    apple2e_t *sys = rw->sys;
+    // Host addresses, writes to ROM and unmapped pages go to the junk page of mem_t
+    const uintptr_t host = (uintptr_t)chunk;
+    uint32_t offset;
+    if ((host >= (uintptr_t)sys->ram) && (host < (uintptr_t)sys->ram + sizeof(sys->ram))) {
+        offset = (uint32_t)(host - (uintptr_t)sys->ram);
+    } else if ((host >= (uintptr_t)sys->aux_ram) && (host < (uintptr_t)sys->aux_ram + sizeof(sys->aux_ram))) {
+        offset = (uint32_t)(sizeof(sys->ram) + (host - (uintptr_t)sys->aux_ram));
+    } else {
+        return;
+    }
+    // A bank switch arms the chunk again for the RAM now behind it, which may be kept already
+    const uint32_t index = offset / APPLE2E_REWIND_CHUNK_SIZE;
+    if (rw->kept[index >> 5] & (1U << (index & 31))) {
+        return;
+    }
+    rw->kept[index >> 5] |= 1U << (index & 31);
+    _apple2e_rewind_put(rw, (uint8_t)index);
+    _apple2e_rewind_put(rw, (uint8_t)(index >> 8));
+    _apple2e_rewind_put(rw, _APPLE2E_REWIND_RAW);
+    for (uint32_t i = 0; i < APPLE2E_REWIND_CHUNK_SIZE; i++) {
+        _apple2e_rewind_put(rw, chunk[i]);
+    }
+}
+
+// Start the entry of the next capture with a header to fill in and keep the chunks written from here on
+static void _apple2e_rewind_begin(apple2e_rewind_t *rw) {
+    rw->pending = 0;
+    rw->overflow = false;
+    memset(rw->kept, 0, sizeof(rw->kept));
+    for (int i = 0; i < _APPLE2E_REWIND_HEADER_SIZE; i++) {
+        _apple2e_rewind_put(rw, 0);
+    }
+    mem_set_write_hook(&rw->sys->mem, _apple2e_rewind_write_hook, rw);
+}
+
+// Put the chunks of the records in [pos, end) back into RAM
+static void _apple2e_rewind_undo(apple2e_rewind_t *rw, uint32_t pos, uint32_t end) {
+    while (pos < end) {
+        const uint32_t index = _apple2e_rewind_get(rw, pos) | ((uint32_t)_apple2e_rewind_get(rw, pos + 1) << 8);
+        const uint8_t format = _apple2e_rewind_get(rw, pos + 2);
+        pos += 3;
+        uint8_t *ram = _apple2e_rewind_chunk_ptr(rw->sys, index);
+        if (format == _APPLE2E_REWIND_RAW) {
+            for (uint32_t i = 0; i < APPLE2E_REWIND_CHUNK_SIZE; i++) {
+                ram[i] = _apple2e_rewind_get(rw, pos++);
+            }
+        } else if (format == _APPLE2E_REWIND_XOR) {
+            for (uint32_t i = 0; i < APPLE2E_REWIND_CHUNK_SIZE;) {
+                i += _apple2e_rewind_get_varint(rw, &pos);
+                const uint32_t num_changed = _apple2e_rewind_get_varint(rw, &pos);
+                for (uint32_t j = 0; j < num_changed; j++) {
+                    ram[i++] ^= _apple2e_rewind_get(rw, pos++);
+                }
+            }
+        }
+    }
+}
+
+// Encode the chunks of the entry being written against the RAM of the capture in place, returns their bytes.
+// No record gets larger, so the encoding stays behind the records still to be read.
+static uint32_t _apple2e_rewind_compact(apple2e_rewind_t *rw) {
+    uint8_t *kept = rw->chunk[0];
+    uint8_t *encoded = rw->chunk[1];
+    const uint32_t end = rw->head + rw->pending;
+    uint32_t src = rw->head + _APPLE2E_REWIND_HEADER_SIZE;
+    uint32_t dst = src;
+    while (src < end) {
+        const uint8_t index_lo = _apple2e_rewind_get(rw, src);
+        const uint8_t index_hi = _apple2e_rewind_get(rw, src + 1);
+        src += 3;
+        for (uint32_t i = 0; i < APPLE2E_REWIND_CHUNK_SIZE; i++) {
+            kept[i] = _apple2e_rewind_get(rw, src++);
+        }
+        const uint8_t *ram = _apple2e_rewind_chunk_ptr(rw->sys, index_lo | ((uint32_t)index_hi << 8));
+        _apple2e_rewind_poke(rw, dst++, index_lo);
+        _apple2e_rewind_poke(rw, dst++, index_hi);
+        if (!memcmp(kept, ram, APPLE2E_REWIND_CHUNK_SIZE)) {
+            _apple2e_rewind_poke(rw, dst++, _APPLE2E_REWIND_SAME);
+            continue;
+        }
+        const uint32_t size = _apple2e_rewind_encode_chunk(encoded, kept, ram);
+        const uint8_t *record = (size < APPLE2E_REWIND_CHUNK_SIZE) ? encoded : kept;
+        _apple2e_rewind_poke(rw, dst++, (size < APPLE2E_REWIND_CHUNK_SIZE) ? _APPLE2E_REWIND_XOR : _APPLE2E_REWIND_RAW);
+        for (uint32_t i = 0; i < size; i++) {
+            _apple2e_rewind_poke(rw, dst++, record[i]);
+        }
+    }
+    rw->pending = dst - rw->head;
+    return rw->pending - _APPLE2E_REWIND_HEADER_SIZE;
+}
+
+// Complete the entry of the newest capture, the system becomes the newest capture
+static void _apple2e_rewind_capture(apple2e_rewind_t *rw) {
+    apple2e_t *sys = rw->sys;
+    const uint32_t ram = rw->overflow ? 0 : _apple2e_rewind_compact(rw);
+    uint8_t *ref = rw->state;
+    uint32_t zeros = 0;
+    for (uint32_t i = 0; i < _APPLE2E_DELTA_NUM_STATE; i++) {
+        const uint32_t begin = _apple2e_delta_state[i].begin;
+        const uint32_t end = _apple2e_delta_state[i].end;
+        _apple2e_rewind_encode(rw, ref, (const uint8_t *)sys + begin, end - begin, &zeros);
+        ref += end - begin;
+    }
+    const uint32_t size = rw->pending - _APPLE2E_REWIND_HEADER_SIZE;
+    _apple2e_rewind_put32(rw, size);
+    _apple2e_rewind_put32(rw, rw->snapshot_frame);
+    _apple2e_rewind_put32(rw, ram);
+    if (rw->overflow) {
+        // The chunks didn't fit, the older captures can't be reached anymore
+        rw->head = rw->tail = rw->used = rw->num_entries = 0;
+    } else {
+        _apple2e_rewind_poke32(rw, rw->head, size);
+        _apple2e_rewind_poke32(rw, rw->head + 4, rw->snapshot_frame);
+        _apple2e_rewind_poke32(rw, rw->head + 8, ram);
+        rw->head = (rw->head + rw->pending) % rw->ring_size;
+        rw->used += rw->pending;
+        rw->num_entries++;
+    }
+    rw->snapshot_frame = rw->frame;
+    _apple2e_rewind_begin(rw);
+}
+
+// Undo the newest entry, the capture before it becomes the newest one
+static void _apple2e_rewind_pop(apple2e_rewind_t *rw) {
+    CHIPS_ASSERT(rw->num_entries > 0);
+    const uint32_t trailer = rw->head + rw->ring_size - _APPLE2E_REWIND_HEADER_SIZE;
+    const uint32_t size = _apple2e_rewind_get32(rw, trailer);
+    const uint32_t frame = _apple2e_rewind_get32(rw, trailer + 4);
+    const uint32_t ram = _apple2e_rewind_get32(rw, trailer + 8);
+    const uint32_t total = size + 2 * _APPLE2E_REWIND_HEADER_SIZE;
+    const uint32_t start = (rw->head + rw->ring_size - total) % rw->ring_size;
+    uint32_t pos = start + _APPLE2E_REWIND_HEADER_SIZE;
+    _apple2e_rewind_undo(rw, pos, pos + ram);
+    pos += ram;
+    const uint32_t end = start + _APPLE2E_REWIND_HEADER_SIZE + size;
+    uint8_t *ref = rw->state;
+    while (pos < end) {
+        ref += _apple2e_rewind_get_varint(rw, &pos);
+        const uint32_t num_changed = _apple2e_rewind_get_varint(rw, &pos);
+        for (uint32_t i = 0; i < num_changed; i++) {
+            *ref++ ^= _apple2e_rewind_get(rw, pos++);
+        }
+    }
+    rw->head = start;
+    rw->used -= total;
+    rw->num_entries--;
+    rw->snapshot_frame = frame;
+}
+
+// Put the state of the newest capture back into the system, its RAM is back already
+static void _apple2e_rewind_restore(apple2e_rewind_t *rw) {
+    apple2e_t *sys = rw->sys;
+    // The state holds pointers into this apple2e_t, keep what the caller may have changed since
+    const chips_debug_t debug = sys->debug;
+    const chips_audio_callback_t audio_callback = sys->audio_callback;
+    void *block_cache = sys->block_cache;
+    const apple2e_surface_t surface = sys->surface;
+    const uint8_t *ref = rw->state;
+    for (uint32_t i = 0; i < _APPLE2E_DELTA_NUM_STATE; i++) {
+        const uint32_t begin = _apple2e_delta_state[i].begin;
+        const uint32_t end = _apple2e_delta_state[i].end;
+        memcpy((uint8_t *)sys + begin, ref, end - begin);
+        ref += end - begin;
+    }
+    sys->debug = debug;
+    sys->audio_callback = audio_callback;
+    sys->block_cache = block_cache;
+    sys->surface = surface;
+    _apple2e_snapshot_onrestore(sys);
+    // A delta snapshot after this carries all of RAM
+    mem_mark_written(&sys->mem, 0, MEM_ADDR_RANGE);
+}
+
+bool apple2e_rewind_init(apple2e_rewind_t *rw, apple2e_t *sys, const apple2e_rewind_desc_t *desc) {
+    CHIPS_ASSERT(rw && sys && sys->valid && desc && desc->buffer.ptr);
+    const uint32_t state_size = _apple2e_rewind_state_size();
+    memset(rw, 0, sizeof(apple2e_rewind_t));
+    if (desc->buffer.size < apple2e_rewind_min_size()) {
+        return false;
+    }
+    rw->sys = sys;
+    rw->interval = desc->interval ? desc->interval : APPLE2E_REWIND_DEFAULT_INTERVAL;
+    rw->state = (uint8_t *)desc->buffer.ptr;
+    rw->ring = rw->state + state_size;
+    rw->ring_size = (uint32_t)(desc->buffer.size - state_size);
+    uint8_t *ref = rw->state;
+    for (uint32_t i = 0; i < _APPLE2E_DELTA_NUM_STATE; i++) {
+        const uint32_t begin = _apple2e_delta_state[i].begin;
+        const uint32_t end = _apple2e_delta_state[i].end;
+        memcpy(ref, (const uint8_t *)sys + begin, end - begin);
+        ref += end - begin;
+    }
+    _apple2e_rewind_begin(rw);
+    return true;
+}
+
+bool apple2e_rewind_frame(apple2e_rewind_t *rw) {
+    CHIPS_ASSERT(rw && rw->sys);
+    rw->frame++;
+    if ((rw->frame % rw->interval) != 0) {
+        return false;
+    }
+    _apple2e_rewind_capture(rw);
+    return true;
+}
+
+uint32_t apple2e_rewind_oldest_frame(apple2e_rewind_t *rw) {
+    CHIPS_ASSERT(rw && rw->sys);
+    if (rw->overflow) {
+        return rw->frame;
+    }
+    return rw->num_entries ? _apple2e_rewind_get32(rw, rw->tail + 4) : rw->snapshot_frame;
+}
+
+bool apple2e_rewind_seek(apple2e_rewind_t *rw, uint32_t frame) {
+    CHIPS_ASSERT(rw && rw->sys);
+    if (rw->overflow || (frame > rw->frame) || (frame < apple2e_rewind_oldest_frame(rw))) {
+        return false;
+    }
+    // Back to the newest capture, then one entry after the other
+    _apple2e_rewind_undo(rw, rw->head + _APPLE2E_REWIND_HEADER_SIZE, rw->head + rw->pending);
+    rw->pending = 0;
+    while (rw->snapshot_frame > frame) {
+        _apple2e_rewind_pop(rw);
+    }
+    _apple2e_rewind_restore(rw);
+    rw->frame = rw->snapshot_frame;
+    _apple2e_rewind_begin(rw);
+    return true;
+}
+
+bool apple2e_rewind_step_back(apple2e_rewind_t *rw) {
+    CHIPS_ASSERT(rw && rw->sys);
+    return (rw->frame > 0) && apple2e_rewind_seek(rw, rw->frame - 1);
+}
+
+#endif  // CHIPS_IMPL
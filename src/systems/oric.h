@@ -68,7 +68,7 @@ extern "C" {
 #endif
 
 // Bump snapshot version when oric_t memory layout changes
-#define ORIC_SNAPSHOT_VERSION (1)
+#define ORIC_SNAPSHOT_VERSION (5)
 
 #define ORIC_FREQUENCY     (1000000)  // 1 MHz
 #define ORIC_MAX_TAPE_SIZE (1 << 16)  // Max size of tape file in bytes
@@ -77,6 +77,9 @@ extern "C" {
 #define ORIC_SCREEN_HEIGHT    224  // (224)
 #define ORIC_FRAMEBUFFER_SIZE ((ORIC_SCREEN_WIDTH / 2) * ORIC_SCREEN_HEIGHT)
 
+// Number of 32-bit words in a dirty row mask (one bit per scanline)
+#define ORIC_DIRTY_WORDS (ORIC_SCREEN_HEIGHT / 32)
+
 #define PALETTE_BITS 3
 #define PALETTE_SIZE (1 << PALETTE_BITS)
 
@@ -125,7 +128,19 @@ typedef struct {
 
     uint8_t reserved[3];
     uint8_t fb[ORIC_FRAMEBUFFER_SIZE];
-    bool screen_dirty;
+    bool screen_dirty;    // Video memory or a charset was written since the last oric_screen_update()
+    bool blink_state;     // Blink phase the blinking rows were last rendered in
+    uint64_t frame_hash;  // chips_hash64() of fb at the last oric_screen_update()
+
+    // Scanlines to redraw, and what each scanline depended on when it was last rendered:
+    // the serial attributes at its start and end, the character codes it drew from each
+    // charset (hires/text, standard/alternate) and whether it has a blink attribute
+    uint32_t row_dirty[ORIC_DIRTY_WORDS];
+    uint8_t row_pattr[ORIC_SCREEN_HEIGHT];
+    uint8_t row_pattr_end[ORIC_SCREEN_HEIGHT];
+    uint32_t row_glyphs[ORIC_SCREEN_HEIGHT][4];
+    uint8_t row_flags[ORIC_SCREEN_HEIGHT];
+    uint32_t glyph_dirty[4][4];  // Character codes written in each charset since the last oric_screen_update()
 
     uint16_t extension;
 
@@ -134,6 +149,9 @@ typedef struct {
     disk2_fdc_t fdc;  // Disk II floppy disk controller
 
     uint32_t system_ticks;
+    uint8_t psg_sample_ticks;  // Ticks since the last PSG sample, one every 46
+    uint8_t td_ticks;          // VIA ticks since the last tape drive tick, one every 52
+    uint8_t td_motor;          // Tape motor bit (VIA PB6) seen last
 
 } oric_t;
 
@@ -152,10 +170,13 @@ void oric_tick(oric_t* sys);
 uint32_t oric_exec(oric_t* sys, uint32_t micro_seconds);
 // Take a snapshot, patches pointers to zero or offsets, returns snapshot version
 uint32_t oric_save_snapshot(oric_t* sys, oric_t* dst);
-// Load a snapshot, returns false if snapshot version doesn't match
+// Load a snapshot into the instance it was taken of, its ROM pages point into that instance's ROM image, returns
+// false if snapshot version doesn't match
 bool oric_load_snapshot(oric_t* sys, uint32_t version, oric_t* src);
 
 void oric_screen_update(oric_t* sys);
+// Return a 64-bit hash of the frame completed by the last oric_screen_update(), unchanged frames have the same hash
+uint64_t oric_frame_hash(oric_t* sys);
 
 #ifdef __cplusplus
 }  // extern "C"
@@ -180,6 +201,9 @@ static void _oric_init_key_map(oric_t* sys);
 #define LATTR_DSIZE (0x02)
 #define LATTR_BLINK (0x04)
 
+// row_flags, the low bits are the charsets (1 << _oric_charset_index()) a row drew from
+#define ORIC_ROW_BLINK (0x10)
+
 void oric_init(oric_t* sys, const oric_desc_t* desc) {
     CHIPS_ASSERT(sys && desc);
     if (desc->debug.callback.func) {
@@ -212,6 +236,10 @@ void oric_init(oric_t* sys, const oric_desc_t* desc) {
     sys->blink_counter = 0;
     sys->pattr = 0;
 
+    // Draw the whole screen on the first oric_screen_update()
+    sys->screen_dirty = true;
+    memset(sys->row_dirty, 0xFF, sizeof(sys->row_dirty));
+
     sys->extension = 0;
 
     // Optionally setup tape drive
@@ -257,6 +285,41 @@ void oric_reset(oric_t* sys) {
     MOS6502CPU_RESET(&sys->cpu);
 }
 
+// Charsets in the order of _oric_charset_index(): hires $9800/$9C00, text $B400/$B800
+static inline int _oric_charset_index(uint8_t pattr, uint8_t lattr) {
+    return ((pattr & PATTR_HIRES) ? 0 : 2) | ((lattr & LATTR_ALT) ? 1 : 0);
+}
+
+static inline void _oric_mark_rows(oric_t* sys, int first_row, int num_rows) {
+    for (int y = first_row; y < first_row + num_rows; y++) {
+        sys->row_dirty[y >> 5] |= 1U << (y & 31);
+    }
+}
+
+// Mark the scanlines showing a video memory address for redraw, for charset writes
+// remember the character code, the rows that draw it are found in oric_screen_update()
+static void _oric_mark_dirty(oric_t* sys, uint16_t addr) {
+    sys->screen_dirty = true;
+    if ((addr >= 0xA000) && (addr < 0xA000 + 200 * 40)) {
+        // HIRES, one scanline per 40 bytes
+        _oric_mark_rows(sys, (addr - 0xA000) / 40, 1);
+    }
+    if (addr >= 0xBB80) {
+        // TEXT, 8 scanlines per 40 bytes
+        _oric_mark_rows(sys, ((addr - 0xBB80) / 40) * 8, 8);
+    }
+    int charset = -1;
+    if (addr < 0xA000) {
+        charset = (addr - 0x9800) >> 10;
+    } else if ((addr >= 0xB400) && (addr < 0xBC00)) {
+        charset = 2 + ((addr - 0xB400) >> 10);
+    }
+    if (charset >= 0) {
+        uint8_t code = (addr & 0x3FF) >> 3;
+        sys->glyph_dirty[charset][code >> 5] |= 1U << (code & 31);
+    }
+}
+
 static void _oric_mem_rw(oric_t* sys, uint16_t addr, bool rw) {
     if ((addr >= 0x0300) && (addr <= 0x03FF)) {
         // Memory-mapped IO area
@@ -330,14 +393,12 @@ static void _oric_mem_rw(oric_t* sys, uint16_t addr, bool rw) {
             mem_wr(&sys->mem, addr, MOS6502CPU_GET_DATA(&sys->cpu));
 
             if (addr >= 0x9800 && addr <= 0xBFDF) {
-                sys->screen_dirty = true;
+                _oric_mark_dirty(sys, addr);
             }
         }
     }
 }
 
-static uint8_t _last_motor_state = 0;
-
 void oric_tick(oric_t* sys) {
     MOS6502CPU_TICK(&sys->cpu);
 
@@ -352,15 +413,13 @@ void oric_tick(oric_t* sys) {
         ay38910psg_tick_envelope_generator(&sys->psg);
     }
 
-    static uint8_t t1 = 0;
-    t1++;
-    if (t1 == 46) {
+    if (++sys->psg_sample_ticks == 46) {
         ay38910psg_tick_sample_generator(&sys->psg);
         if (sys->audio_callback.func) {
             // New sample is ready
             sys->audio_callback.func((uint8_t)((uint8_t)(sys->psg.sample * 255.0f)), sys->audio_callback.user_data);
         }
-        t1 = 0;
+        sys->psg_sample_ticks = 0;
     }
 
     // Tick FDC
@@ -400,7 +459,7 @@ void oric_tick(oric_t* sys) {
 
         if (sys->td.valid) {
             uint8_t motor_state = pb & 0x40;
-            if (motor_state != _last_motor_state) {
+            if (motor_state != sys->td_motor) {
                 if (motor_state) {
                     sys->td.port |= ORIC_TD_PORT_MOTOR;
                     printf("oric: motor on\n");
@@ -408,14 +467,12 @@ void oric_tick(oric_t* sys) {
                     sys->td.port &= ~ORIC_TD_PORT_MOTOR;
                     printf("oric: motor off\n");
                 }
-                _last_motor_state = motor_state;
+                sys->td_motor = motor_state;
             }
 
-            static uint8_t t2 = 0;
-            t2++;
-            if (t2 == 52) {
+            if (++sys->td_ticks == 52) {
                 oric_td_tick(&sys->td);
-                t2 = 0;
+                sys->td_ticks = 0;
             }
             if (sys->td.port & ORIC_TD_PORT_READ) {
                 mos6522via_set_cb1(&sys->via, true);
@@ -446,97 +503,150 @@ static uint8_t _oric_psg_in(int port_id, void* user_data) {
     return 0xFF;
 }
 
-void oric_screen_update(oric_t* sys) {
-    if (!sys->screen_dirty) {
-        return;
-    }
+// Render scanline y starting with the serial attributes pattr, returns the attributes at its end
+static uint8_t _oric_render_row(oric_t* sys, int y, uint8_t pattr, bool blink_state) {
+    // Line attributes and current colors
+    uint8_t lattr = 0;
+    uint8_t fgcol = 7;
+    uint8_t bgcol = 0;
+
+    uint32_t* glyphs = sys->row_glyphs[y];
+    uint8_t flags = 0;
+    memset(glyphs, 0, sizeof(sys->row_glyphs[y]));
+    sys->row_pattr[y] = pattr;
+
+    uint8_t* p = &sys->fb[y * (ORIC_SCREEN_WIDTH / 2)];
+
+    for (int x = 0; x < 40; x++) {
+        // Lookup the byte and, if needed, the pattern data
+        uint8_t ch, pat;
+        if ((pattr & PATTR_HIRES) && y < 200)
+            ch = pat = sys->ram[0xA000 + y * 40 + x];
+
+        else {
+            ch = sys->ram[0xBB80 + (y >> 3) * 40 + x];
+            int off = (lattr & LATTR_DSIZE ? y >> 1 : y) & 7;
+            const uint8_t* base;
+            if (pattr & PATTR_HIRES)
+                if (lattr & LATTR_ALT)
+                    base = sys->ram + 0x9C00;
+                else
+                    base = sys->ram + 0x9800;
+            else if (lattr & LATTR_ALT)
+                base = sys->ram + 0xB800;
+            else
+                base = sys->ram + 0xB400;
+            pat = base[((ch & 0x7F) << 3) | off];
+            flags |= 1 << _oric_charset_index(pattr, lattr);
+            glyphs[(ch & 0x7F) >> 5] |= 1U << (ch & 31);
+        }
 
-    bool blink_state = sys->blink_counter & 0x20;
-    sys->blink_counter = (sys->blink_counter + 1) & 0x3F;
+        // Handle state-chaging attributes
+        if (!(ch & 0x60)) {
+            pat = 0x00;
+            switch (ch & 0x18) {
+                case 0x00:
+                    fgcol = ch & 7;
+                    break;
+                case 0x08:
+                    lattr = ch & 7;
+                    break;
+                case 0x10:
+                    bgcol = ch & 7;
+                    break;
+                case 0x18:
+                    pattr = ch & 7;
+                    break;
+            }
+        }
 
-    uint8_t pattr = sys->pattr;
+        // Pick up the colors for the pattern
+        uint8_t c_fgcol = fgcol;
+        uint8_t c_bgcol = bgcol;
 
-    for (int y = 0; y < 224; y++) {
-        // Line attributes and current colors
-        uint8_t lattr = 0;
-        uint8_t fgcol = 7;
-        uint8_t bgcol = 0;
-
-        uint8_t* p = &sys->fb[y * (ORIC_SCREEN_WIDTH / 2)];
-
-        for (int x = 0; x < 40; x++) {
-            // Lookup the byte and, if needed, the pattern data
-            uint8_t ch, pat;
-            if ((pattr & PATTR_HIRES) && y < 200)
-                ch = pat = sys->ram[0xA000 + y * 40 + x];
-
-            else {
-                ch = sys->ram[0xBB80 + (y >> 3) * 40 + x];
-                int off = (lattr & LATTR_DSIZE ? y >> 1 : y) & 7;
-                const uint8_t* base;
-                if (pattr & PATTR_HIRES)
-                    if (lattr & LATTR_ALT)
-                        base = sys->ram + 0x9C00;
-                    else
-                        base = sys->ram + 0x9800;
-                else if (lattr & LATTR_ALT)
-                    base = sys->ram + 0xB800;
-                else
-                    base = sys->ram + 0xB400;
-                pat = base[((ch & 0x7F) << 3) | off];
-            }
+        // inverse video
+        if (ch & 0x80) {
+            c_bgcol = c_bgcol ^ 0x07;
+            c_fgcol = c_fgcol ^ 0x07;
+        }
+        // blink
+        if (lattr & LATTR_BLINK) {
+            flags |= ORIC_ROW_BLINK;
+            if (blink_state) c_fgcol = c_bgcol;
+        }
+
+        // Draw the pattern
+        uint8_t c;
+        c = pat & 0x20 ? c_fgcol : c_bgcol;
+        *p = c << 4;
+        c = pat & 0x10 ? c_fgcol : c_bgcol;
+        *p++ |= c;
+        c = pat & 0x08 ? c_fgcol : c_bgcol;
+        *p = c << 4;
+        c = pat & 0x04 ? c_fgcol : c_bgcol;
+        *p++ |= c;
+        c = pat & 0x02 ? c_fgcol : c_bgcol;
+        *p = c << 4;
+        c = pat & 0x01 ? c_fgcol : c_bgcol;
+        *p++ |= c;
+    }
+
+    sys->row_flags[y] = flags;
+    sys->row_pattr_end[y] = pattr;
+    return pattr;
+}
 
-            // Handle state-chaging attributes
-            if (!(ch & 0x60)) {
-                pat = 0x00;
-                switch (ch & 0x18) {
-                    case 0x00:
-                        fgcol = ch & 7;
-                        break;
-                    case 0x08:
-                        lattr = ch & 7;
-                        break;
-                    case 0x10:
-                        bgcol = ch & 7;
-                        break;
-                    case 0x18:
-                        pattr = ch & 7;
-                        break;
+// True if a charset write since the last update changed a character the row draws
+static bool _oric_row_glyphs_dirty(oric_t* sys, int y) {
+    for (int charset = 0; charset < 4; charset++) {
+        if (sys->row_flags[y] & (1 << charset)) {
+            for (int i = 0; i < 4; i++) {
+                if (sys->row_glyphs[y][i] & sys->glyph_dirty[charset][i]) {
+                    return true;
                 }
             }
+        }
+    }
+    return false;
+}
 
-            // Pick up the colors for the pattern
-            uint8_t c_fgcol = fgcol;
-            uint8_t c_bgcol = bgcol;
+void oric_screen_update(oric_t* sys) {
+    bool blink_state = sys->blink_counter & 0x20;
+    sys->blink_counter = (sys->blink_counter + 1) & 0x3F;
+    bool blink_changed = (blink_state != sys->blink_state);
+    sys->blink_state = blink_state;
 
-            // inverse video
-            if (ch & 0x80) {
-                c_bgcol = c_bgcol ^ 0x07;
-                c_fgcol = c_fgcol ^ 0x07;
-            }
-            // blink
-            if ((lattr & LATTR_BLINK) && blink_state) c_fgcol = c_bgcol;
-
-            // Draw the pattern
-            uint8_t c;
-            c = pat & 0x20 ? c_fgcol : c_bgcol;
-            *p = c << 4;
-            c = pat & 0x10 ? c_fgcol : c_bgcol;
-            *p++ |= c;
-            c = pat & 0x08 ? c_fgcol : c_bgcol;
-            *p = c << 4;
-            c = pat & 0x04 ? c_fgcol : c_bgcol;
-            *p++ |= c;
-            c = pat & 0x02 ? c_fgcol : c_bgcol;
-            *p = c << 4;
-            c = pat & 0x01 ? c_fgcol : c_bgcol;
-            *p++ |= c;
+    // A serial attribute left over from the previous frame also changes the screen
+    if (!sys->screen_dirty && !blink_changed && (sys->pattr == sys->row_pattr[0])) {
+        return;
+    }
+
+    // Redraw the dirty scanlines, the ones whose serial attributes at the start changed (a
+    // redrawn scanline above ends differently), the blinking ones when the phase changed
+    // and the ones drawing a character that was redefined
+    uint8_t pattr = sys->pattr;
+    for (int y = 0; y < ORIC_SCREEN_HEIGHT; y++) {
+        bool dirty = (sys->row_dirty[y >> 5] & (1U << (y & 31))) || (pattr != sys->row_pattr[y]) ||
+                     (blink_changed && (sys->row_flags[y] & ORIC_ROW_BLINK)) ||
+                     (sys->screen_dirty && _oric_row_glyphs_dirty(sys, y));
+        if (dirty) {
+            pattr = _oric_render_row(sys, y, pattr, blink_state);
+        } else {
+            pattr = sys->row_pattr_end[y];
         }
     }
 
     sys->pattr = pattr;
 
+    memset(sys->row_dirty, 0, sizeof(sys->row_dirty));
+    memset(sys->glyph_dirty, 0, sizeof(sys->glyph_dirty));
     sys->screen_dirty = false;
+    sys->frame_hash = chips_hash64(sys->fb, sizeof(sys->fb), 0);
+}
+
+uint64_t oric_frame_hash(oric_t* sys) {
+    CHIPS_ASSERT(sys && sys->valid);
+    return sys->frame_hash;
 }
 
 uint32_t oric_exec(oric_t* sys, uint32_t micro_seconds) {
@@ -649,16 +759,25 @@ bool oric_load_snapshot(oric_t* sys, uint32_t version, oric_t* src) {
     if (version != ORIC_SNAPSHOT_VERSION) {
         return false;
     }
-    static oric_t im;
-    im = *src;
-    chips_debug_snapshot_onload(&im.debug, &sys->debug);
-    chips_audio_callback_snapshot_onload(&im.audio_callback, &sys->audio_callback);
-    // m6502_snapshot_onload(&im.cpu, &sys->cpu);
-    ay38910psg_snapshot_onload(&im.psg, &sys->psg);
-    oric_td_snapshot_onload(&im.td, &sys->td);
-    disk2_fdc_snapshot_onload(&im.fdc, &sys->fdc);
-    mem_snapshot_onload(&im.mem, sys);
-    *sys = im;
+    // The snapshot is copied straight over sys, keep what the fixups take from the caller's instance,
+    // of the PSG only the callbacks that ay38910psg_snapshot_onload() restores (the rest is too big for the stack)
+    chips_debug_t debug = sys->debug;
+    chips_audio_callback_t audio_callback = sys->audio_callback;
+    const ay38910psg_in_t psg_in_cb = sys->psg.in_cb;
+    const ay38910psg_out_t psg_out_cb = sys->psg.out_cb;
+    void* psg_user_data = sys->psg.user_data;
+    oric_td_t td = sys->td;
+    disk2_fdc_t fdc = sys->fdc;
+    *sys = *src;
+    chips_debug_snapshot_onload(&sys->debug, &debug);
+    chips_audio_callback_snapshot_onload(&sys->audio_callback, &audio_callback);
+    // m6502_snapshot_onload(&sys->cpu, &cpu);
+    sys->psg.in_cb = psg_in_cb;
+    sys->psg.out_cb = psg_out_cb;
+    sys->psg.user_data = psg_user_data;
+    oric_td_snapshot_onload(&sys->td, &td);
+    disk2_fdc_snapshot_onload(&sys->fdc, &fdc);
+    mem_snapshot_onload(&sys->mem, sys);
     return true;
 }
 